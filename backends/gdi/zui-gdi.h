@@ -285,6 +285,11 @@ void gdi_renderer(zcmd_any *cmd, void *user_data) {
                 app_ctx.font_list[cmd->font.font_id] = handle;
                 app_ctx.font_dc[cmd->font.font_id] = dc;
                 cmd->font.response_height = metric.tmHeight;
+                // the face's metrics and file size change with the installed version of the font
+                u32 identity = 0x811C9DC5 ^ GetFontData(dc, 0, 0, 0, 0);
+                for(i32 i = 0; i < (i32)sizeof(metric); i++)
+                    identity = (identity ^ ((u8*)&metric)[i]) * 0x01000193;
+                cmd->font.response_identity = identity | 1;
             } else
                 cmd->font.response_height = 0;
         } break;
@@ -0,0 +1,350 @@
+#ifndef ZUI_INCLUDED
+#error Must include zui.h before zui-headless.h
+#else
+// Headless renderer. Doesn't open a display, which makes it usable on CI and benchmark machines.
+// Font metrics come from real font files through stb_truetype, the draw command stream of each frame
+// can be recorded and hashed to check that the output is deterministic.
+//
+// A font family is either a path to a .ttf file, or a name which is looked up as <font_dir>/<family>.ttf
+// Fonts are identified (ZCMD_REG_FONT response_identity) by a hash of their file, fallback metrics by their size.
+// With async_fonts each font loads on its own thread and is handed to zui with zui_push between frames.
+#ifdef ZUI_IMPL
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#include <pthread.h>
+#endif
+#define STB_TRUETYPE_IMPLEMENTATION
+#define STBTT_STATIC
+#include "../sokol/stb_truetype.h"
+#else
+void headless_renderer(zcmd_any *cmd, void *user_data);
+#endif
+typedef struct zui_headless_args {
+    i32 width;
+    i32 height;
+    i32 frames;            // frames rendered by zui_init when not ticking manually
+    char *font_dir;        // searched for <family>.ttf
+    bool fallback_metrics; // fonts that can't be loaded get fixed metrics derived from their size
+    bool record;           // keep the command stream of the last rendered frame
+    bool fixed_clock;      // every ZCMD_TIMESTAMP advances by 1us, making runs bit-for-bit repeatable
+    bool async_fonts;      // answer ZCMD_REG_FONT with ZFONT_PENDING and load in the background. Not for remote renderers
+    zui_init_fn init;
+    zui_frame_fn frame;
+    zui_close_fn close;
+    bool tick_manually;
+} zui_headless_args;
+
+// returns the draw commands (ZCMD_RENDER_BEGIN/END excluded) of the last rendered frame
+u8 *headless_frame(i32 *len);
+// returns the number of draw commands of the last rendered frame
+i32 headless_frame_cmds();
+// returns a FNV-1a hash of the draw commands of the last rendered frame
+u64 headless_frame_hash();
+
+#ifdef ZUI_IMPL
+#define HEADLESS_MAX_FONTS 64
+typedef struct zui_headless_font {
+    u8 *data;
+    stbtt_fontinfo info;
+    f32 scale;
+    i32 height;
+    i32 fixed_width; // non-zero when using fallback metrics
+    // loading in the background
+    i32 state;       // HEADLESS_FONT_*
+    char *family;
+    i32 size;
+    u16 loaded_height;
+    u32 identity;
+#ifdef _WIN32
+    HANDLE thread;
+#else
+    pthread_t thread;
+#endif
+} zui_headless_font;
+enum { HEADLESS_FONT_IDLE, HEADLESS_FONT_LOADING, HEADLESS_FONT_LOADED };
+
+typedef struct zui_headless_ctx {
+    zui_headless_font fonts[HEADLESS_MAX_FONTS];
+    u8 *frame[2];   // [0] is being recorded, [1] is the last complete frame
+    i32 used[2];
+    i32 cap[2];
+    i32 cmds[2];
+    u64 hash[2];
+    char *clipboard;
+    u64 clock;
+    zui_headless_args *args;
+    i32 loading;    // fonts not handed over yet
+    bool fixed_clock;
+    bool running;
+} zui_headless_ctx;
+static zui_headless_ctx headless_ctx;
+
+u8 *headless_frame(i32 *len) {
+    *len = headless_ctx.used[1];
+    return headless_ctx.frame[1];
+}
+i32 headless_frame_cmds() { return headless_ctx.cmds[1]; }
+u64 headless_frame_hash() { return headless_ctx.hash[1]; }
+
+static u64 _headless_fnv(u64 hash, u8 *data, i32 len) {
+    for(i32 i = 0; i < len; i++)
+        hash = (hash ^ data[i]) * 0x100000001B3ULL;
+    return hash;
+}
+
+static void _headless_record(zcmd_any *cmd, bool keep) {
+    headless_ctx.cmds[0]++;
+    headless_ctx.hash[0] = _headless_fnv(headless_ctx.hash[0], (u8*)cmd, cmd->base.bytes);
+    if(!keep) return;
+    i32 used = headless_ctx.used[0] + cmd->base.bytes;
+    if(used > headless_ctx.cap[0]) {
+        while(used > headless_ctx.cap[0])
+            headless_ctx.cap[0] = headless_ctx.cap[0] ? headless_ctx.cap[0] * 2 : 4096;
+        headless_ctx.frame[0] = realloc(headless_ctx.frame[0], headless_ctx.cap[0]);
+    }
+    memcpy(headless_ctx.frame[0] + headless_ctx.used[0], cmd, cmd->base.bytes);
+    headless_ctx.used[0] = used;
+}
+
+static void _headless_swap() {
+    u8 *frame = headless_ctx.frame[0];
+    i32 cap = headless_ctx.cap[0];
+    headless_ctx.frame[0] = headless_ctx.frame[1];
+    headless_ctx.cap[0] = headless_ctx.cap[1];
+    headless_ctx.frame[1] = frame;
+    headless_ctx.cap[1] = cap;
+    headless_ctx.used[1] = headless_ctx.used[0];
+    headless_ctx.cmds[1] = headless_ctx.cmds[0];
+    headless_ctx.hash[1] = headless_ctx.hash[0];
+}
+
+static u8 *_headless_read_file(char *path, i32 *len) {
+    FILE *f = fopen(path, "rb");
+    if(!f) return 0;
+    fseek(f, 0, SEEK_END);
+    *len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    u8 *data = malloc(*len);
+    if(fread(data, 1, *len, f) != (size_t)*len) {
+        free(data);
+        data = 0;
+    }
+    fclose(f);
+    return data;
+}
+
+static i32 _headless_reg_font(zui_headless_args *args, u16 font_id, char *family, i32 size, u32 *identity) {
+    if(font_id >= HEADLESS_MAX_FONTS) return 0;
+    zui_headless_font *font = &headless_ctx.fonts[font_id];
+    i32 len = 0;
+    u8 *data = _headless_read_file(family, &len);
+    if(!data && args->font_dir) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s.ttf", args->font_dir, family);
+        data = _headless_read_file(path, &len);
+    }
+    if(data && stbtt_InitFont(&font->info, data, stbtt_GetFontOffsetForIndex(data, 0))) {
+        i32 ascent, descent, gap;
+        font->data = data;
+        font->scale = stbtt_ScaleForPixelHeight(&font->info, (f32)size);
+        stbtt_GetFontVMetrics(&font->info, &ascent, &descent, &gap);
+        font->height = (i32)((ascent - descent + gap) * font->scale + 0.5f);
+        font->fixed_width = 0;
+        u64 hash = _headless_fnv(0xCBF29CE484222325ULL, data, len);
+        *identity = (u32)(hash ^ hash >> 32) | 1;
+        return font->height;
+    }
+    free(data);
+    if(!args->fallback_metrics) return 0;
+    zui_log("headless: couldn't load font %s, using fallback metrics\n", family);
+    font->data = 0;
+    font->height = size + size / 4;
+    font->fixed_width = size / 2 + 1;
+    *identity = 0x46414C42; // "FALB", the metrics only depend on the size
+    return font->height;
+}
+
+// the loading thread publishes the font with the state, the frame thread only touches it once it's LOADED
+static i32 _headless_font_state(zui_headless_font *font) {
+#ifdef _WIN32
+    return InterlockedCompareExchange((volatile LONG*)&font->state, 0, 0);
+#else
+    return __atomic_load_n(&font->state, __ATOMIC_ACQUIRE);
+#endif
+}
+static void _headless_set_font_state(zui_headless_font *font, i32 state) {
+#ifdef _WIN32
+    InterlockedExchange((volatile LONG*)&font->state, state);
+#else
+    __atomic_store_n(&font->state, state, __ATOMIC_RELEASE);
+#endif
+}
+
+static void _headless_load(zui_headless_font *font) {
+    u32 identity = 0;
+    font->loaded_height = _headless_reg_font(headless_ctx.args, font - headless_ctx.fonts, font->family, font->size, &identity);
+    font->identity = identity;
+    _headless_set_font_state(font, HEADLESS_FONT_LOADED);
+}
+#ifdef _WIN32
+static DWORD WINAPI _headless_load_thread(LPVOID font) { _headless_load(font); return 0; }
+#else
+static void *_headless_load_thread(void *font) { _headless_load(font); return 0; }
+#endif
+
+static u16 _headless_reg_font_async(zcmd_reg_font *cmd) {
+    if(cmd->font_id >= HEADLESS_MAX_FONTS) return 0;
+    zui_headless_font *font = &headless_ctx.fonts[cmd->font_id];
+    i32 len = strlen(cmd->family);
+    font->family = malloc(len + 1);
+    memcpy(font->family, cmd->family, len + 1);
+    font->size = cmd->size;
+    font->state = HEADLESS_FONT_LOADING;
+#ifdef _WIN32
+    font->thread = CreateThread(0, 0, _headless_load_thread, font, 0, 0);
+    bool started = font->thread != 0;
+#else
+    bool started = !pthread_create(&font->thread, 0, _headless_load_thread, font);
+#endif
+    if(!started) {
+        font->state = HEADLESS_FONT_IDLE;
+        free(font->family);
+        font->family = 0;
+        return _headless_reg_font(headless_ctx.args, cmd->font_id, cmd->family, cmd->size, &cmd->response_identity);
+    }
+    headless_ctx.loading++;
+    return ZFONT_PENDING;
+}
+
+static void _headless_join(zui_headless_font *font) {
+#ifdef _WIN32
+    WaitForSingleObject(font->thread, INFINITE);
+    CloseHandle(font->thread);
+#else
+    pthread_join(font->thread, 0);
+#endif
+    free(font->family);
+    font->family = 0;
+    font->state = HEADLESS_FONT_IDLE;
+    headless_ctx.loading--;
+}
+
+// fonts that finished loading since the last frame replace their estimates
+static void _headless_hand_over() {
+    for(i32 i = 0; headless_ctx.loading && i < HEADLESS_MAX_FONTS; i++) {
+        zui_headless_font *font = &headless_ctx.fonts[i];
+        if(_headless_font_state(font) != HEADLESS_FONT_LOADED) continue;
+        _headless_join(font);
+        zui_push((zccmd*)&(zccmd_font) { { ZCCMD_FONT, sizeof(zccmd_font) }, i, font->loaded_height, font->identity });
+    }
+}
+
+static zvec2 _headless_glyph_sz(u16 font_id, i32 codepoint) {
+    if(font_id >= HEADLESS_MAX_FONTS) return (zvec2) { 0, 0 };
+    zui_headless_font *font = &headless_ctx.fonts[font_id];
+    if(_headless_font_state(font)) return (zvec2) { 0, 0 }; // zui doesn't ask before it's handed over
+    if(!font->data) return (zvec2) { font->fixed_width, font->height };
+    i32 advance, bearing;
+    stbtt_GetCodepointHMetrics(&font->info, codepoint, &advance, &bearing);
+    return (zvec2) { (i16)(advance * font->scale + 0.5f), font->height };
+}
+
+static u64 _headless_ns() {
+    if(headless_ctx.fixed_clock)
+        return headless_ctx.clock += 1000;
+#ifdef _WIN32
+    LARGE_INTEGER ts, freq;
+    QueryPerformanceCounter(&ts);
+    QueryPerformanceFrequency(&freq);
+    return (ts.QuadPart / freq.QuadPart) * 1000000000 + (ts.QuadPart % freq.QuadPart) * 1000000000 / freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+static void _headless_close(zui_headless_args *args) {
+    if(!headless_ctx.running) return;
+    headless_ctx.running = false;
+    if(args->close) args->close(0);
+    for(i32 i = 0; i < HEADLESS_MAX_FONTS; i++) {
+        if(_headless_font_state(&headless_ctx.fonts[i])) _headless_join(&headless_ctx.fonts[i]);
+        free(headless_ctx.fonts[i].data);
+    }
+    free(headless_ctx.frame[0]);
+    free(headless_ctx.frame[1]);
+    free(headless_ctx.clipboard);
+    memset(&headless_ctx, 0, sizeof(headless_ctx));
+}
+
+static void _headless_setup(zui_headless_args *args) {
+    memset(&headless_ctx, 0, sizeof(headless_ctx));
+    headless_ctx.running = true;
+    headless_ctx.args = args;
+    headless_ctx.fixed_clock = args->fixed_clock;
+    zui_resize(args->width, args->height);
+    if(args->init) args->init(0);
+    if(!args->tick_manually) {
+        for(i32 i = 0; i < args->frames && headless_ctx.running; i++) {
+            if(headless_ctx.loading) _headless_hand_over();
+            args->frame(0);
+        }
+        _headless_close(args);
+    }
+}
+
+void headless_renderer(zcmd_any *cmd, void *user_data) {
+    zui_headless_args *args = user_data;
+    switch(cmd->base.id) {
+        case ZCMD_INIT: _headless_setup(args); break;
+        case ZCMD_TICK:
+        case ZCMD_TICK_BLOCKING:
+            if(headless_ctx.loading) _headless_hand_over();
+            if(headless_ctx.running) args->frame(0);
+            break;
+        case ZCMD_REDRAW: break;
+        case ZCMD_CLOSE: _headless_close(args); break;
+        case ZCMD_TIMESTAMP: cmd->timestamp.resp_ns = _headless_ns(); break;
+        case ZCMD_RENDER_BEGIN:
+            headless_ctx.used[0] = 0;
+            headless_ctx.cmds[0] = 0;
+            headless_ctx.hash[0] = 0xCBF29CE484222325ULL;
+            break;
+        case ZCMD_RENDER_END:
+            _headless_swap();
+            if(headless_ctx.loading) _headless_hand_over();
+            break;
+        case ZCMD_GET_CLIPBOARD: cmd->get_clipboard.response = headless_ctx.clipboard ? headless_ctx.clipboard : ""; break;
+        case ZCMD_SET_CLIPBOARD: {
+            i32 len = cmd->base.bytes - sizeof(zcmd_set_clipboard);
+            headless_ctx.clipboard = realloc(headless_ctx.clipboard, len + 1);
+            memcpy(headless_ctx.clipboard, cmd->set_clipboard.text, len);
+            headless_ctx.clipboard[len] = 0;
+        } break;
+        case ZCMD_REG_FONT:
+            if(args->async_fonts && headless_ctx.running)
+                cmd->font.response_height = _headless_reg_font_async(&cmd->font);
+            else
+                cmd->font.response_height = _headless_reg_font(args, cmd->font.font_id, cmd->font.family, cmd->font.size, &cmd->font.response_identity);
+            break;
+        case ZCMD_GLYPH_SZ:
+            cmd->glyph_sz.response = _headless_glyph_sz(cmd->glyph_sz.font_id, cmd->glyph_sz.codepoint);
+            break;
+        case ZCMD_DRAW_CLIP:
+        case ZCMD_DRAW_RECT:
+        case ZCMD_DRAW_TEXT:
+        case ZCMD_DRAW_LINES:
+        case ZCMD_DRAW_BEZIER:
+            _headless_record(cmd, args->record);
+            break;
+    }
+}
+#endif
+#endif
@@ -0,0 +1,406 @@
+#ifndef ZUI_INCLUDED
+#error Must include zui.h before zui-net.h
+#else
+// Remote UI over TCP. The application runs on the server, which lays out every frame and streams the
+// sorted draw commands to a thin client. The client draws them with any local backend and sends back
+// input and the metrics of the fonts and glyphs the server asked for.
+//
+// Wire format: every message is a zcmd (u16 id, u16 bytes) followed by its payload, padded to 4 bytes.
+// Server -> client messages use ZUI_CMDS ids, client -> server messages use ZUI_CLIENT_CMDS ids.
+// Both ends must be built from the same zui.h and have the same byte order.
+//
+// Metrics are pipelined: the server never waits on the client. A glyph it hasn't seen is queued as a
+// ZCMD_GLYPH_SZ request and laid out with an estimate (the average width of the font's known glyphs).
+// The client's ZCCMD_GLYPH answer replaces the estimate through zui_push and triggers another frame.
+// Fonts work the same way, ZCMD_REG_FONT is answered with size * 1.25 until ZCCMD_FONT arrives.
+#ifdef ZUI_IMPL
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef SOCKET znet_sock;
+#define ZNET_INVALID INVALID_SOCKET
+#define znet_poll WSAPoll
+#define znet_close closesocket
+#define ZNET_NOSIGNAL 0
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <time.h>
+typedef int znet_sock;
+#define ZNET_INVALID -1
+#define znet_poll poll
+#define znet_close close
+#ifdef MSG_NOSIGNAL
+#define ZNET_NOSIGNAL MSG_NOSIGNAL // a closed peer shouldn't kill the process with SIGPIPE
+#else
+#define ZNET_NOSIGNAL 0
+#endif
+#endif
+#else
+void net_renderer(zcmd_any *cmd, void *user_data);
+#endif
+typedef struct zui_net_args {
+    char *host;            // address to listen on, 0 for any
+    u16 port;
+    i32 frames;            // stop after this many frames, 0 to run until the client disconnects
+    zui_init_fn init;
+    zui_frame_fn frame;
+    zui_close_fn close;
+    bool tick_manually;
+} zui_net_args;
+
+typedef struct znet_buf { u8 *data; i32 used, cap; } znet_buf;
+
+typedef struct zui_net_client {
+    i64 sock;
+    zui_render_fn renderer; // local backend, draws the frames and answers ZCMD_REG_FONT / ZCMD_GLYPH_SZ
+    void *user_data;
+    znet_buf in, out;
+    i32 frames;             // frames received so far
+    bool connected;
+} zui_net_client;
+
+// connects to a server, <renderer> is called with every command the server sends
+bool net_client_connect(zui_net_client *client, char *host, u16 port, zui_render_fn renderer, void *user_data);
+// sends queued input, then waits up to <timeout_ms> (-1 forever) for the server.
+// Everything that arrived is handed to the renderer and answered.
+// returns the number of frames rendered, or -1 once the server is gone
+i32 net_client_poll(zui_net_client *client, i32 timeout_ms);
+// queues input for the server, sent by the next net_client_poll / net_client_flush
+void net_client_push(zui_net_client *client, zccmd *cmd);
+void net_client_flush(zui_net_client *client);
+void net_client_close(zui_net_client *client);
+
+#ifdef ZUI_IMPL
+#define NET_MAX_FONTS 64
+typedef struct zui_net_ctx {
+    znet_sock listener;
+    znet_sock sock;
+    znet_buf in, out;
+    u16 font_height[NET_MAX_FONTS];
+    i32 glyph_width_sum[NET_MAX_FONTS]; // widths the client reported, for estimates
+    i32 glyph_cnt[NET_MAX_FONTS];
+    char *clipboard;
+    bool has_size;
+    bool running;
+} zui_net_ctx;
+static zui_net_ctx net_ctx;
+
+static void _znet_reserve(znet_buf *buf, i32 bytes) {
+    if(buf->used + bytes <= buf->cap) return;
+    while(buf->used + bytes > buf->cap)
+        buf->cap = buf->cap ? buf->cap * 2 : 65536;
+    buf->data = realloc(buf->data, buf->cap);
+}
+
+// appends a message, padded so the next one stays 4 byte aligned
+static void _znet_write(znet_buf *buf, zcmd *cmd) {
+    i32 padded = (cmd->bytes + 3) & ~3;
+    _znet_reserve(buf, padded);
+    memcpy(buf->data + buf->used, cmd, cmd->bytes);
+    memset(buf->data + buf->used + cmd->bytes, 0, padded - cmd->bytes);
+    buf->used += padded;
+}
+
+static bool _znet_flush(znet_sock sock, znet_buf *buf) {
+    for(i32 sent = 0, n; sent < buf->used; sent += n) {
+        n = send(sock, (char*)buf->data + sent, buf->used - sent, ZNET_NOSIGNAL);
+        if(n <= 0) return false;
+    }
+    buf->used = 0;
+    return true;
+}
+
+// waits up to <timeout_ms> for data, then reads everything that's available. false once the peer closed
+static bool _znet_recv(znet_sock sock, znet_buf *buf, i32 timeout_ms) {
+    struct pollfd pfd = { .fd = sock, .events = POLLIN };
+    while(znet_poll(&pfd, 1, timeout_ms) > 0) {
+        _znet_reserve(buf, 65536);
+        i32 n = recv(sock, (char*)buf->data + buf->used, buf->cap - buf->used, 0);
+        if(n <= 0) return false;
+        buf->used += n;
+        timeout_ms = 0;
+    }
+    return true;
+}
+
+// returns the message at <*read> if it arrived completely
+static zcmd *_znet_next(znet_buf *buf, i32 *read) {
+    if(buf->used - *read < (i32)sizeof(zcmd)) return 0;
+    zcmd *cmd = (zcmd*)(buf->data + *read);
+    i32 padded = (cmd->bytes + 3) & ~3;
+    if(cmd->bytes < sizeof(zcmd) || buf->used - *read < padded) return 0;
+    *read += padded;
+    return cmd;
+}
+
+// drops the messages before <read>, keeps a partial one at the front of the buffer
+static void _znet_consume(znet_buf *buf, i32 read) {
+    memmove(buf->data, buf->data + read, buf->used - read);
+    buf->used -= read;
+}
+
+static void _znet_nodelay(znet_sock sock) {
+    i32 one = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (char*)&one, sizeof(one));
+}
+
+static void _znet_startup() {
+#ifdef _WIN32
+    WSADATA wsa;
+    WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+}
+
+static u64 _net_ns() {
+#ifdef _WIN32
+    LARGE_INTEGER ts, freq;
+    QueryPerformanceCounter(&ts);
+    QueryPerformanceFrequency(&freq);
+    return (ts.QuadPart / freq.QuadPart) * 1000000000 + (ts.QuadPart % freq.QuadPart) * 1000000000 / freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+// SERVER
+
+static void _net_apply(zccmd *cmd) {
+    switch(cmd->base.id) {
+        case ZCCMD_GLYPH:
+            if(cmd->glyph.font_id < NET_MAX_FONTS) {
+                net_ctx.glyph_width_sum[cmd->glyph.font_id] += cmd->glyph.sz.x;
+                net_ctx.glyph_cnt[cmd->glyph.font_id]++;
+            }
+            zui_push(cmd);
+            break;
+        case ZCCMD_FONT:
+            if(cmd->font.font_id < NET_MAX_FONTS)
+                net_ctx.font_height[cmd->font.font_id] = cmd->font.height;
+            zui_push(cmd);
+            break;
+        case ZCCMD_WIN:
+            net_ctx.has_size = true;
+            zui_push(cmd);
+            break;
+        case ZCCMD_CLIPBOARD: {
+            i32 len = cmd->base.bytes - sizeof(zccmd_clipboard);
+            net_ctx.clipboard = realloc(net_ctx.clipboard, len + 1);
+            memcpy(net_ctx.clipboard, cmd->clipboard.text, len);
+            net_ctx.clipboard[len] = 0;
+        } break;
+        case ZCCMD_CLOSE: net_ctx.running = false; break;
+        default: zui_push(cmd); break;
+    }
+}
+
+// sends what's queued, then applies everything the client sent within <timeout_ms>
+static void _net_pump(i32 timeout_ms) {
+    if(!net_ctx.running) return;
+    if(!_znet_flush(net_ctx.sock, &net_ctx.out) || !_znet_recv(net_ctx.sock, &net_ctx.in, timeout_ms))
+        net_ctx.running = false;
+    i32 read = 0;
+    for(zcmd *cmd; (cmd = _znet_next(&net_ctx.in, &read));)
+        _net_apply((zccmd*)cmd);
+    _znet_consume(&net_ctx.in, read);
+}
+
+static bool _net_listen(zui_net_args *args) {
+    _znet_startup();
+    struct sockaddr_in addr = { 0 };
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(args->port);
+    addr.sin_addr.s_addr = args->host ? inet_addr(args->host) : htonl(INADDR_ANY);
+    net_ctx.listener = socket(AF_INET, SOCK_STREAM, 0);
+    if(net_ctx.listener == ZNET_INVALID) return false;
+    i32 one = 1;
+    setsockopt(net_ctx.listener, SOL_SOCKET, SO_REUSEADDR, (char*)&one, sizeof(one));
+    if(bind(net_ctx.listener, (struct sockaddr*)&addr, sizeof(addr)) || listen(net_ctx.listener, 1)) {
+        zui_log("net: couldn't listen on port %d\n", args->port);
+        return false;
+    }
+    net_ctx.sock = accept(net_ctx.listener, 0, 0);
+    if(net_ctx.sock == ZNET_INVALID) return false;
+    _znet_nodelay(net_ctx.sock);
+    return true;
+}
+
+static void _net_close(zui_net_args *args) {
+    if(net_ctx.listener == ZNET_INVALID) return;
+    net_ctx.running = false;
+    if(args->close) args->close(0);
+    zcmd bye = { ZCMD_CLOSE, sizeof(zcmd) };
+    _znet_write(&net_ctx.out, &bye);
+    _znet_flush(net_ctx.sock, &net_ctx.out);
+    znet_close(net_ctx.sock);
+    znet_close(net_ctx.listener);
+    free(net_ctx.in.data);
+    free(net_ctx.out.data);
+    free(net_ctx.clipboard);
+    memset(&net_ctx, 0, sizeof(net_ctx));
+    net_ctx.listener = net_ctx.sock = ZNET_INVALID;
+}
+
+static void _net_setup(zui_net_args *args) {
+    memset(&net_ctx, 0, sizeof(net_ctx));
+    net_ctx.listener = net_ctx.sock = ZNET_INVALID;
+    if(!_net_listen(args)) return;
+    net_ctx.running = true;
+    // the client's first message is its window size
+    while(net_ctx.running && !net_ctx.has_size)
+        _net_pump(-1);
+    if(args->init) args->init(0);
+    if(!args->tick_manually) {
+        // a frame per batch of client messages. Metric answers arrive as a batch too, so the
+        // frames laid out with estimates are followed by one with the real metrics
+        for(i32 i = 0; net_ctx.running && (!args->frames || i < args->frames); i++) {
+            args->frame(0);
+            _net_pump(-1);
+        }
+        _net_close(args);
+    }
+}
+
+static i16 _net_glyph_estimate(u16 font_id) {
+    if(font_id >= NET_MAX_FONTS) return 0;
+    if(net_ctx.glyph_cnt[font_id])
+        return net_ctx.glyph_width_sum[font_id] / net_ctx.glyph_cnt[font_id];
+    return net_ctx.font_height[font_id] / 2;
+}
+
+void net_renderer(zcmd_any *cmd, void *user_data) {
+    zui_net_args *args = user_data;
+    switch(cmd->base.id) {
+        case ZCMD_INIT: _net_setup(args); break;
+        case ZCMD_TICK: _net_pump(0); if(net_ctx.running) args->frame(0); break;
+        case ZCMD_TICK_BLOCKING: _net_pump(-1); if(net_ctx.running) args->frame(0); break;
+        case ZCMD_REDRAW: break;
+        case ZCMD_CLOSE: _net_close(args); break;
+        case ZCMD_TIMESTAMP: cmd->timestamp.resp_ns = _net_ns(); break;
+        case ZCMD_GET_CLIPBOARD: cmd->get_clipboard.response = net_ctx.clipboard ? net_ctx.clipboard : ""; break;
+        case ZCMD_REG_FONT:
+            _znet_write(&net_ctx.out, &cmd->base);
+            cmd->font.response_height = cmd->font.size + cmd->font.size / 4;
+            if(cmd->font.font_id < NET_MAX_FONTS)
+                net_ctx.font_height[cmd->font.font_id] = cmd->font.response_height;
+            break;
+        case ZCMD_GLYPH_SZ:
+            _znet_write(&net_ctx.out, &cmd->base);
+            cmd->glyph_sz.response = (zvec2) { _net_glyph_estimate(cmd->glyph_sz.font_id), 0 };
+            if(cmd->glyph_sz.font_id < NET_MAX_FONTS)
+                cmd->glyph_sz.response.y = net_ctx.font_height[cmd->glyph_sz.font_id];
+            break;
+        case ZCMD_RENDER_END:
+            _znet_write(&net_ctx.out, &cmd->base);
+            if(net_ctx.running && !_znet_flush(net_ctx.sock, &net_ctx.out))
+                net_ctx.running = false;
+            break;
+        case ZCMD_RENDER_BEGIN:
+        case ZCMD_SET_CLIPBOARD:
+        case ZCMD_DRAW_CLIP:
+        case ZCMD_DRAW_RECT:
+        case ZCMD_DRAW_TEXT:
+        case ZCMD_DRAW_LINES:
+        case ZCMD_DRAW_BEZIER:
+            _znet_write(&net_ctx.out, &cmd->base);
+            break;
+    }
+}
+
+// CLIENT
+
+bool net_client_connect(zui_net_client *client, char *host, u16 port, zui_render_fn renderer, void *user_data) {
+    _znet_startup();
+    memset(client, 0, sizeof(*client));
+    client->sock = (i64)ZNET_INVALID;
+    client->renderer = renderer;
+    client->user_data = user_data;
+    struct sockaddr_in addr = { 0 };
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr(host);
+    znet_sock sock = socket(AF_INET, SOCK_STREAM, 0);
+    if(sock == ZNET_INVALID) return false;
+    if(connect(sock, (struct sockaddr*)&addr, sizeof(addr))) {
+        znet_close(sock);
+        return false;
+    }
+    _znet_nodelay(sock);
+    client->sock = (i64)sock;
+    client->connected = true;
+    return true;
+}
+
+void net_client_push(zui_net_client *client, zccmd *cmd) {
+    _znet_write(&client->out, &cmd->base);
+}
+
+void net_client_flush(zui_net_client *client) {
+    if(client->connected && !_znet_flush((znet_sock)client->sock, &client->out))
+        client->connected = false;
+}
+
+static void _net_client_handle(zui_net_client *client, zcmd_any *cmd) {
+    switch(cmd->base.id) {
+        case ZCMD_REG_FONT: {
+            cmd->font.response_height = 0;
+            client->renderer(cmd, client->user_data);
+            zccmd_font font = { { ZCCMD_FONT, sizeof(zccmd_font) }, cmd->font.font_id, cmd->font.response_height, cmd->font.response_identity };
+            _znet_write(&client->out, &font.header);
+        } break;
+        case ZCMD_GLYPH_SZ: {
+            client->renderer(cmd, client->user_data);
+            zccmd_glyph glyph = { { ZCCMD_GLYPH, sizeof(zccmd_glyph) }, cmd->glyph_sz.font_id, cmd->glyph_sz.codepoint, cmd->glyph_sz.response };
+            _znet_write(&client->out, &glyph.header);
+        } break;
+        case ZCMD_CLOSE: client->connected = false; break;
+        case ZCMD_RENDER_END:
+            client->renderer(cmd, client->user_data);
+            client->frames++;
+            break;
+        default: client->renderer(cmd, client->user_data); break;
+    }
+}
+
+i32 net_client_poll(zui_net_client *client, i32 timeout_ms) {
+    net_client_flush(client);
+    if(!client->connected) return -1;
+    if(!_znet_recv((znet_sock)client->sock, &client->in, timeout_ms))
+        client->connected = false;
+    i32 frames = client->frames, read = 0;
+    for(zcmd *cmd; (cmd = _znet_next(&client->in, &read));)
+        _net_client_handle(client, (zcmd_any*)cmd);
+    _znet_consume(&client->in, read);
+    // answers go out right away, the server is already laying out with estimates
+    net_client_flush(client);
+    if(!client->connected && client->frames == frames) return -1;
+    return client->frames - frames;
+}
+
+void net_client_close(zui_net_client *client) {
+    if(client->connected) {
+        zcmd bye = { ZCCMD_CLOSE, sizeof(zcmd) };
+        _znet_write(&client->out, &bye);
+        net_client_flush(client);
+    }
+    if((znet_sock)client->sock != ZNET_INVALID)
+        znet_close((znet_sock)client->sock);
+    client->sock = (i64)ZNET_INVALID;
+    client->connected = false;
+    free(client->in.data);
+    free(client->out.data);
+    memset(&client->in, 0, sizeof(client->in));
+    memset(&client->out, 0, sizeof(client->out));
+}
+#endif
+#endif
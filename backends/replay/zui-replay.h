@@ -0,0 +1,256 @@
+#ifndef ZUI_INCLUDED
+#error Must include zui.h before zui-replay.h
+#else
+// Replay renderer. Plays back a recording made with zui_record_start: inputs and renderer responses (glyph sizes,
+// font heights, timestamps) are fed back at the point of the frame they happened, while the application runs the
+// same frame function it ran when recording. No display and no font files are needed, so a session recorded in
+// production replays on a CI machine at full speed.
+//
+// Every replayed frame is compared to its recorded ZRCMD_FRAME: the hash of the draw commands (recordings made
+// with ZREC_OUTPUT) and the per-phase timings, which are summed in the result.
+// The recording is memory mapped and read in place.
+#ifdef ZUI_IMPL
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#else
+void replay_renderer(zcmd_any *cmd, void *user_data);
+#endif
+typedef struct zui_replay_args {
+    char *path;
+    zui_init_fn init;
+    zui_frame_fn frame;   // must call zui_render once, like it did when the session was recorded
+    zui_close_fn close;
+    bool tick_manually;   // zui_init only opens the recording, frames are replayed with replay_step
+} zui_replay_args;
+
+typedef struct zui_replay_result {
+    bool opened;
+    u32 frames;           // frames replayed
+    u32 recorded;         // frames in the recording
+    u32 mismatches;       // frames whose draw commands hash differently than when recorded
+    i32 first_mismatch;   // -1 if none
+    u32 diverged;         // queries that didn't match the next recorded response, the app took another path
+    i64 recorded_ns[ZP_LAST];
+    i64 replayed_ns[ZP_LAST];
+} zui_replay_result;
+
+// replays the next frame, returns false at the end of the recording
+bool replay_step();
+zui_replay_result *replay_result();
+
+#ifdef ZUI_IMPL
+typedef struct zui_replay_ctx {
+    zui_replay_args *args;
+    zui_replay_result result;
+    u8 *data;
+    i64 len;
+    i64 pos;
+    zrec_header *header;
+    u64 hash;
+#ifdef _WIN32
+    HANDLE file, mapping;
+#endif
+} zui_replay_ctx;
+static zui_replay_ctx replay_ctx;
+
+zui_replay_result *replay_result() { return &replay_ctx.result; }
+
+// next record, 0 at the end or if it's truncated
+static zcmd *_replay_peek() {
+    if(replay_ctx.pos + (i64)sizeof(zcmd) > replay_ctx.len) return 0;
+    zcmd *rec = (zcmd*)(replay_ctx.data + replay_ctx.pos);
+    if(rec->bytes < sizeof(zcmd) || replay_ctx.pos + rec->bytes > replay_ctx.len) return 0;
+    return rec;
+}
+static void _replay_skip(zcmd *rec) {
+    replay_ctx.pos += (rec->bytes + 7) & ~7;
+}
+// inputs are everything zui_push takes, responses and frame ends come after them
+static bool _replay_is_input(u16 id) {
+    return id <= ZRCMD_GLYPHS;
+}
+// applies the inputs up to the next response or frame end, which is returned
+static zcmd *_replay_inputs() {
+    zcmd *rec;
+    while((rec = _replay_peek()) && _replay_is_input(rec->id)) {
+        zui_push((zccmd*)rec);
+        _replay_skip(rec);
+    }
+    return rec;
+}
+// the response to a query of type <id>, or 0 if the recording took another path at this point
+static zcmd *_replay_response(u16 id) {
+    zcmd *rec = _replay_inputs();
+    if(!rec || rec->id != id) {
+        replay_ctx.result.diverged++;
+        return 0;
+    }
+    _replay_skip(rec);
+    return rec;
+}
+
+static zvec2 _replay_glyph(u16 font_id, i32 codepoint) {
+    zccmd_glyph *glyph = (zccmd_glyph*)_replay_response(ZRCMD_GLYPH_SZ);
+    if(glyph && glyph->font_id == font_id && glyph->codepoint == codepoint)
+        return glyph->sz;
+    if(glyph) replay_ctx.result.diverged++;
+    i32 height = zui_text_height(font_id);
+    return (zvec2) { height / 2, height };
+}
+
+static u16 _replay_font(u16 font_id) {
+    // fonts registered before the recording started aren't in it, their height is in the glyph cache snapshot
+    if(font_id < replay_ctx.header->font_cnt) return zui_text_height(font_id);
+    zccmd_font *font = (zccmd_font*)_replay_response(ZRCMD_REG_FONT);
+    if(font && font->font_id == font_id) return font->height;
+    if(font) replay_ctx.result.diverged++;
+    return 0;
+}
+
+static u64 _replay_ts() {
+    zrcmd_timestamp *ts = (zrcmd_timestamp*)_replay_response(ZRCMD_TIMESTAMP);
+    return ts ? ts->ns : 0;
+}
+
+bool replay_step() {
+    zui_replay_result *r = &replay_ctx.result;
+    if(!replay_ctx.data || !_replay_inputs()) return false;
+    replay_ctx.args->frame(0);
+    // anything the app didn't ask for this time is skipped up to the end of the frame
+    zcmd *rec;
+    while((rec = _replay_inputs()) && rec->id != ZRCMD_FRAME) {
+        r->diverged++;
+        _replay_skip(rec);
+    }
+    if(!rec) return false;
+    zrcmd_frame *frame = (zrcmd_frame*)rec;
+    zui_stats *stats = zui_get_stats();
+    if(replay_ctx.header->flags & ZREC_OUTPUT && frame->hash != replay_ctx.hash) {
+        if(!r->mismatches++) r->first_mismatch = r->frames;
+    }
+    for(i32 i = 0; i < ZP_LAST; i++) {
+        r->recorded_ns[i] += frame->ns[i];
+        r->replayed_ns[i] += stats->ns[i];
+    }
+    r->frames++;
+    _replay_skip(rec);
+    return true;
+}
+
+static void _replay_unmap() {
+    if(!replay_ctx.data) return;
+#ifdef _WIN32
+    UnmapViewOfFile(replay_ctx.data);
+    CloseHandle(replay_ctx.mapping);
+    CloseHandle(replay_ctx.file);
+#else
+    munmap(replay_ctx.data, replay_ctx.len);
+#endif
+    replay_ctx.data = 0;
+}
+
+static bool _replay_map(char *path) {
+#ifdef _WIN32
+    replay_ctx.file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if(replay_ctx.file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    GetFileSizeEx(replay_ctx.file, &size);
+    replay_ctx.len = size.QuadPart;
+    replay_ctx.mapping = CreateFileMappingA(replay_ctx.file, 0, PAGE_READONLY, 0, 0, 0);
+    if(replay_ctx.mapping) replay_ctx.data = MapViewOfFile(replay_ctx.mapping, FILE_MAP_READ, 0, 0, 0);
+    if(!replay_ctx.data) {
+        if(replay_ctx.mapping) CloseHandle(replay_ctx.mapping);
+        CloseHandle(replay_ctx.file);
+        return false;
+    }
+#else
+    i32 fd = open(path, O_RDONLY);
+    if(fd < 0) return false;
+    struct stat st;
+    if(fstat(fd, &st) || st.st_size < (off_t)sizeof(zrec_header)) {
+        close(fd);
+        return false;
+    }
+    replay_ctx.len = st.st_size;
+    replay_ctx.data = mmap(0, replay_ctx.len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(replay_ctx.data == MAP_FAILED) {
+        replay_ctx.data = 0;
+        return false;
+    }
+    madvise(replay_ctx.data, replay_ctx.len, MADV_SEQUENTIAL);
+#endif
+    return true;
+}
+
+static void _replay_close(zui_replay_args *args) {
+    if(!replay_ctx.data) return;
+    if(args->close) args->close(0);
+    _replay_unmap();
+}
+
+static void _replay_setup(zui_replay_args *args) {
+    memset(&replay_ctx, 0, sizeof(replay_ctx));
+    replay_ctx.args = args;
+    replay_ctx.result.first_mismatch = -1;
+    if(!_replay_map(args->path)) {
+        zui_log("replay: couldn't open %s\n", args->path);
+        return;
+    }
+    replay_ctx.header = (zrec_header*)replay_ctx.data;
+    if(replay_ctx.len < (i64)sizeof(zrec_header) || replay_ctx.header->magic != ZREC_MAGIC || replay_ctx.header->version != ZREC_VERSION) {
+        zui_log("replay: %s isn't a recording\n", args->path);
+        _replay_unmap();
+        return;
+    }
+    zrec_header *h = replay_ctx.header;
+    replay_ctx.pos = sizeof(zrec_header);
+    replay_ctx.result.opened = true;
+    replay_ctx.result.recorded = h->frames;
+    // restore the state the recording started from: inputs, then the glyph cache snapshot
+    zui_push((zccmd*)&(zccmd_win) { { ZCCMD_WIN, sizeof(zccmd_win) }, h->window_sz });
+    zui_push((zccmd*)&(zccmd_mouse) { { ZCCMD_MOUSE, sizeof(zccmd_mouse) }, h->mouse_pos, h->mouse_state });
+    zui_push((zccmd*)&(zccmd_keys) { { ZCCMD_KEYS, sizeof(zccmd_keys) }, 0, h->keyboard_modifiers });
+    zcmd *rec;
+    while((rec = _replay_peek()) && rec->id == ZRCMD_GLYPHS) {
+        zui_push((zccmd*)rec);
+        _replay_skip(rec);
+    }
+    if(args->init) args->init(0);
+    if(!args->tick_manually) {
+        while(replay_step());
+        _replay_close(args);
+    }
+}
+
+void replay_renderer(zcmd_any *cmd, void *user_data) {
+    zui_replay_args *args = user_data;
+    switch(cmd->base.id) {
+        case ZCMD_INIT: _replay_setup(args); break;
+        case ZCMD_CLOSE: _replay_close(args); break;
+        case ZCMD_TIMESTAMP: cmd->timestamp.resp_ns = _replay_ts(); break;
+        case ZCMD_REG_FONT: cmd->font.response_height = _replay_font(cmd->font.font_id); break;
+        case ZCMD_GLYPH_SZ: cmd->glyph_sz.response = _replay_glyph(cmd->glyph_sz.font_id, cmd->glyph_sz.codepoint); break;
+        case ZCMD_RENDER_BEGIN: replay_ctx.hash = 0xCBF29CE484222325ULL; break;
+        case ZCMD_DRAW_CLIP:
+        case ZCMD_DRAW_RECT:
+        case ZCMD_DRAW_TEXT:
+        case ZCMD_DRAW_LINES:
+        case ZCMD_DRAW_BEZIER:
+            for(i32 i = 0; i < cmd->base.bytes; i++)
+                replay_ctx.hash = (replay_ctx.hash ^ ((u8*)cmd)[i]) * 0x100000001B3ULL;
+            break;
+    }
+}
+#endif
+#endif
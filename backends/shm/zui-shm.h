@@ -0,0 +1,530 @@
+#ifndef ZUI_INCLUDED
+#error Must include zui.h before zui-shm.h
+#else
+// Out-of-process rendering over shared memory. The application runs in one process and a renderer process
+// draws its frames, so a crash in the renderer (driver, font library) doesn't take the UI down and vice versa.
+//
+// Both processes map one shared block (memfd, or an unlinked shm_open object) holding two single producer /
+// single consumer rings:
+//  - commands: the sorted zcmd stream of every frame, plus glyph / font / timestamp queries
+//  - responses: answers to those queries and input, as the zccmd zui_push takes (timestamps as zrcmd_timestamp)
+// Messages are a zcmd padded to 8 bytes and never wrap around the end of a ring, so the renderer is handed
+// commands in place without copying them out. Each ring has a head the producer publishes and a tail the
+// consumer publishes, on separate cache lines, read and written with acquire / release atomics and no locks.
+// Commands are published once per frame and before a query, not per command.
+//
+// Queries are synchronous: the renderer owns the fonts and the clock, and a round trip through shared memory
+// costs microseconds. Input arriving while the application waits for an answer is kept for the next frame.
+// The application keeps at most two frames in flight.
+//
+// POSIX only. The renderer process is spawned with the shared block's descriptor in ZUI_SHM_FD, see
+// zui_shm_args.consumer and shm_client_open.
+#ifdef ZUI_IMPL
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#else
+void shm_renderer(zcmd_any *cmd, void *user_data);
+#endif
+typedef struct zui_shm_args {
+    char **consumer;       // argv of the renderer process to spawn, 0 if the application starts it itself
+    i32 ring_size;         // bytes of the command ring, rounded up to a power of two. Default 4MB
+    i32 frames;            // stop after this many frames, 0 to run until the renderer closes
+    zui_init_fn init;
+    zui_frame_fn frame;
+    zui_close_fn close;
+    bool tick_manually;
+} zui_shm_args;
+
+typedef struct zui_shm_stats {
+    u64 bytes;             // command bytes written
+    u32 frames;
+    u32 queries;           // round trips to the renderer
+    u64 query_ns;          // time spent waiting for their answers
+    u32 stalls;            // times the command ring was full
+} zui_shm_stats;
+
+typedef struct zshm_ring {
+    u32 head;              // bytes ever published by the producer
+    u8 pad0[60];
+    u32 tail;              // bytes ever released by the consumer
+    u8 pad1[60];
+    u32 cap;               // power of two
+    u32 offset;            // of the data, from the start of the block
+    u8 pad2[56];
+} zshm_ring;
+
+typedef struct zshm_header {
+    u32 magic;
+    u32 size;
+    i32 server_pid;
+    i32 client_pid;
+    u32 closed;            // set by the side that leaves
+    u8 pad[44];
+    zshm_ring cmds;
+    zshm_ring responses;
+} zshm_header;
+
+// one end of a ring, <pos> is the producer's unpublished head or the consumer's unreleased tail
+typedef struct zshm_end { zshm_ring *ring; u8 *data; u32 pos; } zshm_end;
+
+typedef struct zui_shm_client {
+    zshm_header *shm;
+    zshm_end cmds, responses;
+    zui_render_fn renderer; // local backend, draws the frames and answers ZCMD_REG_FONT / ZCMD_GLYPH_SZ / ZCMD_TIMESTAMP
+    void *user_data;
+    i32 frames;             // frames rendered so far
+    bool connected;
+} zui_shm_client;
+
+zui_shm_stats *shm_stats();
+// exit status of the spawned renderer once the application closed, -1 if it's unknown
+i32 shm_consumer_status();
+
+// maps the block created by the application. <fd> -1 reads it from ZUI_SHM_FD
+bool shm_client_open(zui_shm_client *client, i32 fd, zui_render_fn renderer, void *user_data);
+// waits up to <timeout_ms> (-1 forever) for commands, hands everything that arrived to the renderer and answers
+// the queries. returns the number of frames rendered, or -1 once the application is gone
+i32 shm_client_poll(zui_shm_client *client, i32 timeout_ms);
+// sends input to the application
+void shm_client_push(zui_shm_client *client, zccmd *cmd);
+void shm_client_close(zui_shm_client *client);
+
+#ifdef ZUI_IMPL
+#define ZSHM_MAGIC 0x4D48535A // "ZSHM"
+#define ZSHM_WRAP  0xFFFF     // the rest of the ring up to its end is unused
+#define ZSHM_RESPONSES (64 * 1024)
+
+typedef struct zui_shm_ctx {
+    zshm_header *shm;
+    zshm_end cmds, responses;
+    u8 *pending;            // input that arrived while waiting for an answer
+    i32 pending_used, pending_cap;
+    u32 frame_end[2];       // command ring positions after the last two frames
+    u64 answer[4];          // copy of the last query's answer
+    zui_shm_stats stats;
+    char *clipboard;
+    pid_t child;
+    i32 status;
+    bool has_size;
+    bool running;
+} zui_shm_ctx;
+static zui_shm_ctx shm_ctx;
+
+zui_shm_stats *shm_stats() { return &shm_ctx.stats; }
+i32 shm_consumer_status() { return shm_ctx.status; }
+
+static u64 _shm_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static bool _shm_alive(zshm_header *shm, i32 pid) {
+    if(__atomic_load_n(&shm->closed, __ATOMIC_ACQUIRE)) return false;
+    if(pid > 0 && pid == shm_ctx.child) { // a spawned renderer that crashed stays a zombie until waited for
+        i32 status;
+        if(waitpid(pid, &status, WNOHANG) != pid) return true;
+        shm_ctx.status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+        shm_ctx.child = 0;
+        return false;
+    }
+    return !pid || kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+// spins briefly, then sleeps. Checks every few ms that the other side is still there
+static bool _shm_wait(zshm_header *shm, i32 pid, i32 *spins) {
+    i32 n = (*spins)++;
+    if(n < 64) return true;
+    if(n < 128) {
+        sched_yield();
+        return true;
+    }
+    struct timespec ts = { 0, 20000 };
+    nanosleep(&ts, 0);
+    return n % 128 || _shm_alive(shm, pid);
+}
+
+static void _shm_publish(zshm_end *end) {
+    __atomic_store_n(&end->ring->head, end->pos, __ATOMIC_RELEASE);
+}
+
+static void _shm_release(zshm_end *end) {
+    __atomic_store_n(&end->ring->tail, end->pos, __ATOMIC_RELEASE);
+}
+
+// copies a message into the ring, waiting for the consumer if it's full. false if the consumer is gone
+static bool _shm_write(zshm_header *shm, zshm_end *end, i32 pid, zcmd *cmd, u32 *stalls) {
+    zshm_ring *r = end->ring;
+    u32 padded = (cmd->bytes + 7) & ~7, at = end->pos & (r->cap - 1), contiguous = r->cap - at;
+    u32 need = padded + (contiguous < padded ? contiguous : 0);
+    if(r->cap - (end->pos - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE)) < need) {
+        _shm_publish(end); // the consumer may be waiting for what's written so far
+        if(stalls) (*stalls)++;
+        for(i32 spins = 0; r->cap - (end->pos - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE)) < need;)
+            if(!_shm_wait(shm, pid, &spins)) return false;
+    }
+    if(contiguous < padded) {
+        ((zcmd*)(end->data + at))->id = ZSHM_WRAP;
+        end->pos += contiguous;
+        at = 0;
+    }
+    memcpy(end->data + at, cmd, cmd->bytes);
+    memset(end->data + at + cmd->bytes, 0, padded - cmd->bytes);
+    end->pos += padded;
+    return true;
+}
+
+// the next published message or 0. The consumer releases it with _shm_release once it's done with it
+static zcmd *_shm_next(zshm_end *end) {
+    zshm_ring *r = end->ring;
+    u32 head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+    while(end->pos != head) {
+        u32 at = end->pos & (r->cap - 1);
+        zcmd *cmd = (zcmd*)(end->data + at);
+        if(cmd->id == ZSHM_WRAP) {
+            end->pos += r->cap - at;
+            continue;
+        }
+        end->pos += (cmd->bytes + 7) & ~7;
+        return cmd;
+    }
+    return 0;
+}
+
+static void _shm_end(zshm_header *shm, zshm_ring *ring, zshm_end *end) {
+    end->ring = ring;
+    end->data = (u8*)shm + ring->offset;
+    end->pos = 0;
+}
+
+// SERVER
+
+static void _shm_apply(zccmd *cmd) {
+    switch(cmd->base.id) {
+        case ZCCMD_WIN:
+            shm_ctx.has_size = true;
+            zui_push(cmd);
+            break;
+        case ZCCMD_CLIPBOARD: {
+            i32 len = cmd->base.bytes - sizeof(zccmd_clipboard);
+            shm_ctx.clipboard = realloc(shm_ctx.clipboard, len + 1);
+            memcpy(shm_ctx.clipboard, cmd->clipboard.text, len);
+            shm_ctx.clipboard[len] = 0;
+        } break;
+        case ZCCMD_CLOSE: shm_ctx.running = false; break;
+        default: zui_push(cmd); break;
+    }
+}
+
+static void _shm_keep(zcmd *cmd) {
+    if(shm_ctx.pending_used + cmd->bytes > shm_ctx.pending_cap) {
+        while(shm_ctx.pending_used + cmd->bytes > shm_ctx.pending_cap)
+            shm_ctx.pending_cap = shm_ctx.pending_cap ? shm_ctx.pending_cap * 2 : 4096;
+        shm_ctx.pending = realloc(shm_ctx.pending, shm_ctx.pending_cap);
+    }
+    memcpy(shm_ctx.pending + shm_ctx.pending_used, cmd, cmd->bytes);
+    shm_ctx.pending_used += (cmd->bytes + 7) & ~7;
+}
+
+// applies the input that arrived since the last frame
+static void _shm_pump() {
+    if(!shm_ctx.running) return;
+    for(i32 i = 0; i < shm_ctx.pending_used; i += (((zcmd*)(shm_ctx.pending + i))->bytes + 7) & ~7)
+        _shm_apply((zccmd*)(shm_ctx.pending + i));
+    shm_ctx.pending_used = 0;
+    for(zcmd *cmd; (cmd = _shm_next(&shm_ctx.responses));)
+        _shm_apply((zccmd*)cmd);
+    _shm_release(&shm_ctx.responses);
+    if(!_shm_alive(shm_ctx.shm, shm_ctx.shm->client_pid))
+        shm_ctx.running = false;
+}
+
+static bool _shm_send(zcmd *cmd) {
+    if(!shm_ctx.running) return false;
+    shm_ctx.stats.bytes += cmd->bytes;
+    if(!_shm_write(shm_ctx.shm, &shm_ctx.cmds, shm_ctx.shm->client_pid, cmd, &shm_ctx.stats.stalls))
+        shm_ctx.running = false;
+    return shm_ctx.running;
+}
+
+// sends a query and waits for the answer with id <answer>. Everything read is released right away, the
+// renderer may have more answers to write than the response ring holds
+static zcmd *_shm_query(zcmd *cmd, u16 answer) {
+    if(!_shm_send(cmd)) return 0;
+    _shm_publish(&shm_ctx.cmds);
+    u64 start = _shm_ns();
+    shm_ctx.stats.queries++;
+    zcmd *res = 0;
+    for(i32 spins = 0; !res;) {
+        zcmd *next = _shm_next(&shm_ctx.responses);
+        if(!next) {
+            if(!_shm_wait(shm_ctx.shm, shm_ctx.shm->client_pid, &spins)) break;
+        } else if(next->id == answer && next->bytes <= sizeof(shm_ctx.answer)) {
+            memcpy(shm_ctx.answer, next, next->bytes);
+            res = (zcmd*)shm_ctx.answer;
+        } else {
+            _shm_keep(next);
+        }
+        _shm_release(&shm_ctx.responses);
+    }
+    shm_ctx.stats.query_ns += _shm_ns() - start;
+    if(!res) shm_ctx.running = false;
+    return res;
+}
+
+// waits until the renderer is done with the frame before the last one
+static void _shm_pace() {
+    u32 end = shm_ctx.frame_end[0];
+    for(i32 spins = 0; shm_ctx.running && (i32)(__atomic_load_n(&shm_ctx.cmds.ring->tail, __ATOMIC_ACQUIRE) - end) < 0;)
+        if(!_shm_wait(shm_ctx.shm, shm_ctx.shm->client_pid, &spins)) shm_ctx.running = false;
+}
+
+static zshm_header *_shm_create(i32 cmd_size, i32 *fd) {
+    u32 cap = 4096, offset = (sizeof(zshm_header) + 4095) & ~4095;
+    while(cap < (u32)cmd_size) cap *= 2;
+    u32 size = offset + cap + ZSHM_RESPONSES;
+#ifdef SYS_memfd_create
+    *fd = syscall(SYS_memfd_create, "zui-shm", 0);
+#else
+    char name[64];
+    snprintf(name, sizeof(name), "/zui-shm-%d", (i32)getpid());
+    *fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    shm_unlink(name);
+#endif
+    if(*fd < 0) return 0;
+    if(ftruncate(*fd, size)) {
+        close(*fd);
+        return 0;
+    }
+    zshm_header *shm = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+    if(shm == MAP_FAILED) {
+        close(*fd);
+        return 0;
+    }
+    memset(shm, 0, sizeof(*shm));
+    shm->magic = ZSHM_MAGIC;
+    shm->size = size;
+    shm->server_pid = getpid();
+    shm->cmds.cap = cap;
+    shm->cmds.offset = offset;
+    shm->responses.cap = ZSHM_RESPONSES;
+    shm->responses.offset = offset + cap;
+    return shm;
+}
+
+static pid_t _shm_spawn(char **argv, i32 fd) {
+    pid_t pid = fork();
+    if(pid) return pid;
+    char value[16];
+    snprintf(value, sizeof(value), "%d", fd);
+    setenv("ZUI_SHM_FD", value, 1);
+    execvp(argv[0], argv);
+    _exit(127);
+}
+
+static void _shm_close(zui_shm_args *args) {
+    if(!shm_ctx.shm) return;
+    shm_ctx.running = false;
+    if(args->close) args->close(0);
+    zcmd bye = { ZCMD_CLOSE, sizeof(zcmd) };
+    _shm_write(shm_ctx.shm, &shm_ctx.cmds, shm_ctx.shm->client_pid, &bye, 0);
+    _shm_publish(&shm_ctx.cmds);
+    __atomic_store_n(&shm_ctx.shm->closed, 1, __ATOMIC_RELEASE);
+    if(shm_ctx.child > 0) {
+        i32 status;
+        shm_ctx.status = waitpid(shm_ctx.child, &status, 0) == shm_ctx.child && WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    }
+    munmap(shm_ctx.shm, shm_ctx.shm->size);
+    free(shm_ctx.pending);
+    free(shm_ctx.clipboard);
+    shm_ctx.shm = 0;
+    shm_ctx.pending = 0;
+    shm_ctx.clipboard = 0;
+}
+
+static void _shm_setup(zui_shm_args *args) {
+    memset(&shm_ctx, 0, sizeof(shm_ctx));
+    shm_ctx.status = -1;
+    i32 fd;
+    shm_ctx.shm = _shm_create(args->ring_size ? args->ring_size : 4 << 20, &fd);
+    if(!shm_ctx.shm) {
+        zui_log("shm: couldn't create the shared block\n");
+        return;
+    }
+    _shm_end(shm_ctx.shm, &shm_ctx.shm->cmds, &shm_ctx.cmds);
+    _shm_end(shm_ctx.shm, &shm_ctx.shm->responses, &shm_ctx.responses);
+    if(args->consumer) {
+        shm_ctx.child = _shm_spawn(args->consumer, fd);
+        if(shm_ctx.child < 0) zui_log("shm: couldn't start %s\n", args->consumer[0]);
+        shm_ctx.shm->client_pid = shm_ctx.child;
+    }
+    close(fd);
+    shm_ctx.running = shm_ctx.child >= 0;
+    // the renderer's first message is its window size
+    for(i32 spins = 0; shm_ctx.running && !shm_ctx.has_size;) {
+        _shm_pump();
+        if(!shm_ctx.has_size && !_shm_wait(shm_ctx.shm, shm_ctx.shm->client_pid, &spins)) shm_ctx.running = false;
+    }
+    if(args->init) args->init(0);
+    if(!args->tick_manually) {
+        for(i32 i = 0; shm_ctx.running && (!args->frames || i < args->frames); i++) {
+            _shm_pace();
+            _shm_pump();
+            args->frame(0);
+        }
+        _shm_close(args);
+    }
+}
+
+void shm_renderer(zcmd_any *cmd, void *user_data) {
+    zui_shm_args *args = user_data;
+    zcmd *res;
+    switch(cmd->base.id) {
+        case ZCMD_INIT: _shm_setup(args); break;
+        case ZCMD_TICK:
+        case ZCMD_TICK_BLOCKING: _shm_pace(); _shm_pump(); if(shm_ctx.running) args->frame(0); break;
+        case ZCMD_REDRAW: break;
+        case ZCMD_CLOSE: _shm_close(args); break;
+        case ZCMD_TIMESTAMP:
+            res = _shm_query(&cmd->base, ZRCMD_TIMESTAMP);
+            cmd->timestamp.resp_ns = res ? ((zrcmd_timestamp*)res)->ns : _shm_ns();
+            break;
+        case ZCMD_GET_CLIPBOARD: cmd->get_clipboard.response = shm_ctx.clipboard ? shm_ctx.clipboard : ""; break;
+        case ZCMD_REG_FONT:
+            res = _shm_query(&cmd->base, ZCCMD_FONT);
+            cmd->font.response_height = res ? ((zccmd_font*)res)->height : 0;
+            cmd->font.response_identity = res ? ((zccmd_font*)res)->identity : 0;
+            break;
+        case ZCMD_GLYPH_SZ:
+            res = _shm_query(&cmd->base, ZCCMD_GLYPH);
+            cmd->glyph_sz.response = res ? ((zccmd_glyph*)res)->sz : (zvec2) { 0, 0 };
+            break;
+        case ZCMD_RENDER_END:
+            _shm_send(&cmd->base);
+            _shm_publish(&shm_ctx.cmds);
+            shm_ctx.frame_end[0] = shm_ctx.frame_end[1];
+            shm_ctx.frame_end[1] = shm_ctx.cmds.pos;
+            shm_ctx.stats.frames++;
+            break;
+        case ZCMD_RENDER_BEGIN:
+        case ZCMD_SET_CLIPBOARD:
+        case ZCMD_DRAW_CLIP:
+        case ZCMD_DRAW_RECT:
+        case ZCMD_DRAW_TEXT:
+        case ZCMD_DRAW_LINES:
+        case ZCMD_DRAW_BEZIER:
+            _shm_send(&cmd->base);
+            break;
+    }
+}
+
+// CLIENT
+
+bool shm_client_open(zui_shm_client *client, i32 fd, zui_render_fn renderer, void *user_data) {
+    memset(client, 0, sizeof(*client));
+    client->renderer = renderer;
+    client->user_data = user_data;
+    if(fd < 0 && getenv("ZUI_SHM_FD")) fd = atoi(getenv("ZUI_SHM_FD"));
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) || st.st_size < (off_t)sizeof(zshm_header)) return false;
+    zshm_header *shm = mmap(0, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(shm == MAP_FAILED) return false;
+    if(shm->magic != ZSHM_MAGIC || shm->size != (u32)st.st_size) {
+        munmap(shm, st.st_size);
+        return false;
+    }
+    shm->client_pid = getpid();
+    client->shm = shm;
+    _shm_end(shm, &shm->cmds, &client->cmds);
+    _shm_end(shm, &shm->responses, &client->responses);
+    client->connected = true;
+    return true;
+}
+
+void shm_client_push(zui_shm_client *client, zccmd *cmd) {
+    if(client->connected && !_shm_write(client->shm, &client->responses, client->shm->server_pid, &cmd->base, 0))
+        client->connected = false;
+    _shm_publish(&client->responses);
+}
+
+static void _shm_client_handle(zui_shm_client *client, zcmd_any *cmd) {
+    switch(cmd->base.id) {
+        case ZCMD_REG_FONT: {
+            cmd->font.response_height = 0;
+            client->renderer(cmd, client->user_data);
+            zccmd_font font = { { ZCCMD_FONT, sizeof(zccmd_font) }, cmd->font.font_id, cmd->font.response_height, cmd->font.response_identity };
+            shm_client_push(client, (zccmd*)&font);
+        } break;
+        case ZCMD_GLYPH_SZ: {
+            client->renderer(cmd, client->user_data);
+            zccmd_glyph glyph = { { ZCCMD_GLYPH, sizeof(zccmd_glyph) }, cmd->glyph_sz.font_id, cmd->glyph_sz.codepoint, cmd->glyph_sz.response };
+            shm_client_push(client, (zccmd*)&glyph);
+        } break;
+        case ZCMD_TIMESTAMP: {
+            zcmd_any ts = { .base = { ZCMD_TIMESTAMP, sizeof(zcmd_timestamp) } };
+            client->renderer(&ts, client->user_data);
+            zrcmd_timestamp res = { { ZRCMD_TIMESTAMP, sizeof(zrcmd_timestamp) }, 0, ts.timestamp.resp_ns };
+            shm_client_push(client, (zccmd*)&res);
+        } break;
+        case ZCMD_CLOSE: client->connected = false; break;
+        case ZCMD_RENDER_END:
+            client->renderer(cmd, client->user_data);
+            client->frames++;
+            break;
+        default: client->renderer(cmd, client->user_data); break;
+    }
+}
+
+i32 shm_client_poll(zui_shm_client *client, i32 timeout_ms) {
+    if(!client->connected) return -1;
+    i32 frames = client->frames;
+    u64 deadline = timeout_ms < 0 ? 0 : _shm_ns() + (u64)timeout_ms * 1000000;
+    bool alive = true;
+    // queries are answered as they come, until a frame is complete. Once the application is gone, what it
+    // published before is still drawn
+    for(i32 spins = 0; client->connected && client->frames == frames;) {
+        zcmd *cmd = _shm_next(&client->cmds);
+        if(!cmd) {
+            if(!alive) break;
+            if(deadline && _shm_ns() > deadline) return 0;
+            alive = _shm_wait(client->shm, client->shm->server_pid, &spins);
+            continue;
+        }
+        // everything published is drawn in place, then released in one go
+        for(i32 n = 0; cmd && client->connected; cmd = _shm_next(&client->cmds)) {
+            _shm_client_handle(client, (zcmd_any*)cmd);
+            if(++n % 1024 == 0) _shm_release(&client->cmds); // lets the application go on with big frames
+        }
+        _shm_release(&client->cmds);
+        spins = 0;
+    }
+    if(!alive) client->connected = false;
+    if(!client->connected && client->frames == frames) return -1;
+    return client->frames - frames;
+}
+
+void shm_client_close(zui_shm_client *client) {
+    if(!client->shm) return;
+    if(client->connected) {
+        zcmd bye = { ZCCMD_CLOSE, sizeof(zcmd) };
+        shm_client_push(client, (zccmd*)&bye);
+    }
+    __atomic_store_n(&client->shm->closed, 1, __ATOMIC_RELEASE);
+    munmap(client->shm, client->shm->size);
+    client->shm = 0;
+    client->connected = false;
+}
+#endif
+#endif
@@ -1,14 +1,92 @@
-if [ "$1" = "sokol" ]; then
-    clang tests/sokol-test.c src/zui.c backends/sokol/sokol.m -Ibackends/sokol -Itests -Isrc -o bin/sokol-test -fobjc-arc -framework Metal -framework Cocoa -framework MetalKit -framework Quartz
-    if [ "$2" = "run" ]; then
-        ./bin/sokol-test
-    fi
-elif [ "$1" = "bake" ]; then
-    # bake single header library
-    cat src/zui.h > zui-sh.h
-    echo "#ifdef ZUI_IMPLEMENTATION" >> zui-sh.h
-    tail -n +2 src/zui.c >> zui-sh.h
-    echo "#endif" >> zui-sh.h
-else
-    echo "unrecognized option $1"
-fi
+if [ "$1" = "sokol" ]; then
+    clang tests/sokol-test.c src/zui.c backends/sokol/sokol.m -Ibackends/sokol -Itests -Isrc -o bin/sokol-test -fobjc-arc -framework Metal -framework Cocoa -framework MetalKit -framework Quartz
+    if [ "$2" = "run" ]; then
+        ./bin/sokol-test
+    fi
+elif [ "$1" = "headless" ]; then
+    cc tests/headless/test.c src/zui.c -Isrc -o bin/headless-test -lm -lpthread
+    if [ "$2" = "run" ]; then
+        ./bin/headless-test $3 $4 $5
+    fi
+elif [ "$1" = "net" ]; then
+    # loopback test of the net backend
+    cc tests/net/test.c src/zui.c -Isrc -o bin/net-test -lm -lpthread
+    if [ "$2" = "run" ]; then
+        ./bin/net-test $3 $4
+    fi
+elif [ "$1" = "bench" ]; then
+    cc -O2 tests/bench/bench.c -Isrc -o bin/bench -lm
+    if [ "$2" = "run" ]; then
+        ./bin/bench $3 $4 $5
+    fi
+elif [ "$1" = "trace" ]; then
+    # bench with ZUI_TRACE, writes the last frame of each scenario to bin/trace-<scenario>.json
+    cc -O2 -DZUI_TRACE tests/bench/bench.c -Isrc -o bin/bench-trace -lm
+    if [ "$2" = "run" ]; then
+        ./bin/bench-trace $3 $4 $5
+    fi
+elif [ "$1" = "delta" ]; then
+    # frame-delta codec ratio / throughput on recorded sessions
+    cc -O2 tests/delta/bench.c src/zui.c src/zui-node.c src/zui-delta.c -Isrc -o bin/delta-bench -lm -lpthread
+    if [ "$2" = "run" ]; then
+        ./bin/delta-bench $3 $4
+    fi
+elif [ "$1" = "replay" ]; then
+    # records a scripted session with the headless backend, then replays it and compares every frame
+    cc -O2 tests/replay/test.c src/zui.c -Isrc -o bin/replay-test -lm -lpthread
+    if [ "$2" = "run" ]; then
+        ./bin/replay-test record bin/session.zrec $3 $4 && ./bin/replay-test replay bin/session.zrec
+    fi
+elif [ "$1" = "shm" ]; then
+    # application and renderer in two processes over the shared-memory backend, then with a renderer that crashes
+    cc -O2 tests/shm/test.c src/zui.c -Isrc -o bin/shm-test -lm -lpthread
+    if [ "$2" = "run" ]; then
+        ./bin/shm-test $3 && ./bin/shm-test crash $3
+    fi
+elif [ "$1" = "graph" ]; then
+    # graph file save / load throughput, against building the same graphs with znode_add and znode_link
+    cc -O2 tests/graph/bench.c src/zui.c src/zui-node.c -Isrc -o bin/graph-bench -lm -lpthread
+    if [ "$2" = "run" ]; then
+        ./bin/graph-bench $3 $4 $5
+    fi
+elif [ "$1" = "layout" ]; then
+    # layered layout of imported graphs on its thread, then incrementally after an edit
+    # (the layout builds on Windows too, with the Win32 threads of src/zui-thread.h)
+    cc -O2 tests/layout/bench.c src/zui.c src/zui-node.c src/zui-layout.c -Isrc -o bin/layout-bench -lm -lpthread
+    if [ "$2" = "run" ]; then
+        ./bin/layout-bench $3 $4 $5
+    fi
+elif [ "$1" = "node" ]; then
+    # random graph edits, deletes and compacts against a brute-force model
+    cc -O2 tests/node/test.c src/zui.c src/zui-node.c -Isrc -o bin/node-test -lm -lpthread
+    if [ "$2" = "run" ]; then
+        ./bin/node-test $3 $4 $5
+    fi
+elif [ "$1" = "hit" ]; then
+    # node editor hit-tests and rect queries on drawn frames, against a scan of every node, port and link
+    cc -O2 tests/hit/test.c -Isrc -o bin/hit-test -lm -lpthread
+    if [ "$2" = "run" ]; then
+        ./bin/hit-test $3 $4
+    fi
+elif [ "$1" = "labelf" ]; then
+    # lazy labels formatted at render against snprintf, and their fixed widths
+    cc -O2 tests/labelf/test.c src/zui.c -Isrc -o bin/labelf-test -lm -lpthread
+    if [ "$2" = "run" ]; then
+        ./bin/labelf-test
+    fi
+elif [ "$1" = "exec" ]; then
+    # node graph execution engine, results against a serial evaluation, failures and cancelling
+    # (the engine builds on Windows too, with the Win32 threads of src/zui-thread.h)
+    cc -O2 tests/exec/test.c src/zui.c src/zui-node.c src/zui-exec.c -Isrc -o bin/exec-test -lm -lpthread
+    if [ "$2" = "run" ]; then
+        ./bin/exec-test $3 $4 $5
+    fi
+elif [ "$1" = "bake" ]; then
+    # bake single header library
+    cat src/zui.h > zui-sh.h
+    echo "#ifdef ZUI_IMPLEMENTATION" >> zui-sh.h
+    tail -n +2 src/zui.c >> zui-sh.h
+    echo "#endif" >> zui-sh.h
+else
+    echo "unrecognized option $1"
+fi
@@ -0,0 +1,352 @@
+#define ZUI_DEV
+#include "zui.h"
+#include "zui-delta.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Encoded stream: <varint decoded size> followed by ops
+enum ZDELTA_OPS {
+    ZDO_COPY,       // <zigzag skip> <varint len>: len bytes from the reference at cursor + skip, the cursor moves past them
+    ZDO_DELTA,      // <words>: the reference command at the cursor with words applied, the cursor moves past it
+    ZDO_DELTA_RUN,  // <varint cnt>: cnt reference commands at the cursor that only moved as predicted
+    ZDO_DELTA_SELF, // <varint dist> <words>: the command decoded dist bytes back with words applied
+    ZDO_LITERAL,    // <varint len> <bytes>
+};
+// <words> of a command of n bytes: the header is taken from the base command, the remaining (n - 4) bytes are split
+// into 16 bit words plus an odd trailing byte. A bitmask of the units that changed is followed by the zigzag varint
+// difference of each changed unit. For ZDO_DELTA the first ZDELTA_PRED words are relative to the prediction.
+
+#define ZDELTA_WINDOW 4 // commands per anchor
+#define ZDELTA_IDS 64   // commands with higher ids are never predicted or delta encoded against the same frame
+#define ZDELTA_PRED 16  // predicted words per command, enough for a rect or a bezier
+
+ZUI_PRIVATE i32 _zdelta_put(u8 *out, u32 v) {
+    i32 n = 0;
+    for(; v >= 0x80; v >>= 7) out[n++] = (u8)v | 0x80;
+    out[n++] = (u8)v;
+    return n;
+}
+ZUI_PRIVATE i32 _zdelta_len(u32 v) {
+    i32 n = 1;
+    for(; v >= 0x80; v >>= 7) n++;
+    return n;
+}
+ZUI_PRIVATE bool _zdelta_get(u8 *in, i32 len, i32 *i, u32 *v) {
+    *v = 0;
+    for(i32 shift = 0; shift < 35; shift += 7) {
+        if(*i >= len) return false;
+        u8 b = in[(*i)++];
+        *v |= (u32)(b & 0x7F) << shift;
+        if(!(b & 0x80)) return true;
+    }
+    return false;
+}
+ZUI_PRIVATE u32 _zdelta_zz(i32 v) { return ((u32)v << 1) ^ (u32)(v >> 31); }
+ZUI_PRIVATE i32 _zdelta_unzz(u32 v) { return (i32)(v >> 1) ^ -(i32)(v & 1); }
+
+ZUI_PRIVATE u64 _zdelta_hash(u8 *p, i32 n) {
+    u64 h = n * 0x9E3779B97F4A7C15ULL, v;
+    for(; n >= 8; n -= 8, p += 8) {
+        memcpy(&v, p, 8);
+        h = (h ^ v) * 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 32;
+    }
+    v = 0;
+    memcpy(&v, p, n);
+    h = (h ^ v) * 0xC4CEB9FE1A85EC53ULL;
+    return h ^ (h >> 29);
+}
+ZUI_PRIVATE u64 _zdelta_window(u64 *hashes) {
+    u64 w = 0;
+    for(i32 i = 0; i < ZDELTA_WINDOW; i++)
+        w = (w + hashes[i]) * 0x100000001B3ULL;
+    return w;
+}
+// commands with odd sized text leave the ones after them unaligned, so words are read with memcpy
+ZUI_PRIVATE u16 _zdelta_word(u8 *p) { u16 w; memcpy(&w, p, 2); return w; }
+ZUI_PRIVATE u16 _zdelta_id(u8 *cmd) { return _zdelta_word(cmd + offsetof(zcmd, id)); }
+// byte size of the command at <p> or 0 if it's malformed
+ZUI_PRIVATE i32 _zdelta_cmd(u8 *stream, i32 len, i32 p) {
+    if(p + (i32)sizeof(zcmd) > len) return 0;
+    i32 n = _zdelta_word(stream + p + offsetof(zcmd, bytes));
+    return n >= (i32)sizeof(zcmd) && p + n <= len ? n : 0;
+}
+
+// indexes the commands of the reference and their anchors
+ZUI_PRIVATE i32 _zdelta_index(zdelta *d, u8 *ref, i32 ref_len) {
+    i32 cnt = 0;
+    for(i32 p = 0, n; (n = _zdelta_cmd(ref, ref_len, p)); p += n) {
+        if(cnt + 1 >= d->cmd_cap) {
+            d->cmd_cap = d->cmd_cap ? d->cmd_cap * 2 : 1024;
+            d->offsets = ZUI_REALLOC(d->offsets, d->cmd_cap * sizeof(i32));
+            d->hashes = ZUI_REALLOC(d->hashes, d->cmd_cap * sizeof(u64));
+        }
+        d->offsets[cnt] = p;
+        d->hashes[cnt++] = _zdelta_hash(ref + p, n);
+        d->offsets[cnt] = p + n;
+    }
+    i32 cap = 64;
+    while(cap < cnt * 2) cap *= 2;
+    if(cap > d->table_cap) {
+        d->table_cap = cap;
+        d->table = ZUI_REALLOC(d->table, cap * sizeof(u32));
+    }
+    memset(d->table, 0, d->table_cap * sizeof(u32));
+    // the first occurrence of a window wins
+    for(i32 i = 0; i + ZDELTA_WINDOW <= cnt; i++) {
+        u64 w = _zdelta_window(&d->hashes[i]);
+        u32 slot = (u32)w & (d->table_cap - 1);
+        while(d->table[slot] && _zdelta_window(&d->hashes[d->table[slot] - 1]) != w)
+            slot = (slot + 1) & (d->table_cap - 1);
+        if(!d->table[slot]) d->table[slot] = i + 1;
+    }
+    return cnt;
+}
+
+// finds the commands at <p> somewhere in the reference, returns their offset or -1
+ZUI_PRIVATE i32 _zdelta_anchor(zdelta *d, i32 ref_cnt, u8 *ref, u8 *cur, i32 cur_len, i32 p) {
+    if(ref_cnt < ZDELTA_WINDOW) return -1;
+    u64 hashes[ZDELTA_WINDOW];
+    i32 end = p;
+    for(i32 i = 0, n; i < ZDELTA_WINDOW; i++, end += n) {
+        if(!(n = _zdelta_cmd(cur, cur_len, end))) return -1;
+        hashes[i] = _zdelta_hash(cur + end, n);
+    }
+    u64 w = _zdelta_window(hashes);
+    for(u32 slot = (u32)w & (d->table_cap - 1); d->table[slot]; slot = (slot + 1) & (d->table_cap - 1)) {
+        i32 i = d->table[slot] - 1;
+        if(_zdelta_window(&d->hashes[i]) != w) continue;
+        i32 start = d->offsets[i], len = d->offsets[i + ZDELTA_WINDOW] - start;
+        if(len == end - p && !memcmp(ref + start, cur + p, len)) return start;
+    }
+    return -1;
+}
+
+// length of the run of identical commands at <c> in the reference and <p> in the current stream
+ZUI_PRIVATE i32 _zdelta_run(u8 *ref, i32 ref_len, i32 c, u8 *cur, i32 cur_len, i32 p, i32 *last) {
+    i32 run = 0;
+    for(i32 n; (n = _zdelta_cmd(cur, cur_len, p + run)); run += n) {
+        if(_zdelta_cmd(ref, ref_len, c + run) != n || memcmp(ref + c + run, cur + p + run, n)) break;
+        u16 id = _zdelta_id(cur + p + run);
+        if(id < ZDELTA_IDS) last[id] = p + run;
+    }
+    return run;
+}
+
+// size of the <words> encoding of <cmd> against <base>, both n bytes.
+// The first words of a command are usually coordinates, which tend to move together (scrolling, panning),
+// so their difference is sent relative to <pred>: the differences of the last command of the same type
+ZUI_PRIVATE i32 _zdelta_words_len(u8 *base, u8 *cmd, i32 n, i16 *pred) {
+    i32 units = (n - 3) / 2, size = 0, unit = 0;
+    for(i32 i = 4; i + 1 < n; i += 2, unit++) {
+        i16 diff = (i16)(_zdelta_word(cmd + i) - _zdelta_word(base + i));
+        if(pred && unit < ZDELTA_PRED) diff -= pred[unit];
+        if(diff) size += _zdelta_len(_zdelta_zz(diff));
+    }
+    if(n & 1 && cmd[n - 1] != base[n - 1])
+        size += _zdelta_len(_zdelta_zz((i8)(cmd[n - 1] - base[n - 1])));
+    return size ? size + (units + 7) / 8 : 0; // 0: nothing changed besides the prediction
+}
+ZUI_PRIVATE i32 _zdelta_words(u8 *base, u8 *cmd, i32 n, i16 *pred, u8 *out) {
+    i32 units = (n - 3) / 2, mask_len = (units + 7) / 8, size = mask_len, unit = 0;
+    memset(out, 0, mask_len);
+    for(i32 i = 4; i + 1 < n; i += 2, unit++) {
+        i16 diff = (i16)(_zdelta_word(cmd + i) - _zdelta_word(base + i));
+        if(pred && unit < ZDELTA_PRED) diff -= pred[unit];
+        if(!diff) continue;
+        out[unit >> 3] |= 1 << (unit & 7);
+        size += _zdelta_put(out + size, _zdelta_zz(diff));
+    }
+    if(n & 1 && cmd[n - 1] != base[n - 1]) {
+        out[unit >> 3] |= 1 << (unit & 7);
+        size += _zdelta_put(out + size, _zdelta_zz((i8)(cmd[n - 1] - base[n - 1])));
+    }
+    return size;
+}
+// rebuilds a command from its base, reading <words> from <in>, or only the prediction when in is 0
+ZUI_PRIVATE bool _zdelta_apply(u8 *base, i32 n, u8 *in, i32 in_len, i32 *i, i16 *pred, u8 *out) {
+    i32 units = (n - 3) / 2, mask_len = (units + 7) / 8, unit = 0;
+    if(in && *i + mask_len > in_len) return false;
+    u8 *mask = in ? in + *i : 0;
+    if(in) *i += mask_len;
+    memcpy(out, base, n);
+    u32 v;
+    for(i32 p = 4; p + 1 < n; p += 2, unit++) {
+        i16 diff = pred && unit < ZDELTA_PRED ? pred[unit] : 0;
+        if(mask && mask[unit >> 3] & (1 << (unit & 7))) {
+            if(!_zdelta_get(in, in_len, i, &v)) return false;
+            diff += (i16)_zdelta_unzz(v);
+        }
+        u16 w = _zdelta_word(base + p) + (u16)diff;
+        memcpy(out + p, &w, 2);
+    }
+    if(mask && n & 1 && mask[unit >> 3] & (1 << (unit & 7))) {
+        if(!_zdelta_get(in, in_len, i, &v)) return false;
+        out[n - 1] = base[n - 1] + (u8)_zdelta_unzz(v);
+    }
+    return true;
+}
+ZUI_PRIVATE void _zdelta_predict(i16 *pred, u8 *base, u8 *cmd, i32 n) {
+    for(i32 unit = 0, i = 4; i + 1 < n && unit < ZDELTA_PRED; i += 2, unit++)
+        pred[unit] = (i16)(_zdelta_word(cmd + i) - _zdelta_word(base + i));
+}
+
+// commands waiting to be written as one literal or one run
+typedef struct zdelta_pending { i32 op, start, cnt; } zdelta_pending;
+
+ZUI_PRIVATE u8 *_zdelta_flush(u8 *o, u8 *cur, i32 p, zdelta_pending *pending) {
+    if(pending->op == ZDO_LITERAL && pending->start < p) {
+        *o++ = ZDO_LITERAL;
+        o += _zdelta_put(o, p - pending->start);
+        memcpy(o, cur + pending->start, p - pending->start);
+        o += p - pending->start;
+    } else if(pending->op == ZDO_DELTA_RUN && pending->cnt) {
+        *o++ = ZDO_DELTA_RUN;
+        o += _zdelta_put(o, pending->cnt);
+    }
+    pending->op = -1;
+    pending->cnt = 0;
+    return o;
+}
+
+i32 zdelta_bound(i32 len) {
+    // a command is at least 4 bytes, and no op spends more than 11 bytes on one
+    return 16 + len * 3;
+}
+
+i32 zdelta_encode(zdelta *d, u8 *ref, i32 ref_len, u8 *cur, i32 cur_len, u8 *out) {
+    u8 *o = out;
+    o += _zdelta_put(o, cur_len);
+    i32 ref_cnt = _zdelta_index(d, ref, ref_len);
+    i32 last[ZDELTA_IDS];
+    i16 pred[ZDELTA_IDS][ZDELTA_PRED] = { 0 };
+    for(i32 i = 0; i < ZDELTA_IDS; i++) last[i] = -1;
+    zdelta_pending pending = { -1 };
+    i32 p = 0, c = 0; // c: the decoder's cursor in the reference
+    while(p < cur_len) {
+        i32 n = _zdelta_cmd(cur, cur_len, p);
+        if(!n) { // malformed tail, keep it as is
+            if(pending.op != ZDO_LITERAL) o = _zdelta_flush(o, cur, p, &pending);
+            pending = (zdelta_pending) { ZDO_LITERAL, pending.op == ZDO_LITERAL ? pending.start : p };
+            p = cur_len;
+            break;
+        }
+        i32 from = c, run = _zdelta_run(ref, ref_len, c, cur, cur_len, p, last);
+        if(!run && (from = _zdelta_anchor(d, ref_cnt, ref, cur, cur_len, p)) >= 0)
+            run = _zdelta_run(ref, ref_len, from, cur, cur_len, p, last);
+        if(run) {
+            o = _zdelta_flush(o, cur, p, &pending);
+            *o++ = ZDO_COPY;
+            o += _zdelta_put(o, _zdelta_zz(from - c));
+            o += _zdelta_put(o, run);
+            p += run;
+            c = from + run;
+            continue;
+        }
+        // changed command: the cheapest of a delta against the reference, against this frame, or a literal
+        u8 *cmd = cur + p;
+        u16 id = _zdelta_id(cmd);
+        i16 *pr = id < ZDELTA_IDS ? pred[id] : 0;
+        i32 best = n + 2, op = ZDO_LITERAL, size;
+        if(_zdelta_cmd(ref, ref_len, c) == n && _zdelta_id(ref + c) == id) {
+            size = _zdelta_words_len(ref + c, cmd, n, pr);
+            if(!size) op = ZDO_DELTA_RUN, best = 0;
+            else if(size + 1 < best) op = ZDO_DELTA, best = size + 1;
+        }
+        i32 self = id < ZDELTA_IDS ? last[id] : -1;
+        if(best && self >= 0 && _zdelta_cmd(cur, cur_len, self) == n) {
+            size = _zdelta_words_len(cur + self, cmd, n, 0);
+            size = 1 + _zdelta_len(p - self) + (size ? size : (n - 3) / 2 / 8 + 1);
+            if(size < best) op = ZDO_DELTA_SELF, best = size;
+        }
+        if(id < ZDELTA_IDS) last[id] = p;
+        if(op == ZDO_LITERAL || op == ZDO_DELTA_RUN) {
+            if(pending.op != op) {
+                o = _zdelta_flush(o, cur, p, &pending);
+                pending = (zdelta_pending) { op, p, 0 };
+            }
+            pending.cnt++;
+            if(op == ZDO_DELTA_RUN) c += n;
+            p += n;
+            continue;
+        }
+        o = _zdelta_flush(o, cur, p, &pending);
+        *o++ = op;
+        if(op == ZDO_DELTA) {
+            o += _zdelta_words(ref + c, cmd, n, pr, o);
+            _zdelta_predict(pr, ref + c, cmd, n);
+            c += n;
+        } else {
+            o += _zdelta_put(o, p - self);
+            o += _zdelta_words(cur + self, cmd, n, 0, o);
+        }
+        p += n;
+    }
+    o = _zdelta_flush(o, cur, p, &pending);
+    return (i32)(o - out);
+}
+
+i32 zdelta_decoded_size(u8 *in, i32 in_len) {
+    i32 i = 0;
+    u32 len;
+    if(!_zdelta_get(in, in_len, &i, &len) || len > 0x7FFFFFFF) return -1;
+    return (i32)len;
+}
+
+i32 zdelta_decode(u8 *ref, i32 ref_len, u8 *in, i32 in_len, u8 *out, i32 out_cap) {
+    i32 i = 0, o = 0, c = 0;
+    i64 skip;
+    u32 total, a, b;
+    i16 pred[ZDELTA_IDS][ZDELTA_PRED] = { 0 };
+    if(!_zdelta_get(in, in_len, &i, &total) || total > (u32)out_cap) return -1;
+    while(i < in_len) {
+        switch(in[i++]) {
+            case ZDO_COPY:
+                if(!_zdelta_get(in, in_len, &i, &a) || !_zdelta_get(in, in_len, &i, &b)) return -1;
+                skip = (i64)c + _zdelta_unzz(a);
+                if(skip < 0 || skip > ref_len || b > (u32)(ref_len - skip) || b > total - o) return -1;
+                c = (i32)skip;
+                memcpy(out + o, ref + c, b);
+                o += b;
+                c += b;
+                break;
+            case ZDO_DELTA:
+            case ZDO_DELTA_RUN: {
+                bool is_run = in[i - 1] == ZDO_DELTA_RUN;
+                if(is_run ? !_zdelta_get(in, in_len, &i, &a) : (a = 1, false)) return -1;
+                for(; a; a--) {
+                    i32 n = _zdelta_cmd(ref, ref_len, c);
+                    if(!n || (u32)n > total - o) return -1;
+                    u16 id = _zdelta_id(ref + c);
+                    i16 *pr = id < ZDELTA_IDS ? pred[id] : 0;
+                    if(!_zdelta_apply(ref + c, n, is_run ? 0 : in, in_len, &i, pr, out + o)) return -1;
+                    if(pr) _zdelta_predict(pr, ref + c, out + o, n);
+                    o += n;
+                    c += n;
+                }
+            } break;
+            case ZDO_DELTA_SELF: {
+                if(!_zdelta_get(in, in_len, &i, &a) || a > (u32)o) return -1;
+                i32 base = o - a, n = _zdelta_cmd(out, o, base);
+                if(!n || (u32)n > total - o || !_zdelta_apply(out + base, n, in, in_len, &i, 0, out + o)) return -1;
+                o += n;
+            } break;
+            case ZDO_LITERAL:
+                if(!_zdelta_get(in, in_len, &i, &a) || a > (u32)(in_len - i) || a > total - o) return -1;
+                memcpy(out + o, in + i, a);
+                o += a;
+                i += a;
+                break;
+            default: return -1;
+        }
+    }
+    return (u32)o == total ? o : -1;
+}
+
+void zdelta_free(zdelta *d) {
+    ZUI_FREE(d->table);
+    ZUI_FREE(d->hashes);
+    ZUI_FREE(d->offsets);
+    memset(d, 0, sizeof(*d));
+}
@@ -0,0 +1,32 @@
+#ifndef ZDELTA_INCLUDED
+#define ZDELTA_INCLUDED
+#include "zui.h"
+
+// Frame-delta codec for draw command streams.
+// A stream is a sequence of zcmds packed back to back (each takes header.bytes bytes), e.g. a frame recorded
+// by the headless backend. A frame is encoded against a reference, usually the previous frame:
+//  - runs of commands found unchanged in the reference become copy ranges
+//  - a changed command is sent as the zigzag varint difference of its 16 bit words against a command of the
+//    same type and size, either the one at the same place in the reference or the last one in this frame
+//  - anything else is sent as literal bytes
+// Decoding with the same reference rebuilds the stream byte for byte.
+
+typedef struct zdelta {
+    u32 *table;  // anchors of the reference: hash of a few consecutive commands -> offset + 1
+    u64 *hashes; // per command hash of the reference
+    i32 *offsets;
+    i32 table_cap, cmd_cap;
+} zdelta;
+
+// largest possible size of an encoded <len> byte stream
+i32  zdelta_bound(i32 len);
+// encodes <cur> against <ref> (ref_len can be 0) into <out>, which must hold zdelta_bound(cur_len) bytes.
+// returns the encoded size
+i32  zdelta_encode(zdelta *d, u8 *ref, i32 ref_len, u8 *cur, i32 cur_len, u8 *out);
+// returns the size of the decoded stream without decoding it, -1 if <in> isn't an encoded stream
+i32  zdelta_decoded_size(u8 *in, i32 in_len);
+// decodes <in> against the same <ref> it was encoded with.
+// returns the decoded size, or -1 if the input is corrupt or doesn't fit in out_cap
+i32  zdelta_decode(u8 *ref, i32 ref_len, u8 *in, i32 in_len, u8 *out, i32 out_cap);
+void zdelta_free(zdelta *d);
+#endif
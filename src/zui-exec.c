@@ -0,0 +1,316 @@
+#define ZUI_DEV
+#include "zui.h"
+#include "zui-exec.h"
+#include "zui-thread.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct zexec_type {
+    i32 uud_type;
+    zexec_fn fn;
+    void *user_data;
+} zexec_type;
+
+typedef struct zexec_task {
+    zd_node *node;
+    zexec_fn fn;
+    void *user_data;
+    u32 succ, succ_cnt;  // the tasks its outputs feed, a range of zexec.succ
+    u32 pending;         // inputs not finished yet
+    u32 failed;          // an input failed or was skipped
+} zexec_task;
+
+typedef struct zexec_worker {
+    zexec *e;
+    zthread thread;
+    zmutex lock;
+    u32 *deque;          // the owner takes the newest task at tail, thieves the oldest at head
+    u32 head, tail, cap;
+    u16 index;
+} zexec_worker;
+
+struct zexec {
+    zexec_worker *workers;
+    i32 worker_cnt;
+    zexec_type *types;
+    i32 type_cnt;
+    // snapshot of the graph for the run
+    zexec_task *tasks;
+    zexec_timing *timing;
+    u32 task_cnt, task_cap;
+    u32 *succ;
+    u32 succ_cap;
+    u32 *slot_task;      // node slot -> task + 1, 0 if it isn't in the run
+    u32 slot_cnt, slot_cap;
+    // workers sleep on wake while nothing is queued, zexec_wait on done
+    zmutex lock;
+    zcond wake, done;
+    bool quit;
+    // atomics
+    u32 queued;
+    u32 sleeping;
+    u32 finished;
+    u32 state;
+    u32 cancel;
+    u64 start_ns, end_ns;
+};
+
+static void _zexec_push(zexec_worker *w, u32 task) {
+    zexec *e = w->e;
+    zmutex_lock(&w->lock);
+    w->deque[w->tail++] = task;
+    zmutex_unlock(&w->lock);
+    // pairs with the sleeping / queued check of _zexec_worker, one of the two sees the other's increment
+    zatomic_add(&e->queued, 1, ZATOMIC_SEQ_CST);
+    if(zatomic_load(&e->sleeping, ZATOMIC_SEQ_CST)) {
+        zmutex_lock(&e->lock);
+        zcond_signal(&e->wake);
+        zmutex_unlock(&e->lock);
+    }
+}
+static bool _zexec_pop(zexec_worker *w, u32 *task) {
+    zmutex_lock(&w->lock);
+    bool found = w->tail > w->head;
+    if(found) *task = w->deque[--w->tail];
+    zmutex_unlock(&w->lock);
+    if(found) zatomic_sub(&w->e->queued, 1, ZATOMIC_SEQ_CST);
+    return found;
+}
+static bool _zexec_steal(zexec_worker *w, u32 *task) {
+    zexec *e = w->e;
+    for(i32 i = 1; i < e->worker_cnt; i++) {
+        zexec_worker *victim = &e->workers[(w->index + i) % e->worker_cnt];
+        zmutex_lock(&victim->lock);
+        bool found = victim->tail > victim->head;
+        if(found) *task = victim->deque[victim->head++];
+        zmutex_unlock(&victim->lock);
+        if(found) {
+            zatomic_sub(&e->queued, 1, ZATOMIC_SEQ_CST);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void _zexec_finish(zexec *e) {
+    zmutex_lock(&e->lock);
+    zatomic_store(&e->end_ns, zthread_ns(), ZATOMIC_RELEASE);
+    zatomic_store(&e->state, zatomic_load(&e->cancel, ZATOMIC_ACQUIRE) ? ZEXEC_CANCELLED : ZEXEC_DONE, ZATOMIC_RELEASE);
+    zcond_broadcast(&e->done);
+    zmutex_unlock(&e->lock);
+}
+
+// runs the callback unless the run is cancelled or an input failed, then queues the tasks it was the last input of
+static void _zexec_task(zexec_worker *w, u32 t) {
+    zexec *e = w->e;
+    zexec_task *task = &e->tasks[t];
+    zexec_timing *timing = &e->timing[t];
+    u8 state = ZEXEC_NODE_SKIPPED;
+    timing->worker = w->index;
+    if(!zatomic_load(&e->cancel, ZATOMIC_ACQUIRE) && !zatomic_load(&task->failed, ZATOMIC_ACQUIRE)) {
+        u64 start = zthread_ns();
+        timing->start_ns = start - e->start_ns;
+        zatomic_store(&timing->state, ZEXEC_NODE_RUNNING, ZATOMIC_RELEASE);
+        bool ok = !task->fn || task->fn(task->node, task->user_data);
+        timing->ns = zthread_ns() - start;
+        state = ok ? ZEXEC_NODE_DONE : ZEXEC_NODE_FAILED;
+    }
+    zatomic_store(&timing->state, state, ZATOMIC_RELEASE);
+    for(u32 i = task->succ; i < task->succ + task->succ_cnt; i++) {
+        zexec_task *next = &e->tasks[e->succ[i]];
+        if(state != ZEXEC_NODE_DONE) zatomic_store(&next->failed, 1, ZATOMIC_RELEASE);
+        if(!zatomic_sub(&next->pending, 1, ZATOMIC_ACQ_REL)) _zexec_push(w, e->succ[i]);
+    }
+    if(zatomic_add(&e->finished, 1, ZATOMIC_ACQ_REL) == e->task_cnt) _zexec_finish(e);
+}
+
+static ZTHREAD_FN _zexec_worker(void *arg) {
+    zexec_worker *w = arg;
+    zexec *e = w->e;
+    for(;;) {
+        u32 task;
+        if(_zexec_pop(w, &task) || _zexec_steal(w, &task)) {
+            _zexec_task(w, task);
+            continue;
+        }
+        zmutex_lock(&e->lock);
+        zatomic_add(&e->sleeping, 1, ZATOMIC_SEQ_CST);
+        while(!e->quit && !zatomic_load(&e->queued, ZATOMIC_SEQ_CST))
+            zcond_wait(&e->wake, &e->lock);
+        zatomic_sub(&e->sleeping, 1, ZATOMIC_SEQ_CST);
+        bool quit = e->quit;
+        zmutex_unlock(&e->lock);
+        if(quit) return 0;
+    }
+}
+
+zexec *zexec_new(i32 threads) {
+    if(threads <= 0) threads = zthread_cpus();
+    if(threads <= 0) threads = 1;
+    zexec *e = ZUI_CALLOC(1, sizeof(zexec));
+    zmutex_init(&e->lock);
+    zcond_init(&e->wake);
+    zcond_init(&e->done);
+    e->workers = ZUI_CALLOC(threads, sizeof(zexec_worker));
+    e->worker_cnt = threads;
+    for(i32 i = 0; i < threads; i++) {
+        zexec_worker *w = &e->workers[i];
+        w->e = e;
+        w->index = i;
+        zmutex_init(&w->lock);
+    }
+    for(i32 i = 0; i < threads; i++)
+        zthread_start(&e->workers[i].thread, _zexec_worker, &e->workers[i]);
+    return e;
+}
+
+i32 zexec_threads(zexec *e) {
+    return e->worker_cnt;
+}
+
+void zexec_free(zexec *e) {
+    zexec_wait(e);
+    zmutex_lock(&e->lock);
+    e->quit = true;
+    zcond_broadcast(&e->wake);
+    zmutex_unlock(&e->lock);
+    // a worker still on its way out may be stealing from any other
+    for(i32 i = 0; i < e->worker_cnt; i++)
+        zthread_join(e->workers[i].thread);
+    for(i32 i = 0; i < e->worker_cnt; i++) {
+        zmutex_destroy(&e->workers[i].lock);
+        ZUI_FREE(e->workers[i].deque);
+    }
+    zmutex_destroy(&e->lock);
+    zcond_destroy(&e->wake);
+    zcond_destroy(&e->done);
+    ZUI_FREE(e->workers);
+    ZUI_FREE(e->types);
+    ZUI_FREE(e->tasks);
+    ZUI_FREE(e->timing);
+    ZUI_FREE(e->succ);
+    ZUI_FREE(e->slot_task);
+    ZUI_FREE(e);
+}
+
+void zexec_register(zexec *e, i32 uud_type, zexec_fn fn, void *user_data) {
+    i32 i = 0;
+    while(i < e->type_cnt && e->types[i].uud_type != uud_type) i++;
+    if(i == e->type_cnt)
+        e->types = ZUI_REALLOC(e->types, ++e->type_cnt * sizeof(zexec_type));
+    e->types[i] = (zexec_type) { uud_type, fn, user_data };
+}
+
+bool zexec_run(zexec *e, zd_node_editor *state) {
+    if(zexec_state(e) == ZEXEC_RUNNING) return false;
+    u32 n = state->node_cnt;
+    if(n > e->task_cap) {
+        e->task_cap = n * 2;
+        e->tasks = ZUI_REALLOC(e->tasks, e->task_cap * sizeof(zexec_task));
+        e->timing = ZUI_REALLOC(e->timing, e->task_cap * sizeof(zexec_timing));
+    }
+    if((u32)state->link_cnt > e->succ_cap) {
+        e->succ_cap = state->link_cnt * 2;
+        e->succ = ZUI_REALLOC(e->succ, e->succ_cap * sizeof(u32));
+    }
+    if(state->nodes.end > e->slot_cap) {
+        e->slot_cap = state->nodes.end * 2;
+        e->slot_task = ZUI_REALLOC(e->slot_task, e->slot_cap * sizeof(u32));
+    }
+    e->slot_cnt = state->nodes.end;
+    memset(e->slot_task, 0, e->slot_cnt * sizeof(u32));
+    memset(e->timing, 0, n * sizeof(zexec_timing));
+    u32 t = 0, s = 0;
+    FOR_NODES(state) {
+        zexec_task *task = &e->tasks[t];
+        *task = (zexec_task) { .node = node };
+        for(i32 i = 0; i < e->type_cnt; i++) {
+            if(e->types[i].uud_type != node->uud_type) continue;
+            task->fn = e->types[i].fn;
+            task->user_data = e->types[i].user_data;
+        }
+        e->slot_task[node->id] = ++t;
+    }
+    for(t = 0; t < n; t++) {
+        zexec_task *task = &e->tasks[t];
+        task->succ = s;
+        FOR_OUTPUTS(task->node) {
+            u32 next = e->slot_task[link->input->id] - 1;
+            e->succ[s++] = next;
+            e->tasks[next].pending++;
+        }
+        task->succ_cnt = s - task->succ;
+    }
+    e->task_cnt = n;
+    e->finished = 0;
+    e->cancel = 0;
+    e->start_ns = zthread_ns();
+    e->end_ns = 0;
+    if(!n) {
+        e->end_ns = e->start_ns;
+        zatomic_store(&e->state, ZEXEC_DONE, ZATOMIC_RELEASE);
+        return true;
+    }
+    zatomic_store(&e->state, ZEXEC_RUNNING, ZATOMIC_RELEASE);
+    // the nodes without inputs are dealt out to the workers, with every deque locked: once a worker runs one, the
+    // pending counts the scan reads start changing
+    for(i32 i = 0; i < e->worker_cnt; i++) {
+        zexec_worker *w = &e->workers[i];
+        zmutex_lock(&w->lock);
+        if(w->cap < n) {
+            w->cap = e->task_cap;
+            w->deque = ZUI_REALLOC(w->deque, w->cap * sizeof(u32));
+        }
+        w->head = w->tail = 0;
+    }
+    for(t = 0, s = 0; t < n; t++) {
+        zexec_worker *w = &e->workers[s % e->worker_cnt];
+        if(!e->tasks[t].pending) w->deque[w->tail++] = t, s++;
+    }
+    zatomic_add(&e->queued, s, ZATOMIC_SEQ_CST);
+    for(i32 i = 0; i < e->worker_cnt; i++)
+        zmutex_unlock(&e->workers[i].lock);
+    if(zatomic_load(&e->sleeping, ZATOMIC_SEQ_CST)) {
+        zmutex_lock(&e->lock);
+        zcond_broadcast(&e->wake);
+        zmutex_unlock(&e->lock);
+    }
+    return true;
+}
+
+i32 zexec_state(zexec *e) {
+    return zatomic_load(&e->state, ZATOMIC_ACQUIRE);
+}
+
+u32 zexec_progress(zexec *e, u32 *total) {
+    if(total) *total = e->task_cnt;
+    return zatomic_load(&e->finished, ZATOMIC_ACQUIRE);
+}
+
+void zexec_cancel(zexec *e) {
+    zatomic_store(&e->cancel, 1, ZATOMIC_RELEASE);
+}
+
+bool zexec_cancelled(zexec *e) {
+    return zatomic_load(&e->cancel, ZATOMIC_ACQUIRE);
+}
+
+i32 zexec_wait(zexec *e) {
+    zmutex_lock(&e->lock);
+    while(zexec_state(e) == ZEXEC_RUNNING)
+        zcond_wait(&e->done, &e->lock);
+    zmutex_unlock(&e->lock);
+    return zexec_state(e);
+}
+
+zexec_timing *zexec_node_timing(zexec *e, zd_node *node) {
+    if(node->id >= e->slot_cnt || !e->slot_task[node->id]) return 0;
+    zexec_task *task = &e->tasks[e->slot_task[node->id] - 1];
+    return task->node == node ? &e->timing[e->slot_task[node->id] - 1] : 0;
+}
+
+u64 zexec_run_ns(zexec *e) {
+    if(!e->start_ns) return 0;
+    u64 end = zatomic_load(&e->end_ns, ZATOMIC_ACQUIRE);
+    return (end ? end : zthread_ns()) - e->start_ns;
+}
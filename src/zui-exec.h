@@ -0,0 +1,66 @@
+#ifndef ZEXEC_INCLUDED
+#define ZEXEC_INCLUDED
+#include "zui-node.h"
+
+// Dataflow execution of a node graph on a pool of worker threads.
+// Compute callbacks are registered per uud_type. zexec_run takes a snapshot of the editor's graph (which nodes feed
+// which) and returns right away: a node is queued once every node linked to its inputs has finished, and workers
+// take queued nodes from their own deque, or steal the oldest from another worker's when theirs is empty.
+// The UI thread polls zexec_state from its frame.
+//
+// While a run is going the graph's links and nodes must not be added or deleted, moving nodes is fine. To edit,
+// cancel and wait: nodes that haven't started are skipped, so that only waits for the callbacks running.
+// A callback returning false fails its node, and the nodes downstream of it are skipped.
+//
+// POSIX threads, or Win32 threads on Windows (zui-thread.h).
+
+enum ZEXEC_STATES {
+    ZEXEC_IDLE,
+    ZEXEC_RUNNING,
+    ZEXEC_DONE,
+    ZEXEC_CANCELLED,
+};
+
+// of a node in the last run
+enum ZEXEC_NODE_STATES {
+    ZEXEC_NODE_WAITING,
+    ZEXEC_NODE_RUNNING,
+    ZEXEC_NODE_DONE,
+    ZEXEC_NODE_FAILED,
+    ZEXEC_NODE_SKIPPED,  // cancelled, or downstream of a failed node
+};
+
+// Runs on a worker thread. The nodes linked to <node>'s inputs are done by then
+typedef bool (*zexec_fn)(zd_node *node, void *user_data);
+
+typedef struct zexec_timing {
+    u64 start_ns;  // since the run started
+    u64 ns;        // in the callback
+    u16 worker;
+    u8 state;
+} zexec_timing;
+
+typedef struct zexec zexec;
+
+// <threads> workers, 0 for one per CPU
+zexec *zexec_new(i32 threads);
+i32 zexec_threads(zexec *e);
+// waits for the run, stops the workers
+void zexec_free(zexec *e);
+// Nodes of a type without a callback finish immediately
+void zexec_register(zexec *e, i32 uud_type, zexec_fn fn, void *user_data);
+// false if a run is still going
+bool zexec_run(zexec *e, zd_node_editor *state);
+i32 zexec_state(zexec *e);
+// nodes finished (done, failed or skipped) out of all the nodes of the run
+u32 zexec_progress(zexec *e, u32 *total);
+void zexec_cancel(zexec *e);
+// for long callbacks to return early once the run is cancelled
+bool zexec_cancelled(zexec *e);
+// blocks until the run is over, returns its state
+i32 zexec_wait(zexec *e);
+// of <node> in the last run, 0 if it wasn't part of it. Times are final once the state is done, failed or skipped
+zexec_timing *zexec_node_timing(zexec *e, zd_node *node);
+// wall time of the last run, so far if it's still going
+u64 zexec_run_ns(zexec *e);
+#endif
@@ -0,0 +1,606 @@
+#define ZUI_DEV
+#include "zui.h"
+#include "zui-layout.h"
+#include "zui-thread.h"
+#include <stdlib.h>
+#include <string.h>
+
+// what the last run made of the node in a slot
+typedef struct zlayout_prev {
+    void *uud;
+    i32 uud_type;
+    u32 sig;
+    u32 layer;
+    f32 y;
+    zvec2 pos;
+    bool valid;
+} zlayout_prev;
+
+// a node of the snapshot, in topological order
+typedef struct zlayout_node {
+    u32 slot;
+    void *uud;
+    i32 uud_type;
+    f32 w, h;
+    u32 in, in_cnt;      // a range of zlayout.inputs, the nodes linked to its inputs
+    u32 layer;
+    u32 sig;             // of its size and of the slots it's linked to
+    bool stable;         // same layer and sig as in the last run
+    bool moved;
+    zvec2 pos;
+} zlayout_node;
+
+// a node, or a placeholder of a link crossing its layer. Nodes come first, with their index in the snapshot
+typedef struct zlayout_vert {
+    u32 from, to;        // slots of the link's ends, for placeholders
+    u32 layer;
+    f32 h;
+    f32 y;
+    f32 key;
+    u32 up, up_cnt;      // ranges of zlayout.adj, the neighbors in the layer before
+    u32 down, down_cnt;  // and in the layer after
+} zlayout_vert;
+
+// the height of a placeholder in the last run
+typedef struct zlayout_ghost {
+    u32 from, to, layer;
+    f32 y;
+} zlayout_ghost;
+
+typedef struct zlayout_sort {
+    f32 key;
+    u32 rank;
+    u32 v;
+} zlayout_sort;
+
+struct zlayout {
+    zlayout_config config;
+    zthread thread;
+    bool joinable;
+    u32 state;           // atomic
+    zlayout_stats stats;
+    // snapshot
+    zd_node **order;
+    zlayout_node *nodes;
+    u32 node_cnt, node_cap;
+    u32 *inputs;
+    u32 input_cnt, input_cap;
+    u32 *slot_node;      // slot -> snapshot index + 1
+    zlayout_prev *prev;  // by slot
+    zlayout_ghost *ghosts; // open addressing, from 1 for empty
+    u32 ghost_cap;
+    u32 slot_cnt, slot_cap;
+    bool first;
+    bool full;           // of this run, every column redone
+    f32 scale;
+    // the layered graph
+    zlayout_vert *verts;
+    u32 vert_cnt, vert_cap;
+    u32 *adj;
+    u32 adj_cap;
+    u32 *rank;           // of each vertex in its layer, apart as the sweeps read little else
+    u32 *best;           // layer_verts with the fewest crossings so far
+    u32 *layer_start;    // layer_cnt + 1 offsets into layer_verts, which are in rank order
+    u32 *layer_verts;
+    u32 layer_cnt, layer_cap;
+    u8 *redo;
+    u64 *crossings;      // between each layer and the next
+    f32 *column_x, *column_w;
+    zlayout_sort *sort;
+    f32 *fwd, *bwd;
+    u32 *tree;
+    u32 scratch_cap;
+};
+
+static void *_zlayout_grow(void *p, u32 *cap, u32 need, u32 size) {
+    if(p && need <= *cap) return p;
+    *cap = need * 2 + 16;
+    return ZUI_REALLOC(p, (size_t)*cap * size);
+}
+
+static u32 _zlayout_mix(u32 x) {
+    x = (x ^ (x >> 16)) * 0x7FEB352D;
+    x = (x ^ (x >> 15)) * 0x846CA68B;
+    return x ^ (x >> 16);
+}
+
+static u32 _zlayout_ghost_hash(zlayout_vert *v) {
+    return _zlayout_mix(v->from * 0x9E3779B1 + _zlayout_mix(v->to) + v->layer * 0x85EBCA77);
+}
+
+// the height <v> had, if it was a placeholder of the same link in the same layer
+static zlayout_ghost *_zlayout_ghost(zlayout *l, zlayout_vert *v) {
+    if(!l->ghost_cap) return 0;
+    for(u32 i = _zlayout_ghost_hash(v);; i++) {
+        zlayout_ghost *g = &l->ghosts[i & (l->ghost_cap - 1)];
+        if(!g->from) return 0;
+        if(g->from == v->from + 1 && g->to == v->to && g->layer == v->layer) return g;
+    }
+}
+
+// keeps the placeholders' heights for the next run
+static void _zlayout_ghosts_keep(zlayout *l) {
+    u32 cnt = l->vert_cnt - l->node_cnt, cap = 16;
+    while(cap < cnt * 2) cap *= 2;
+    if(cap != l->ghost_cap) {
+        ZUI_FREE(l->ghosts);
+        l->ghosts = ZUI_MALLOC(cap * sizeof(zlayout_ghost));
+        l->ghost_cap = cap;
+    }
+    memset(l->ghosts, 0, cap * sizeof(zlayout_ghost));
+    for(u32 v = l->node_cnt; v < l->vert_cnt; v++) {
+        zlayout_vert *vert = &l->verts[v];
+        for(u32 i = _zlayout_ghost_hash(vert);; i++) {
+            zlayout_ghost *g = &l->ghosts[i & (cap - 1)];
+            // the same link twice, through other ports, goes through the same heights
+            if(g->from && (g->from != vert->from + 1 || g->to != vert->to || g->layer != vert->layer)) continue;
+            *g = (zlayout_ghost) { vert->from + 1, vert->to, vert->layer, vert->y };
+            break;
+        }
+    }
+}
+
+static i32 _zlayout_cmp(const void *a, const void *b) {
+    const zlayout_sort *x = a, *y = b;
+    if(x->key != y->key) return x->key < y->key ? -1 : 1;
+    return x->rank < y->rank ? -1 : x->rank > y->rank;
+}
+
+// sorts a layer by the keys of its vertices, ties keep their order
+static void _zlayout_sort_layer(zlayout *l, u32 layer) {
+    u32 *lv = l->layer_verts + l->layer_start[layer], cnt = l->layer_start[layer + 1] - l->layer_start[layer];
+    for(u32 i = 0; i < cnt; i++)
+        l->sort[i] = (zlayout_sort) { l->verts[lv[i]].key, i, lv[i] };
+    // after the first sweeps layers are nearly sorted already, insertion sort until it proves too slow
+    u32 shifts = 0;
+    for(u32 i = 1; i < cnt && shifts <= cnt * 32; i++) {
+        zlayout_sort x = l->sort[i];
+        u32 j = i;
+        for(; j && _zlayout_cmp(&l->sort[j - 1], &x) > 0; j--)
+            l->sort[j] = l->sort[j - 1];
+        l->sort[j] = x;
+        shifts += i - j;
+    }
+    if(shifts > cnt * 32) qsort(l->sort, cnt, sizeof(zlayout_sort), _zlayout_cmp);
+    for(u32 i = 0; i < cnt; i++) {
+        lv[i] = l->sort[i].v;
+        l->rank[lv[i]] = i;
+    }
+}
+
+// mean rank of the neighbors in the layer before (up) or after, the vertex's own rank without any
+static f32 _zlayout_barycenter(zlayout *l, u32 v, bool up) {
+    zlayout_vert *vert = &l->verts[v];
+    u32 at = up ? vert->up : vert->down, cnt = up ? vert->up_cnt : vert->down_cnt;
+    if(!cnt) return l->rank[v];
+    f32 sum = 0;
+    for(u32 i = at; i < at + cnt; i++)
+        sum += l->rank[l->adj[i]];
+    return sum / cnt;
+}
+
+// Crossings between layer <k> and the next: the links sorted by the rank of their upper end, then of their lower end,
+// cross as many times as the lower ranks are out of order, counted with a Fenwick tree over the lower layer
+static u64 _zlayout_crossings_at(zlayout *l, u32 k) {
+    u64 total = 0;
+    u32 lower = l->layer_start[k + 2] - l->layer_start[k + 1], seen = 0;
+    memset(l->tree, 0, (lower + 1) * sizeof(u32));
+    for(u32 i = l->layer_start[k]; i < l->layer_start[k + 1]; i++) {
+        zlayout_vert *v = &l->verts[l->layer_verts[i]];
+        // the few links of a vertex are sorted in place, by insertion
+        u32 *d = l->adj + v->down;
+        for(u32 a = 1; a < v->down_cnt; a++)
+            for(u32 b = a; b && l->rank[d[b - 1]] > l->rank[d[b]]; b--) {
+                u32 t = d[b]; d[b] = d[b - 1]; d[b - 1] = t;
+            }
+        for(u32 a = 0; a < v->down_cnt; a++) {
+            u32 r = l->rank[d[a]] + 1, below = 0;
+            for(u32 j = r; j; j -= j & -j)
+                below += l->tree[j];
+            total += seen - below;
+            for(u32 j = r; j <= lower; j += j & -j)
+                l->tree[j]++;
+            seen++;
+        }
+    }
+    return total;
+}
+
+// of the whole graph, only recounted next to the layers being redone unless <all>
+static u64 _zlayout_crossings(zlayout *l, bool all) {
+    u64 total = 0;
+    for(u32 k = 0; k + 1 < l->layer_cnt; k++) {
+        if(all || l->redo[k] || l->redo[k + 1]) l->crossings[k] = _zlayout_crossings_at(l, k);
+        total += l->crossings[k];
+    }
+    return total;
+}
+
+// Puts the vertices of a layer as close to their key as they can get in rank order, <gap> apart: the mean of packing
+// them from the top and from the bottom, packed again from the top
+static void _zlayout_place(zlayout *l, u32 layer, f32 gap) {
+    u32 *lv = l->layer_verts + l->layer_start[layer], cnt = l->layer_start[layer + 1] - l->layer_start[layer];
+    if(!cnt) return;
+    for(u32 i = 0; i < cnt; i++) {
+        zlayout_vert *v = &l->verts[lv[i]];
+        l->fwd[i] = i && l->fwd[i - 1] + l->verts[lv[i - 1]].h + gap > v->key ? l->fwd[i - 1] + l->verts[lv[i - 1]].h + gap : v->key;
+    }
+    for(u32 i = cnt; i--;) {
+        zlayout_vert *v = &l->verts[lv[i]];
+        l->bwd[i] = i + 1 < cnt && l->bwd[i + 1] - v->h - gap < v->key ? l->bwd[i + 1] - v->h - gap : v->key;
+    }
+    for(u32 i = 0; i < cnt; i++) {
+        f32 y = (l->fwd[i] + l->bwd[i]) / 2;
+        if(i && y < l->verts[lv[i - 1]].y + l->verts[lv[i - 1]].h + gap) y = l->verts[lv[i - 1]].y + l->verts[lv[i - 1]].h + gap;
+        l->verts[lv[i]].y = y;
+    }
+}
+
+// the mean center of the neighbors above (up) or below, minus half the vertex's height. Its own y without any
+static f32 _zlayout_pull(zlayout *l, zlayout_vert *v, bool up) {
+    u32 at = up ? v->up : v->down, cnt = up ? v->up_cnt : v->down_cnt;
+    if(!cnt) return v->y;
+    f32 sum = 0;
+    for(u32 i = at; i < at + cnt; i++)
+        sum += l->verts[l->adj[i]].y + l->verts[l->adj[i]].h / 2;
+    return sum / cnt - v->h / 2;
+}
+
+// builds the layers and the placeholders, finds the nodes that changed
+static void _zlayout_layer(zlayout *l) {
+    u32 n = l->node_cnt, layers = 0, changed = 0, segments = 0;
+    for(u32 i = 0; i < n; i++) {
+        zlayout_node *node = &l->nodes[i];
+        node->layer = 0;
+        node->sig = _zlayout_mix((u32)node->w * 65599 + (u32)node->h);
+        for(u32 k = node->in; k < node->in + node->in_cnt; k++) {
+            zlayout_node *from = &l->nodes[l->inputs[k]];
+            if(from->layer + 1 > node->layer) node->layer = from->layer + 1;
+        }
+        if(node->layer + 1 > layers) layers = node->layer + 1;
+    }
+    for(u32 i = 0; i < n; i++) {
+        zlayout_node *node = &l->nodes[i];
+        for(u32 k = node->in; k < node->in + node->in_cnt; k++) {
+            zlayout_node *from = &l->nodes[l->inputs[k]];
+            node->sig += _zlayout_mix(from->slot * 2 + 1);
+            from->sig += _zlayout_mix(node->slot * 2);
+            segments += node->layer - from->layer;
+        }
+    }
+    for(u32 i = 0; i < n; i++) {
+        zlayout_node *node = &l->nodes[i];
+        zlayout_prev *p = &l->prev[node->slot];
+        node->stable = !l->first && p->valid && p->uud == node->uud && p->uud_type == node->uud_type && p->sig == node->sig && p->layer == node->layer;
+        changed += !node->stable;
+    }
+    f32 full_above = l->config.full_above ? l->config.full_above : 0.25f;
+    bool full = l->full = l->first || changed > n * full_above;
+
+    u32 t = n + segments - l->input_cnt;
+    l->verts = _zlayout_grow(l->verts, &l->vert_cap, t, sizeof(zlayout_vert));
+    l->adj = _zlayout_grow(l->adj, &l->adj_cap, segments * 2, sizeof(u32));
+    l->layer_start = _zlayout_grow(l->layer_start, &l->layer_cap, layers + 2, sizeof(u32));
+    l->layer_verts = ZUI_REALLOC(l->layer_verts, (size_t)l->vert_cap * sizeof(u32));
+    l->best = ZUI_REALLOC(l->best, (size_t)l->vert_cap * sizeof(u32));
+    l->rank = ZUI_REALLOC(l->rank, (size_t)l->vert_cap * sizeof(u32));
+    l->redo = ZUI_REALLOC(l->redo, l->layer_cap);
+    l->crossings = ZUI_REALLOC(l->crossings, l->layer_cap * sizeof(u64));
+    l->column_x = ZUI_REALLOC(l->column_x, l->layer_cap * sizeof(f32));
+    l->column_w = ZUI_REALLOC(l->column_w, l->layer_cap * sizeof(f32));
+    l->vert_cnt = t;
+    l->layer_cnt = layers;
+    memset(l->verts, 0, (size_t)t * sizeof(zlayout_vert));
+    memset(l->redo, full, layers);
+    for(u32 i = 0; i < n; i++) {
+        l->verts[i].layer = l->nodes[i].layer;
+        l->verts[i].h = l->nodes[i].h;
+        if(!l->nodes[i].stable) l->redo[l->nodes[i].layer] = 1;
+    }
+    // every link is a chain of segments between neighboring layers, the placeholders numbered in the same order on
+    // both passes: counting, then filling the ranges
+    for(u32 pass = 0; pass < 2; pass++) {
+        u32 d = n;
+        for(u32 i = 0; i < n; i++) {
+            zlayout_node *node = &l->nodes[i];
+            for(u32 k = node->in; k < node->in + node->in_cnt; k++) {
+                u32 from = l->inputs[k];
+                for(u32 layer = l->nodes[from].layer + 1; layer <= node->layer; layer++) {
+                    u32 to = layer == node->layer ? i : d++;
+                    zlayout_vert *a = &l->verts[from], *b = &l->verts[to];
+                    if(pass) {
+                        l->adj[a->down + a->down_cnt++] = to;
+                        l->adj[b->up + b->up_cnt++] = from;
+                    } else {
+                        a->down_cnt++;
+                        b->up_cnt++;
+                        b->layer = layer;
+                        b->from = l->nodes[l->inputs[k]].slot;
+                        b->to = node->slot;
+                    }
+                    from = to;
+                }
+            }
+        }
+        if(pass) break;
+        u32 at = 0;
+        for(u32 v = 0; v < t; v++) {
+            zlayout_vert *vert = &l->verts[v];
+            vert->up = at;
+            at += vert->up_cnt;
+            vert->down = at;
+            at += vert->down_cnt;
+            vert->up_cnt = vert->down_cnt = 0;
+        }
+    }
+    memset(l->layer_start, 0, (layers + 2) * sizeof(u32));
+    for(u32 v = 0; v < t; v++)
+        l->layer_start[l->verts[v].layer + 2]++;
+    for(u32 k = 0; k < layers; k++)
+        l->layer_start[k + 2] += l->layer_start[k + 1];
+    for(u32 v = 0; v < t; v++) {
+        u32 at = l->layer_start[l->verts[v].layer + 1]++;
+        l->layer_verts[at] = v;
+        l->rank[v] = at - l->layer_start[l->verts[v].layer];
+    }
+
+    u32 widest = 1;
+    for(u32 k = 0; k < layers; k++)
+        if(l->layer_start[k + 1] - l->layer_start[k] > widest) widest = l->layer_start[k + 1] - l->layer_start[k];
+    if(widest > l->scratch_cap) {
+        l->scratch_cap = widest * 2;
+        l->sort = ZUI_REALLOC(l->sort, l->scratch_cap * sizeof(zlayout_sort));
+        l->fwd = ZUI_REALLOC(l->fwd, l->scratch_cap * sizeof(f32));
+        l->bwd = ZUI_REALLOC(l->bwd, l->scratch_cap * sizeof(f32));
+        l->tree = ZUI_REALLOC(l->tree, (l->scratch_cap + 1) * sizeof(u32));
+    }
+    l->stats = (zlayout_stats) { .nodes = n, .links = l->input_cnt, .placeholders = t - n, .columns = layers, .changed = changed };
+}
+
+// Orders every layer top to bottom before crossing reduction. The first time by topological order and barycenters,
+// layer by layer. Afterwards by height: nodes and placeholders that didn't change at the height they had, the others
+// at the mean height of what they're linked to in the layer before. Columns that aren't redone keep these as heights
+static void _zlayout_initial_order(zlayout *l, bool full) {
+    for(u32 k = 0; k < l->layer_cnt; k++) {
+        for(u32 i = l->layer_start[k]; i < l->layer_start[k + 1]; i++) {
+            u32 v = l->layer_verts[i];
+            zlayout_vert *vert = &l->verts[v];
+            if(full) {
+                vert->key = k ? _zlayout_barycenter(l, v, true) : v;
+                continue;
+            }
+            zlayout_node *node = v < l->node_cnt ? &l->nodes[v] : 0;
+            zlayout_prev *p = node ? &l->prev[node->slot] : 0;
+            zlayout_ghost *g = node ? 0 : _zlayout_ghost(l, vert);
+            if(node && p->valid && p->uud == node->uud && p->uud_type == node->uud_type && (node->stable || !vert->up_cnt)) {
+                vert->key = p->y;
+            } else if(g) {
+                vert->key = g->y;
+            } else if(vert->up_cnt) {
+                f32 sum = 0;
+                for(u32 a = vert->up; a < vert->up + vert->up_cnt; a++)
+                    sum += l->verts[l->adj[a]].key;
+                vert->key = sum / vert->up_cnt;
+            } else {
+                vert->key = 1e30f; // a new node without inputs goes last
+            }
+        }
+        _zlayout_sort_layer(l, k);
+    }
+}
+
+static void _zlayout_coordinates(zlayout *l, bool full) {
+    f32 gap = l->config.row_gap ? l->config.row_gap : 20, column_gap = l->config.column_gap ? l->config.column_gap : 80;
+    u32 n = l->node_cnt;
+    for(u32 k = 0; k < l->layer_cnt; k++)
+        l->column_w[k] = 0;
+    for(u32 i = 0; i < n; i++)
+        if(l->nodes[i].w > l->column_w[l->nodes[i].layer]) l->column_w[l->nodes[i].layer] = l->nodes[i].w;
+    for(u32 k = 0; k < l->layer_cnt; k++)
+        l->column_x[k] = k ? l->column_x[k - 1] + l->column_w[k - 1] + column_gap : 0;
+
+    // the columns kept as they were stay at the heights they were ordered by, the others start packed
+    for(u32 k = 0; k < l->layer_cnt; k++) {
+        f32 y = 0;
+        for(u32 i = l->layer_start[k]; i < l->layer_start[k + 1]; i++) {
+            zlayout_vert *v = &l->verts[l->layer_verts[i]];
+            v->y = l->redo[k] ? y : v->key;
+            y += v->h + gap;
+        }
+    }
+    // the redone ones are pulled toward the layer before, then the layer after
+    for(u32 iter = 0; iter < 4; iter++) {
+        bool up = !(iter & 1);
+        for(u32 j = 0; j < l->layer_cnt; j++) {
+            u32 k = up ? j : l->layer_cnt - 1 - j;
+            if(!l->redo[k]) continue;
+            for(u32 i = l->layer_start[k]; i < l->layer_start[k + 1]; i++) {
+                zlayout_vert *v = &l->verts[l->layer_verts[i]];
+                v->key = _zlayout_pull(l, v, up);
+            }
+            _zlayout_place(l, k, gap);
+        }
+    }
+
+    // the first run starts at 0, later ones stay where the graph already is
+    f32 top = 0, right = 0, bottom = 0;
+    if(full) {
+        top = 1e30f;
+        for(u32 i = 0; i < n; i++)
+            if(l->verts[i].y < top) top = l->verts[i].y;
+        if(!n) top = 0;
+        for(u32 i = 0; i < l->vert_cnt; i++)
+            l->verts[i].y -= top;
+    }
+    for(u32 i = 0; i < n; i++) {
+        zlayout_node *node = &l->nodes[i];
+        f32 r = l->column_x[node->layer] + node->w, b = l->verts[i].y + node->h, t = -l->verts[i].y;
+        if(r > right) right = r;
+        if(b > bottom) bottom = b;
+        if(t > bottom) bottom = t;
+    }
+    f32 extent = right > bottom ? right : bottom, scale = extent > 32000 ? 32000 / extent : 1;
+    // a new scale moves everything
+    bool rescaled = scale != l->scale;
+    l->scale = scale;
+    for(u32 i = 0; i < n; i++) {
+        zlayout_node *node = &l->nodes[i];
+        zlayout_prev *p = &l->prev[node->slot];
+        node->pos = (zvec2) { (i16)(l->column_x[node->layer] * scale + 0.5f), (i16)(l->verts[i].y * scale + (l->verts[i].y < 0 ? -0.5f : 0.5f)) };
+        node->moved = full || rescaled || !node->stable || p->pos.x != node->pos.x || p->pos.y != node->pos.y;
+    }
+}
+
+static ZTHREAD_FN _zlayout_thread(void *arg) {
+    zlayout *l = arg;
+    u64 start = zthread_ns();
+    _zlayout_layer(l);
+    _zlayout_initial_order(l, l->full);
+    u64 best = l->stats.crossings_before = _zlayout_crossings(l, true);
+    memcpy(l->best, l->layer_verts, l->vert_cnt * sizeof(u32));
+    // sweeps can add crossings too, the order with the fewest is kept
+    i32 sweeps = l->config.sweeps ? l->config.sweeps : 8;
+    for(i32 s = 0; s < sweeps && best; s++) {
+        bool up = !(s & 1);
+        for(u32 j = 1; j < l->layer_cnt; j++) {
+            u32 k = up ? j : l->layer_cnt - 1 - j;
+            if(!l->redo[k]) continue;
+            for(u32 i = l->layer_start[k]; i < l->layer_start[k + 1]; i++)
+                l->verts[l->layer_verts[i]].key = _zlayout_barycenter(l, l->layer_verts[i], up);
+            _zlayout_sort_layer(l, k);
+        }
+        u64 crossings = _zlayout_crossings(l, false);
+        if(crossings < best) {
+            best = crossings;
+            memcpy(l->best, l->layer_verts, l->vert_cnt * sizeof(u32));
+        }
+    }
+    memcpy(l->layer_verts, l->best, l->vert_cnt * sizeof(u32));
+    for(u32 k = 0; k < l->layer_cnt; k++)
+        for(u32 i = l->layer_start[k]; i < l->layer_start[k + 1]; i++)
+            l->rank[l->layer_verts[i]] = i - l->layer_start[k];
+    l->stats.crossings = best;
+    _zlayout_coordinates(l, l->full);
+    _zlayout_ghosts_keep(l);
+
+    memset(l->prev, 0, l->slot_cap * sizeof(zlayout_prev));
+    for(u32 i = 0; i < l->node_cnt; i++) {
+        zlayout_node *node = &l->nodes[i];
+        l->prev[node->slot] = (zlayout_prev) { node->uud, node->uud_type, node->sig, node->layer, l->verts[i].y, node->pos, true };
+    }
+    for(u32 k = 0; k < l->layer_cnt; k++)
+        l->stats.columns_redone += l->redo[k];
+    l->stats.scale = l->scale;
+    l->first = false;
+    l->stats.ns = zthread_ns() - start;
+    zatomic_store(&l->state, ZLAYOUT_DONE, ZATOMIC_RELEASE);
+    return 0;
+}
+
+static void _zlayout_join(zlayout *l) {
+    if(!l->joinable) return;
+    zthread_join(l->thread);
+    l->joinable = false;
+}
+
+zlayout *zlayout_new(zlayout_config *config) {
+    zlayout *l = ZUI_CALLOC(1, sizeof(zlayout));
+    if(config) l->config = *config;
+    l->first = true;
+    return l;
+}
+
+void zlayout_free(zlayout *l) {
+    _zlayout_join(l);
+    ZUI_FREE(l->order);
+    ZUI_FREE(l->nodes);
+    ZUI_FREE(l->inputs);
+    ZUI_FREE(l->slot_node);
+    ZUI_FREE(l->prev);
+    ZUI_FREE(l->verts);
+    ZUI_FREE(l->adj);
+    ZUI_FREE(l->layer_start);
+    ZUI_FREE(l->layer_verts);
+    ZUI_FREE(l->best);
+    ZUI_FREE(l->rank);
+    ZUI_FREE(l->ghosts);
+    ZUI_FREE(l->redo);
+    ZUI_FREE(l->crossings);
+    ZUI_FREE(l->column_x);
+    ZUI_FREE(l->column_w);
+    ZUI_FREE(l->sort);
+    ZUI_FREE(l->fwd);
+    ZUI_FREE(l->bwd);
+    ZUI_FREE(l->tree);
+    ZUI_FREE(l);
+}
+
+bool zlayout_run(zlayout *l, zd_node_editor *state) {
+    if(zlayout_state(l) == ZLAYOUT_RUNNING) return false;
+    _zlayout_join(l);
+    u32 n = state->node_cnt, node_cap = l->node_cap;
+    l->nodes = _zlayout_grow(l->nodes, &l->node_cap, n, sizeof(zlayout_node));
+    if(l->node_cap != node_cap) l->order = ZUI_REALLOC(l->order, l->node_cap * sizeof(zd_node*));
+    l->inputs = _zlayout_grow(l->inputs, &l->input_cap, state->link_cnt, sizeof(u32));
+    if(state->nodes.end > l->slot_cap) {
+        u32 old = l->slot_cap;
+        l->slot_cap = state->nodes.end * 2;
+        l->slot_node = ZUI_REALLOC(l->slot_node, l->slot_cap * sizeof(u32));
+        l->prev = ZUI_REALLOC(l->prev, l->slot_cap * sizeof(zlayout_prev));
+        memset(l->prev + old, 0, (l->slot_cap - old) * sizeof(zlayout_prev));
+    }
+    l->slot_cnt = state->nodes.end;
+    l->node_cnt = znode_toposort(state, l->order);
+    zvec2 size = l->config.node_size.x ? l->config.node_size : (zvec2) { 150, 60 };
+    for(u32 i = 0; i < l->node_cnt; i++) {
+        zd_node *node = l->order[i];
+        l->nodes[i] = (zlayout_node) {
+            .slot = node->id,
+            .uud = node->uud,
+            .uud_type = node->uud_type,
+            .w = node->rect.w ? node->rect.w : size.x,
+            .h = node->rect.h ? node->rect.h : size.y,
+        };
+        l->slot_node[node->id] = i + 1;
+    }
+    u32 k = 0;
+    for(u32 i = 0; i < l->node_cnt; i++) {
+        l->nodes[i].in = k;
+        FOR_INPUTS(l->order[i])
+            l->inputs[k++] = l->slot_node[link->output->id] - 1;
+        l->nodes[i].in_cnt = k - l->nodes[i].in;
+    }
+    l->input_cnt = k;
+    zatomic_store(&l->state, ZLAYOUT_RUNNING, ZATOMIC_RELEASE);
+    l->joinable = zthread_start(&l->thread, _zlayout_thread, l);
+    if(!l->joinable) _zlayout_thread(l);
+    return true;
+}
+
+i32 zlayout_state(zlayout *l) {
+    return zatomic_load(&l->state, ZATOMIC_ACQUIRE);
+}
+
+i32 zlayout_wait(zlayout *l) {
+    _zlayout_join(l);
+    return zlayout_state(l);
+}
+
+i32 zlayout_apply(zlayout *l, zd_node_editor *state) {
+    if(zlayout_state(l) != ZLAYOUT_DONE) return 0;
+    _zlayout_join(l);
+    i32 moved = 0;
+    for(u32 i = 0; i < l->node_cnt; i++) {
+        zlayout_node *n = &l->nodes[i];
+        zd_node *node = znode_at(state, n->slot);
+        if(!n->moved || !node || node->uud != n->uud || node->uud_type != n->uud_type) continue;
+        znode_move(state, node, n->pos);
+        moved++;
+    }
+    zatomic_store(&l->state, ZLAYOUT_IDLE, ZATOMIC_RELEASE);
+    return moved;
+}
+
+zlayout_stats *zlayout_get_stats(zlayout *l) {
+    return &l->stats;
+}
@@ -0,0 +1,54 @@
+#ifndef ZLAYOUT_INCLUDED
+#define ZLAYOUT_INCLUDED
+#include "zui-node.h"
+
+// Layered (Sugiyama) layout of a node graph, computed on a background thread.
+// Every node goes in the column of the longest path to it along the topological order, and links spanning several
+// columns go through a placeholder in each column in between. Each column is sorted by the barycenter of the
+// neighbors in the column before or after it over a few sweeps, keeping the order with the fewest crossings, then the
+// nodes are pulled to the height of their neighbors without overlapping.
+// zlayout_run snapshots the graph and returns right away, the UI thread polls zlayout_state from its frame and
+// zlayout_apply moves the nodes once it's done. After small edits only the columns holding nodes whose links, size or
+// column changed are redone: the other nodes keep their order and position, and so do nodes moved by hand since.
+//
+// Positions are i16, a graph laid out wider or taller than that is scaled down to fit, where nodes may overlap.
+// POSIX threads, or Win32 threads on Windows (zui-thread.h).
+
+enum ZLAYOUT_STATES {
+    ZLAYOUT_IDLE,
+    ZLAYOUT_RUNNING,
+    ZLAYOUT_DONE,     // until zlayout_apply
+};
+
+typedef struct zlayout_config {
+    i32 column_gap;   // between columns, 0 for 80
+    i32 row_gap;      // between the nodes of a column, 0 for 20
+    zvec2 node_size;  // of nodes that were never laid out, 0 for 150 x 60
+    i32 sweeps;       // of crossing reduction, 0 for 8
+    f32 full_above;   // share of changed nodes past which the whole graph is laid out again, 0 for 0.25
+} zlayout_config;
+
+typedef struct zlayout_stats {
+    u32 nodes, links, placeholders, columns;
+    u32 changed;        // nodes whose links, size or column changed since the last run, all of them in the first
+    u32 columns_redone;
+    u64 crossings_before, crossings; // of links between neighboring columns, before and after crossing reduction
+    f32 scale;
+    u64 ns;             // on the background thread
+} zlayout_stats;
+
+typedef struct zlayout zlayout;
+
+// <config> may be 0
+zlayout *zlayout_new(zlayout_config *config);
+// waits for the run
+void zlayout_free(zlayout *l);
+// false if a run is still going. The graph can be edited while it runs, zlayout_apply skips deleted nodes
+bool zlayout_run(zlayout *l, zd_node_editor *state);
+i32 zlayout_state(zlayout *l);
+// blocks until the run is over, returns its state
+i32 zlayout_wait(zlayout *l);
+// Once done, moves the nodes whose position changed with znode_move and returns how many. The layout is idle again
+i32 zlayout_apply(zlayout *l, zd_node_editor *state);
+zlayout_stats *zlayout_get_stats(zlayout *l);
+#endif
@@ -4,7 +4,12 @@
 #define ZUI_DEV
 #include "zui.h"
 #include "zui-node.h"
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 #define ID ZW_NODE_EDITOR
 
@@ -14,16 +19,429 @@ i32 ZSC_NODE_OUTPUT;
 i32 ZSC_NODE_FOUTPUT;
 i32 ZSC_NODE_INPUT;
 i32 ZSC_NODE_FINPUT;
+i32 ZSC_NODE_SELECTED;
+
+#ifdef _MSC_VER
+static u32 _znode_ctz(u64 bits) { unsigned long i; _BitScanForward64(&i, bits); return i; }
+#define _znode_prefetch(p) ((void)(p))
+#else
+static u32 _znode_ctz(u64 bits) { return __builtin_ctzll(bits); }
+#define _znode_prefetch(p) __builtin_prefetch(p)
+#endif
+
+static void *_zpool_at(zd_node_pool *pool, u32 id) {
+    return pool->blocks[id / ZNODE_BLOCK] + (size_t)(id % ZNODE_BLOCK) * pool->size;
+}
+static bool _zpool_live(zd_node_pool *pool, u32 id) {
+    return id < pool->end && (pool->live[id / 64] >> (id % 64) & 1);
+}
+// a zeroed element, its slot in <id>. Reuses deleted slots first
+static void *_zpool_alloc(zd_node_pool *pool, u32 size, u32 *id) {
+    pool->size = size;
+    if(pool->free_cnt) {
+        *id = pool->free[--pool->free_cnt];
+    } else {
+        if(pool->end == pool->block_cnt * ZNODE_BLOCK) {
+            pool->blocks = ZUI_REALLOC(pool->blocks, (pool->block_cnt + 1) * sizeof(u8*));
+            pool->blocks[pool->block_cnt] = ZUI_MALLOC((size_t)ZNODE_BLOCK * size);
+            pool->live = ZUI_REALLOC(pool->live, (pool->block_cnt + 1) * (ZNODE_BLOCK / 8));
+            memset(pool->live + pool->block_cnt * (ZNODE_BLOCK / 64), 0, ZNODE_BLOCK / 8);
+            pool->block_cnt++;
+        }
+        *id = pool->end++;
+    }
+    pool->live[*id / 64] |= 1ULL << (*id % 64);
+    return memset(_zpool_at(pool, *id), 0, size);
+}
+// <cnt> live slots from 0 in an empty pool, left for the caller to fill
+static void _zpool_fill(zd_node_pool *pool, u32 size, u32 cnt) {
+    pool->size = size;
+    pool->block_cnt = (cnt + ZNODE_BLOCK - 1) / ZNODE_BLOCK;
+    pool->blocks = ZUI_MALLOC(pool->block_cnt * sizeof(u8*));
+    pool->live = ZUI_CALLOC(pool->block_cnt, ZNODE_BLOCK / 8);
+    for(u32 i = 0; i < pool->block_cnt; i++)
+        pool->blocks[i] = ZUI_MALLOC((size_t)ZNODE_BLOCK * size);
+    for(u32 i = 0; i < cnt / 64; i++)
+        pool->live[i] = ~0ULL;
+    if(cnt % 64) pool->live[cnt / 64] = (1ULL << (cnt % 64)) - 1;
+    pool->end = cnt;
+}
+static void _zpool_free(zd_node_pool *pool, u32 id) {
+    pool->live[id / 64] &= ~(1ULL << (id % 64));
+    if(pool->free_cnt == pool->free_cap) {
+        pool->free_cap = pool->free_cap ? pool->free_cap * 2 : 64;
+        pool->free = ZUI_REALLOC(pool->free, pool->free_cap * sizeof(u32));
+    }
+    pool->free[pool->free_cnt++] = id;
+}
+// first live slot from <id> on, pool->end if there's none
+static u32 _zpool_next(zd_node_pool *pool, u32 id) {
+    if(id >= pool->end) return pool->end;
+    u32 w = id / 64;
+    u64 bits = pool->live[w] & (~0ULL << (id % 64));
+    while(!bits) {
+        if(++w * 64 >= pool->end) return pool->end;
+        bits = pool->live[w];
+    }
+    return w * 64 + _znode_ctz(bits);
+}
+// the slot every live element gets when they're moved down in order, ~0 for deleted ones
+static u32 *_zpool_remap(zd_node_pool *pool) {
+    u32 *remap = ZUI_MALLOC((pool->end + 1) * sizeof(u32));
+    for(u32 i = 0, n = 0; i < pool->end; i++)
+        remap[i] = _zpool_live(pool, i) ? n++ : ~0u;
+    return remap;
+}
+static void _zpool_compact(zd_node_pool *pool, u32 *remap) {
+    u32 n = 0;
+    for(u32 i = 0; i < pool->end; i++) {
+        if(remap[i] == ~0u) continue;
+        if(remap[i] != i) memcpy(_zpool_at(pool, remap[i]), _zpool_at(pool, i), pool->size);
+        n++;
+    }
+    u32 blocks = (n + ZNODE_BLOCK - 1) / ZNODE_BLOCK;
+    for(u32 i = blocks; i < pool->block_cnt; i++)
+        ZUI_FREE(pool->blocks[i]);
+    if(blocks) memset(pool->live, 0, blocks * (ZNODE_BLOCK / 8));
+    for(u32 i = 0; i < n; i++)
+        pool->live[i / 64] |= 1ULL << (i % 64);
+    pool->block_cnt = blocks;
+    pool->end = n;
+    pool->free_cnt = 0;
+}
+static void _zpool_release(zd_node_pool *pool) {
+    for(u32 i = 0; i < pool->block_cnt; i++)
+        ZUI_FREE(pool->blocks[i]);
+    ZUI_FREE(pool->blocks);
+    ZUI_FREE(pool->live);
+    ZUI_FREE(pool->free);
+}
+
+zd_node *znode_next(zd_node_editor *state, zd_node *node) {
+    u32 id = _zpool_next(&state->nodes, node ? node->id + 1 : 0);
+    return id < state->nodes.end ? _zpool_at(&state->nodes, id) : 0;
+}
+zd_node_link *znode_next_link(zd_node_editor *state, zd_node_link *link) {
+    u32 id = _zpool_next(&state->links, link ? link->id + 1 : 0);
+    return id < state->links.end ? _zpool_at(&state->links, id) : 0;
+}
+zd_node *znode_at(zd_node_editor *state, u32 id) {
+    return _zpool_live(&state->nodes, id) ? _zpool_at(&state->nodes, id) : 0;
+}
+zd_node_link *znode_link_at(zd_node_editor *state, u32 id) {
+    return _zpool_live(&state->links, id) ? _zpool_at(&state->links, id) : 0;
+}
+
+// The index is open addressed with linear probing. Deleting shifts the rest of the cluster back instead of leaving
+// tombstones, so it doesn't degrade when user pointers are freed and reused
+static u32 _znode_hash(void *uud, i32 uud_type) {
+    u64 k = (u64)(size_t)uud * 0x9E3779B97F4A7C15ULL ^ (u32)uud_type;
+    k = (k ^ (k >> 32)) * 0xD6E8FEB86659FD93ULL;
+    return (u32)(k ^ (k >> 32));
+}
+static zd_node **_znode_slot(zd_node_editor *state, void *uud, i32 uud_type) {
+    u32 mask = state->index_cap - 1;
+    for(u32 i = _znode_hash(uud, uud_type) & mask;; i = (i + 1) & mask) {
+        zd_node *n = state->index[i];
+        if(!n || (n->uud == uud && n->uud_type == uud_type))
+            return &state->index[i];
+    }
+}
+static void _znode_index_add(zd_node_editor *state, zd_node *node) {
+    // node_cnt is an upper bound of the keys in the index
+    if((u32)(state->node_cnt + 1) * 4 > state->index_cap * 3) {
+        zd_node **old = state->index;
+        u32 old_cap = state->index_cap;
+        state->index_cap = old_cap ? old_cap * 2 : 64;
+        state->index = ZUI_CALLOC(state->index_cap, sizeof(zd_node*));
+        for(u32 i = 0; i < old_cap; i++)
+            if(old[i]) *_znode_slot(state, old[i]->uud, old[i]->uud_type) = old[i];
+        ZUI_FREE(old);
+    }
+    zd_node **slot = _znode_slot(state, node->uud, node->uud_type);
+    node->shadowed = *slot;
+    *slot = node;
+}
+static void _znode_index_del(zd_node_editor *state, zd_node *node) {
+    zd_node **slot = _znode_slot(state, node->uud, node->uud_type);
+    if(*slot != node) { // a newer node has the same key
+        for(zd_node *n = *slot; n; n = n->shadowed)
+            if(n->shadowed == node) n->shadowed = node->shadowed;
+        return;
+    }
+    if(node->shadowed) {
+        *slot = node->shadowed;
+        return;
+    }
+    u32 mask = state->index_cap - 1, gap = slot - state->index;
+    for(u32 i = (gap + 1) & mask; state->index[i]; i = (i + 1) & mask) {
+        u32 home = _znode_hash(state->index[i]->uud, state->index[i]->uud_type) & mask;
+        // moves back if the gap is between its home slot and where it is
+        if(((i - home) & mask) < ((i - gap) & mask)) continue;
+        state->index[gap] = state->index[i];
+        gap = i;
+    }
+    state->index[gap] = 0;
+}
 
 zd_node *znode_get(zd_node_editor *state, void *uud, i32 uud_type) {
+    return state->index_cap ? *_znode_slot(state, uud, uud_type) : 0;
+}
+
+static void _znode_list_push(zd_node_list *list, zd_node *node) {
+    if(list->cnt == list->cap) {
+        list->cap = list->cap ? list->cap * 2 : 64;
+        list->at = ZUI_REALLOC(list->at, list->cap * sizeof(zd_node*));
+    }
+    list->at[list->cnt++] = node;
+}
+
+void znode_journal(zd_node_editor *state, u32 cap) {
+    zd_node_journal *j = &state->journal;
+    u32 size = cap ? 1 : 0;
+    while(size && size < cap) size *= 2;
+    if(size == j->cap) return;
+    // the latest events are kept, in the slots they have in the new size
+    zd_node_event *events = size ? ZUI_MALLOC(size * sizeof(zd_node_event)) : 0;
+    u64 keep = j->head - j->tail < size ? j->head - j->tail : size;
+    j->tail = j->head - keep;
+    for(u64 i = j->tail; i < j->head; i++)
+        events[i & (size - 1)] = j->events[i & (j->cap - 1)];
+    ZUI_FREE(j->events);
+    j->events = events;
+    j->cap = size;
+}
+
+i32 znode_journal_read(zd_node_editor *state, u64 *cursor, zd_node_event *out, i32 cap) {
+    zd_node_journal *j = &state->journal;
+    if(*cursor < j->tail || *cursor > j->head) {
+        *cursor = j->tail;
+        return -1;
+    }
+    i32 cnt = 0;
+    for(; cnt < cap && *cursor < j->head; cnt++)
+        out[cnt] = j->events[(*cursor)++ & (j->cap - 1)];
+    return cnt;
+}
+
+// an event about <node>, or about <link> when there's one
+static void _znode_record(zd_node_editor *state, u32 kind, zd_node *node, zd_node_link *link) {
+    zd_node_journal *j = &state->journal;
+    if(!j->cap) return;
+    if(j->head - j->tail == j->cap) j->tail++;
+    zd_node_event *ev = &j->events[j->head++ & (j->cap - 1)];
+    *ev = (zd_node_event) { .kind = kind };
+    if(link) {
+        node = link->output;
+        ev->input = link->input->id;
+        ev->input_uud = link->input->uud;
+        ev->input_type = link->input->uud_type;
+        ev->in = link->id_in;
+        ev->out = link->id_out;
+    } else if(node) {
+        ev->in = node->cnt_in;
+        ev->out = node->cnt_out;
+        ev->pos = node->rect.pos;
+    }
+    if(node) {
+        ev->node = node->id;
+        ev->uud = node->uud;
+        ev->uud_type = node->uud_type;
+    }
+}
+
+// The grid of where nodes and links are, see zd_node_world. Positions are shifted to 0..ZWORLD_SPAN - 1
+#define ZWORLD_SPAN 65536
+static i32 _zworld_coord(i32 v) {
+    v += ZWORLD_SPAN / 2;
+    return v < 0 ? 0 : v >= ZWORLD_SPAN ? ZWORLD_SPAN - 1 : v;
+}
+static u32 _zworld_cols(u32 level) {
+    return ZWORLD_SPAN / (ZNODE_WORLD_CELL << level);
+}
+// the first cell of <level>, past the last level the one of the nodes that were never laid out
+static u32 _zworld_level(u32 level) {
+    u32 first = 0;
+    for(u32 l = 0; l < level; l++)
+        first += _zworld_cols(l) * _zworld_cols(l);
+    return first;
+}
+// the cell of the box from x0 y0 to x1 y1
+static u32 _zworld_cell(i32 x0, i32 y0, i32 x1, i32 y1) {
+    x0 = _zworld_coord(x0);
+    y0 = _zworld_coord(y0);
+    i32 w = _zworld_coord(x1) - x0, h = _zworld_coord(y1) - y0, size = w > h ? w : h;
+    u32 level = 0;
+    while(level < ZNODE_WORLD_LEVELS - 1 && size >= ZNODE_WORLD_CELL << level) level++;
+    i32 cell = ZNODE_WORLD_CELL << level;
+    return _zworld_level(level) + y0 / cell * _zworld_cols(level) + x0 / cell;
+}
+static void _zworld_del(zd_node_world *w, u32 slot) {
+    if(slot >= w->ref_cap || w->refs[slot].cell == ~0u) return;
+    zd_node_world_ref *r = &w->refs[slot];
+    if(r->prev != ~0u) w->refs[r->prev].next = r->next;
+    else w->cells[r->cell] = r->next;
+    if(r->next != ~0u) w->refs[r->next].prev = r->prev;
+    r->cell = ~0u;
+}
+static void _zworld_put(zd_node_world *w, u32 slot, u32 cell) {
+    if(slot >= w->ref_cap) {
+        u32 cap = w->ref_cap ? w->ref_cap : ZNODE_BLOCK;
+        while(cap <= slot) cap *= 2;
+        w->refs = ZUI_REALLOC(w->refs, cap * sizeof(zd_node_world_ref));
+        memset(w->refs + w->ref_cap, 0xFF, (cap - w->ref_cap) * sizeof(zd_node_world_ref));
+        w->ref_cap = cap;
+    }
+    if(w->refs[slot].cell == cell) return;
+    _zworld_del(w, slot);
+    w->refs[slot] = (zd_node_world_ref) { w->cells[cell], ~0u, cell };
+    if(w->cells[cell] != ~0u) w->refs[w->cells[cell]].prev = slot;
+    w->cells[cell] = slot;
+}
+static void _zworld_release(zd_node_world *w) {
+    ZUI_FREE(w->cells);
+    ZUI_FREE(w->refs);
+    *w = (zd_node_world) { 0 };
+}
+typedef void (*zworld_fn)(void *ctx, u32 slot);
+static void _zworld_set_bit(void *bits, u32 slot) {
+    ((u64*)bits)[slot / 64] |= 1ULL << (slot % 64);
+}
+// calls <fn> with every item in a cell which can hold one crossing the box, and with the nodes never laid out
+static void _zworld_query(zd_node_world *w, i32 x0, i32 y0, i32 x1, i32 y1, zworld_fn fn, void *ctx) {
+    x0 = _zworld_coord(x0);
+    y0 = _zworld_coord(y0);
+    x1 = _zworld_coord(x1);
+    y1 = _zworld_coord(y1);
+    u32 first = 0;
+    for(u32 level = 0; level < ZNODE_WORLD_LEVELS; level++) {
+        i32 cell = ZNODE_WORLD_CELL << level, cols = _zworld_cols(level);
+        // an item starts at most a cell before the box
+        for(i32 cy = y0 >= cell ? y0 / cell - 1 : 0; cy <= y1 / cell; cy++)
+            for(i32 cx = x0 >= cell ? x0 / cell - 1 : 0; cx <= x1 / cell; cx++)
+                for(u32 i = w->cells[first + cy * cols + cx]; i != ~0u; i = w->refs[i].next)
+                    fn(ctx, i);
+        first += cols * cols;
+    }
+    for(u32 i = w->cells[first]; i != ~0u; i = w->refs[i].next)
+        fn(ctx, i);
+}
+
+// a node's box in the grid, twice its size as it keeps that size on screen down to ZNODE_LOD_FAR
+static void _znode_world_box(zd_node *n, i32 box[4]) {
+    box[0] = n->rect.x;
+    box[1] = n->rect.y;
+    box[2] = n->rect.x + 2 * n->rect.w;
+    box[3] = n->rect.y + 2 * n->rect.h;
+}
+static void _znode_world_node(zd_node_editor *state, zd_node *node) {
+    state->map_current = false;
+    if(!state->world.cells) return;
+    i32 box[4], ports = node->cnt_in > node->cnt_out ? node->cnt_in : node->cnt_out;
+    if(ports > state->world_ports) state->world_ports = ports;
+    _znode_world_box(node, box);
+    bool sized = node->rect.w || node->rect.h;
+    _zworld_put(&state->world, node->id, sized ? _zworld_cell(box[0], box[1], box[2], box[3]) : _zworld_level(ZNODE_WORLD_LEVELS));
+}
+// both nodes' boxes, and a quarter of their width further on either side where the curve's control points reach
+static void _znode_world_link(zd_node_editor *state, zd_node_link *link) {
+    if(!state->world.cells) return;
+    i32 a[4], b[4];
+    _znode_world_box(link->output, a);
+    _znode_world_box(link->input, b);
+    i32 x0 = a[0] < b[0] ? a[0] : b[0], y0 = a[1] < b[1] ? a[1] : b[1];
+    i32 x1 = a[2] > b[2] ? a[2] : b[2], y1 = a[3] > b[3] ? a[3] : b[3], reach = (x1 - x0) / 4 + 1;
+    _zworld_put(&state->link_world, link->id, _zworld_cell(x0 - reach, y0, x1 + reach, y1));
+}
+// the node moved or was laid out to another size, its links with it
+static void _znode_world_moved(zd_node_editor *state, zd_node *node) {
+    if(!state->world.cells) return;
+    _znode_world_node(state, node);
+    FOR_INPUTS(node)
+        _znode_world_link(state, link);
+    FOR_OUTPUTS(node)
+        _znode_world_link(state, link);
+}
+static void _znode_world_build(zd_node_editor *state) {
+    u32 cells = _zworld_level(ZNODE_WORLD_LEVELS) + 1;
+    state->world.cells = ZUI_MALLOC(cells * sizeof(u32));
+    state->link_world.cells = ZUI_MALLOC(cells * sizeof(u32));
+    memset(state->world.cells, 0xFF, cells * sizeof(u32));
+    memset(state->link_world.cells, 0xFF, cells * sizeof(u32));
+    state->world_ports = 0;
     FOR_NODES(state)
-        if(node->uud == uud && node->uud_type == uud_type)
-           return node;
-    return 0;
+        _znode_world_node(state, node);
+    FOR_LINKS(state)
+        _znode_world_link(state, link);
+}
+// how far past its box in the grid a node can reach on screen: the padding, room for its ports, their dots and the
+// margin the editor's rect is grown by
+static i32 _znode_world_margin(zd_node_editor *state, zvec2 padding, i32 min_conn_space) {
+    i32 ypad = min_conn_space * state->world_ports / 2;
+    if(ypad < padding.y) ypad = padding.y;
+    return (ypad > padding.x ? ypad : padding.x) + ZNODE_PORT_RADIUS + 12;
+}
+// calls <fn> with the items of <w> which can cross <view> on screen, grown by <margin> pixels
+static void _znode_world_query(zd_node_editor *state, zd_node_world *w, zrect view, zvec2 origin, f32 zoom, i32 margin, zworld_fn fn, void *ctx) {
+    if(!state->world.cells) _znode_world_build(state);
+    f32 x0 = (view.x - margin - origin.x) / zoom, y0 = (view.y - margin - origin.y) / zoom;
+    f32 x1 = (view.x + view.w + margin - origin.x) / zoom, y1 = (view.y + view.h + margin - origin.y) / zoom;
+    #define ZWORLD_CLAMP(v) ((v) < -ZWORLD_SPAN ? -ZWORLD_SPAN : (v) > ZWORLD_SPAN ? ZWORLD_SPAN : (i32)(v))
+    _zworld_query(w, ZWORLD_CLAMP(x0) - 1, ZWORLD_CLAMP(y0) - 1, ZWORLD_CLAMP(x1) + 1, ZWORLD_CLAMP(y1) + 1, fn, ctx);
+    #undef ZWORLD_CLAMP
+}
+
+// a zeroed bitmap with a bit per slot up to <end>
+static void _znode_bits(u64 **bits, u32 *words, u32 end) {
+    u32 need = end / 64 + 1;
+    if(need > *words) {
+        *bits = ZUI_REALLOC(*bits, need * sizeof(u64));
+        *words = need;
+    }
+    memset(*bits, 0, *words * sizeof(u64));
+}
+// the first set bit from <id> on, ~0 if there's none
+static u32 _znode_next_bit(u64 *bits, u32 words, u32 id) {
+    u32 w = id / 64;
+    if(w >= words) return ~0u;
+    u64 b = bits[w] & (~0ULL << (id % 64));
+    while(!b) {
+        if(++w >= words) return ~0u;
+        b = bits[w];
+    }
+    return w * 64 + _znode_ctz(b);
+}
+#define FOR_BITS(i, bits, words) for(u32 i = _znode_next_bit(bits, words, 0); i != ~0u; i = _znode_next_bit(bits, words, i + 1))
+
+void znode_move(zd_node_editor *state, zd_node *node, zvec2 pos) {
+    if(node->rect.x == pos.x && node->rect.y == pos.y) return;
+    node->rect.pos = pos;
+    _znode_world_moved(state, node);
+    _znode_record(state, ZNODE_EV_MOVE, node, 0);
+}
+
+// drops what's no longer dirty from the list, and the entries of deleted nodes, whose slots the list still points into
+static void _znode_dirty_compact(zd_node_editor *state) {
+    zd_node_list *dirty = &state->dirty;
+    u32 cnt = 0;
+    state->epoch++;
+    for(u32 i = 0; i < dirty->cnt; i++) {
+        zd_node *n = dirty->at[i];
+        if(!_zpool_live(&state->nodes, n->id) || !(n->flags & ZF_NODE_DIRTY) || n->mark == state->epoch) continue;
+        n->mark = state->epoch;
+        dirty->at[cnt++] = n;
+    }
+    dirty->cnt = cnt;
+}
+// cleaning leaves nodes in the list, which is compacted once it's twice as long as it can need to be
+static void _znode_dirty_push(zd_node_editor *state, zd_node *node) {
+    if(state->dirty.cnt >= (u32)state->node_cnt * 2 + 64) _znode_dirty_compact(state);
+    _znode_list_push(&state->dirty, node);
 }
 
 zd_node *znode_add(zd_node_editor *state, void *uud, i32 uud_type, zvec2 pos, i32 inputs, i32 outputs, i32 flags) {
-    zd_node *new = malloc(sizeof(zd_node));
+    u32 id;
+    zd_node *new = _zpool_alloc(&state->nodes, sizeof(zd_node), &id);
     *new = (zd_node) {
         .rect.pos = pos,
         .uud = uud,
@@ -31,11 +449,18 @@ zd_node *znode_add(zd_node_editor *state, void *uud, i32 uud_type, zvec2 pos, i3
         .flags = flags,
         .cnt_in = inputs,
         .cnt_out = outputs,
-        .next = state->head_node,
+        .id = id,
+        .ord = state->order.cnt,
+        .mark = state->epoch,
     };
+    _znode_index_add(state, new);
+    _znode_world_node(state, new);
+    _znode_list_push(&state->order, new);
+    new->flags |= ZF_NODE_DIRTY;
+    _znode_dirty_push(state, new);
+    _znode_record(state, ZNODE_EV_ADD, new, 0);
     state->node_cnt++;
     state->has_updated = true;
-    state->head_node = new;
     return new;
 }
 
@@ -43,35 +468,112 @@ extern void print_link(zd_node_link *);
 extern void print_node(zd_node *);
 
 enum {
-    NODE_MARKED = 4,
-    NODE_FULLMARKED = 8
+    NODE_VISIBLE = 16,  // crosses the editor's rect, drawn
+    NODE_SHOWN = 32,    // visible and zoomed in enough to lay out its child widget
 };
 
-bool _znode_toposort_visit(zd_node *node, zd_node **arr, int *cnt) {
-    if(node->flags & 8) return true;
-    if(node->flags & 4) return false; // cycle detected
-    node->flags |= 4;
-    FOR_INPUTS(node)
-        if(!_znode_toposort_visit(link->output, arr, cnt))
-           return false;
-    node->flags |= 8;
-    arr[(*cnt)++] = node;
+i32 znode_toposort(zd_node_editor *state, zd_node **arr) {
+    i32 cnt = 0;
+    for(u32 i = 0; i < state->order.cnt; i++)
+        if(state->order.at[i]) arr[cnt++] = state->order.at[i];
+    return cnt;
+}
+
+// closes the gaps deleted nodes left in the order
+static void _znode_order_compact(zd_node_editor *state) {
+    u32 cnt = 0;
+    for(u32 i = 0; i < state->order.cnt; i++) {
+        zd_node *n = state->order.at[i];
+        if(!n) continue;
+        n->ord = cnt;
+        state->order.at[cnt++] = n;
+    }
+    state->order.cnt = cnt;
+    state->order_holes = 0;
+}
+
+static i32 _znode_cmp_ord(const void *a, const void *b) {
+    u32 x = (*(zd_node**)a)->ord, y = (*(zd_node**)b)->ord;
+    return x < y ? -1 : x > y;
+}
+
+// Depth first from <from> along outputs (forward) or inputs, through the nodes ordered strictly between <lo> and
+// <hi>, appending them to state->found. Returns false as soon as <stop> is reached
+static bool _znode_reach(zd_node_editor *state, zd_node *from, bool forward, u32 lo, u32 hi, zd_node *stop) {
+    zd_node_list *stack = &state->stack;
+    stack->cnt = 0;
+    from->mark = state->epoch;
+    _znode_list_push(stack, from);
+    while(stack->cnt) {
+        zd_node *n = stack->at[--stack->cnt];
+        _znode_list_push(&state->found, n);
+        for(zd_node_link *link = forward ? n->outputs : n->inputs; link; link = forward ? link->next_out : link->next_in) {
+            zd_node *next = forward ? link->input : link->output;
+            if(next == stop) return false;
+            if(next->mark == state->epoch || next->ord <= lo || next->ord >= hi) continue;
+            next->mark = state->epoch;
+            _znode_list_push(stack, next);
+        }
+    }
     return true;
 }
 
-i32 znode_toposort(zd_node_editor *state, zd_node **arr) {
-    i32 cnt = 0;
-    FOR_NODES(state) {
-        if(node->flags & 8) continue;
-        if(!_znode_toposort_visit(node, arr, &cnt)) {
-            FOR_NODES(state)
-                node->flags &= ~12;
-           return 0;
+// Makes room in the order for a link from <output> to <input>, false if it would close a cycle. When <input> comes
+// first, what it reaches before <output>'s position and what reaches <output> after <input>'s position are the only
+// nodes out of order: they're given back their own positions, those reaching <output> first
+static bool _znode_order_link(zd_node_editor *state, zd_node *output, zd_node *input) {
+    if(output->ord < input->ord) return true;
+    u32 lo = input->ord, hi = output->ord;
+    state->epoch++;
+    state->found.cnt = 0;
+    if(!_znode_reach(state, input, true, lo, hi, output)) return false;
+    u32 fcnt = state->found.cnt;
+    _znode_reach(state, output, false, lo, hi, 0);
+    u32 bcnt = state->found.cnt - fcnt, cnt = state->found.cnt;
+    zd_node **f = state->found.at, **b = f + fcnt;
+    qsort(f, fcnt, sizeof(zd_node*), _znode_cmp_ord);
+    qsort(b, bcnt, sizeof(zd_node*), _znode_cmp_ord);
+    if(cnt > state->ords_cap) {
+        state->ords_cap = cnt * 2;
+        state->ords = ZUI_REALLOC(state->ords, state->ords_cap * sizeof(u32));
+    }
+    for(u32 k = 0, i = 0, j = 0; k < cnt; k++)
+        state->ords[k] = j == bcnt || (i < fcnt && f[i]->ord < b[j]->ord) ? f[i++]->ord : b[j++]->ord;
+    for(u32 i = 0; i < cnt; i++) {
+        zd_node *n = i < bcnt ? b[i] : f[i - bcnt];
+        n->ord = state->ords[i];
+        state->order.at[n->ord] = n;
+    }
+    return true;
+}
+
+void znode_dirty(zd_node_editor *state, zd_node *node) {
+    if(node->flags & ZF_NODE_DIRTY) return;
+    zd_node_list *stack = &state->stack;
+    stack->cnt = 0;
+    node->flags |= ZF_NODE_DIRTY;
+    _znode_list_push(stack, node);
+    while(stack->cnt) {
+        zd_node *n = stack->at[--stack->cnt];
+        _znode_dirty_push(state, n);
+        FOR_OUTPUTS(n) {
+            if(link->input->flags & ZF_NODE_DIRTY) continue;
+            link->input->flags |= ZF_NODE_DIRTY;
+            _znode_list_push(stack, link->input);
         }
     }
-    FOR_NODES(state)
-        node->flags &= ~12;
-    return cnt;
+}
+
+void znode_clean(zd_node *node, void *result) {
+    node->flags &= ~ZF_NODE_DIRTY;
+    node->result = result;
+}
+
+zd_node **znode_recompute(zd_node_editor *state, i32 *cnt) {
+    _znode_dirty_compact(state);
+    qsort(state->dirty.at, state->dirty.cnt, sizeof(zd_node*), _znode_cmp_ord);
+    *cnt = state->dirty.cnt;
+    return state->dirty.at;
 }
 
 bool znode_link(zd_node_editor *state, zd_node *output, i32 id_out, zd_node *input, i32 id_in) {
@@ -85,49 +587,66 @@ bool znode_link(zd_node_editor *state, zd_node *output, i32 id_out, zd_node *inp
 		for(zd_node_link *n = input->inputs; n; n = n->next_in)
 			if(n->id_in == id_in)
                 return false;
-	zd_node_link *link = malloc(sizeof(zd_node_link));
+    if(output == input || !_znode_order_link(state, output, input))
+        return false;
+    u32 id;
+	zd_node_link *link = _zpool_alloc(&state->links, sizeof(zd_node_link), &id);
 	*link = (zd_node_link) {
 		.id_in = id_in,
 		.id_out = id_out,
-		.next = state->head_link,
+		.id = id,
 		.next_in = input->inputs,
 		.next_out = output->outputs,
 		.output = output,
 		.input = input
 	};
-	state->head_link = output->outputs = input->inputs = link;
+    if(input->inputs) input->inputs->prev_in = link;
+    if(output->outputs) output->outputs->prev_out = link;
+	output->outputs = input->inputs = link;
     state->link_cnt++;
     state->has_updated = true;
+    znode_dirty(state, input);
+    _znode_world_link(state, link);
+    _znode_record(state, ZNODE_EV_LINK, 0, link);
 	return true;
 }
 
-#define FOR_DELINKS(head, var, next) \
-    for(typeof(**(head)) **_p = (head), *var = *_p, **_n; var && (_n = &var->next, 1); var = *_n)
-#define LINK_KEEP() (_p = _n)
-#define LINK_DEL() (*_p = *_n)
+void znode_del_link(zd_node_editor *state, zd_node_link *link) {
+    if(link->prev_in) link->prev_in->next_in = link->next_in;
+    else link->input->inputs = link->next_in;
+    if(link->next_in) link->next_in->prev_in = link->prev_in;
+    if(link->prev_out) link->prev_out->next_out = link->next_out;
+    else link->output->outputs = link->next_out;
+    if(link->next_out) link->next_out->prev_out = link->prev_out;
+    znode_dirty(state, link->input);
+    _znode_record(state, ZNODE_EV_UNLINK, 0, link);
+    _zworld_del(&state->link_world, link->id);
+    _zpool_free(&state->links, link->id);
+    state->link_cnt--;
+    state->has_updated = true;
+}
 
 bool znode_del(zd_node_editor *state, void *uud, i32 uud_type) {
-    FOR_DELINKS(&state->head_node, n, next) {
-		if(n->uud != uud || n->uud_type != uud_type) {
-            LINK_KEEP();
-            continue;
-        }
-        FOR_DELINKS(&state->head_link, link, next) {
-            if(link->input != n && link->output != n) {
-                LINK_KEEP();
-                continue;
-            }
-            LINK_DEL();
-            state->link_cnt--;
-            free(link);
-        }
-        LINK_DEL();
-        state->node_cnt--;
-        state->has_updated = true;
-		free(n);
-		return true;
-	}
-	return false;
+    zd_node *node = znode_get(state, uud, uud_type);
+    return node && znode_del_node(state, node);
+}
+
+bool znode_del_node(zd_node_editor *state, zd_node *node) {
+    node->flags |= ZF_NODE_DIRTY; // deleting its inputs needn't dirty it
+    while(node->inputs) znode_del_link(state, node->inputs);
+    while(node->outputs) znode_del_link(state, node->outputs);
+    _znode_index_del(state, node);
+    _zworld_del(&state->world, node->id);
+    state->map_current = false;
+    _znode_record(state, ZNODE_EV_DEL, node, 0);
+    state->order.at[node->ord] = 0;
+    if(++state->order_holes > 64 && state->order_holes * 2 > state->order.cnt)
+        _znode_order_compact(state);
+    _zpool_free(&state->nodes, node->id);
+    if(state->dragged == node) state->dragged = 0;
+    state->node_cnt--;
+    state->has_updated = true;
+    return true;
 }
 
 void reportstuff(zd_node_editor *editor) {
@@ -148,62 +667,137 @@ void reportstuff(zd_node_editor *editor) {
     }
 }
 
-bool znode_del_out_links(zd_node_editor *state, zd_node *node, i32 id_out) {
-	// loop through all input links with id_out
-    FOR_DELINKS(&node->outputs, output, next_out) {
-        if(output->id_out != id_out) {
-            LINK_KEEP(); 
-            continue;
-        }
-		// we've found a link to delete, delete it from the inputs first
-        FOR_DELINKS(&output->input->inputs, input, next_in) {
-            if(output == input) LINK_DEL();
-            else LINK_KEEP(); 
-        }
-        LINK_DEL();
+// a deleted slot is only reused by the next add, so within a batch its bit tells whether it was deleted already
+i32 znode_del_nodes(zd_node_editor *state, zd_node **nodes, i32 cnt) {
+    i32 deleted = 0;
+    for(i32 i = 0; i < cnt; i++)
+        if(_zpool_live(&state->nodes, nodes[i]->id))
+            deleted += znode_del_node(state, nodes[i]);
+    return deleted;
+}
+
+i32 znode_del_links(zd_node_editor *state, zd_node_link **links, i32 cnt) {
+    i32 deleted = 0;
+    for(i32 i = 0; i < cnt; i++) {
+        if(!_zpool_live(&state->links, links[i]->id)) continue;
+        znode_del_link(state, links[i]);
+        deleted++;
     }
-    FOR_DELINKS(&state->head_link, link, next) {
-		if(link->id_out != id_out || link->output != node) {
-            LINK_KEEP();
-            continue;
-        }
-        LINK_DEL();
-        state->link_cnt--;
-        state->has_updated = true;
-        free(link);
+    return deleted;
+}
+
+bool znode_del_out_links(zd_node_editor *state, zd_node *node, i32 id_out) {
+    for(zd_node_link *link = node->outputs, *next; link; link = next) {
+        next = link->next_out;
+        if(link->id_out == id_out) znode_del_link(state, link);
     }
 	return true;
 }
 
 bool znode_del_in_links(zd_node_editor *state, zd_node *node, i32 id_in) {
-    FOR_DELINKS(&node->inputs, input, next_in) {
-        if(input->id_in != id_in) {
-            LINK_KEEP(); 
-            continue;
-        }
-		// we've found a link to delete, delete it from the inputs first
-        FOR_DELINKS(&input->output->outputs, output, next_out) {
-            if(input == output) LINK_DEL();
-            else LINK_KEEP(); 
-        }
-        LINK_DEL();
+    for(zd_node_link *link = node->inputs, *next; link; link = next) {
+        next = link->next_in;
+        if(link->id_in == id_in) znode_del_link(state, link);
+    }
+    return true;
+}
+
+static f32 _znode_zoom(zd_node_editor *state) {
+    return state->zoom ? state->zoom : 1;
+}
+i32 znode_lod(zd_node_editor *state) {
+    return _znode_zoom(state) < ZNODE_LOD_FAR ? ZNODE_LOD_RECTS : ZNODE_LOD_FULL;
+}
+void znode_zoom(zd_node_editor *state, f32 zoom, zvec2 anchor) {
+    zoom = zoom < ZNODE_ZOOM_MIN ? ZNODE_ZOOM_MIN : zoom > ZNODE_ZOOM_MAX ? ZNODE_ZOOM_MAX : zoom;
+    f32 scale = zoom / _znode_zoom(state);
+    zvec2 rel = _vec_sub(anchor, state->view.pos);
+    state->offset.x = rel.x - (rel.x - state->offset.x) * scale;
+    state->offset.y = rel.y - (rel.y - state->offset.y) * scale;
+    state->zoom = zoom;
+}
+
+static i16 _znode_clamp(f32 v) {
+    return v < -16000 ? -16000 : v > 16000 ? 16000 : (i16)v;
+}
+// screen rect of a node with room for its ports. Zoomed out the whole node shrinks, up close only the distances
+static zrect _znode_padded_rect(zd_node *n, zvec2 origin, f32 zoom, zvec2 padding, i32 min_conn_space) {
+    zrect rect = n->rect;
+    if(zoom < ZNODE_LOD_FAR) {
+        rect.w *= zoom;
+        rect.h *= zoom;
+        padding.x *= zoom;
+        padding.y *= zoom;
+        min_conn_space *= zoom;
+    }
+    i32 maxcnt = n->cnt_in > n->cnt_out ? n->cnt_in : n->cnt_out;
+    i32 ypad = (min_conn_space * maxcnt - rect.h) / 2;
+    if(ypad < padding.y) ypad = padding.y;
+    rect.x = _znode_clamp(origin.x + rect.x * zoom);
+    rect.y = _znode_clamp(origin.y + rect.y * zoom);
+    rect = _rect_pad(rect, (zvec2) { padding.x, ypad });
+    // nodes that were never laid out have no size, they still show up as a dot
+    if(rect.w < 2) rect.w = 2;
+    if(rect.h < 2) rect.h = 2;
+    return rect;
+}
+
+// Marks the nodes inside the editor's rect of the last frame, with room for the port dots. Nodes that were never
+// laid out count as visible so they get a size, and so does everything before the editor's first frame. Only the
+// nodes the grid finds around the rect are looked at, and those of the last frame to unmark them. Zoomed out past
+// ZNODE_LOD_FAR none are, the map is drawn straight from the grid
+static void _znode_cull(zd_node_editor *state) {
+    zvec2 padding = zui_stylev(ID, ZSV_PADDING);
+    i32 min_conn_space = zui_stylei(ID, ZSI_NODE_CONN_SPACING);
+    zvec2 origin = _vec_add(state->view.pos, state->offset);
+    zrect view = _rect_pad(state->view, (zvec2) { 10, 10 }), tmp;
+    f32 zoom = _znode_zoom(state);
+    bool all = !state->view.w || !state->view.h, zoomed_out = zoom < ZNODE_LOD_FAR;
+    FOR_BITS(i, state->visible, state->visible_words) {
+        zd_node *node = znode_at(state, i);
+        if(node) node->flags &= ~(NODE_VISIBLE | NODE_SHOWN);
     }
-    FOR_DELINKS(&state->head_link, link, next) {
-		if(link->id_in != id_in || link->input != node) {
-            LINK_KEEP();
+    _znode_bits(&state->visible, &state->visible_words, state->nodes.end);
+    state->visible_cnt = 0;
+    if(zoomed_out && !all) return;
+    if(all) {
+        FOR_NODES(state)
+            state->visible[node->id / 64] |= 1ULL << (node->id % 64);
+    } else {
+        i32 margin = _znode_world_margin(state, padding, min_conn_space);
+        _znode_world_query(state, &state->world, state->view, origin, zoom, margin, _zworld_set_bit, state->visible);
+    }
+    FOR_BITS(i, state->visible, state->visible_words) {
+        zd_node *node = znode_at(state, i);
+        bool visible = all || (!node->rect.w && !node->rect.h) ||
+            _rect_intersect(_znode_padded_rect(node, origin, zoom, padding, min_conn_space), view, &tmp);
+        if(!visible) {
+            state->visible[i / 64] &= ~(1ULL << (i % 64));
             continue;
         }
-        LINK_DEL();
-        state->link_cnt--;
-        state->has_updated = true;
-        free(link);
+        node->flags |= NODE_VISIBLE | (zoomed_out ? 0 : NODE_SHOWN);
+        state->visible_cnt += !zoomed_out;
     }
-    return true;
+}
+
+bool znode_visible(zd_node *node) {
+    return node->flags & NODE_SHOWN;
+}
+
+zd_node *znode_next_visible(zd_node_editor *state, zd_node *node) {
+    if(!state->visible_cnt) return 0; // zoomed out past ZNODE_LOD_FAR none are shown
+    u32 from = node ? node->id + 1 : 0;
+    for(u32 i = _znode_next_bit(state->visible, state->visible_words, from); i != ~0u; i = _znode_next_bit(state->visible, state->visible_words, i + 1)) {
+        zd_node *n = znode_at(state, i);
+        if(n && (n->flags & NODE_SHOWN)) return n;
+    }
+    return 0;
 }
 
 void zui_node_editor(zd_node_editor *state) {
     zw_node_editor *editor = _cont_alloc(ZW_NODE_EDITOR, sizeof(zw_node_editor));
     editor->state = state;
+    _znode_cull(state);
 }
 
 bool znode_updated(zd_node_editor *state) {
@@ -212,90 +806,625 @@ bool znode_updated(zd_node_editor *state) {
     return ret;
 }
 
+void znode_free(zd_node_editor *state) {
+    _zpool_release(&state->nodes);
+    _zpool_release(&state->links);
+    ZUI_FREE(state->index);
+    ZUI_FREE(state->grid.cells);
+    ZUI_FREE(state->grid.refs);
+    ZUI_FREE(state->grid.items);
+    ZUI_FREE(state->visible);
+    ZUI_FREE(state->drawn_links);
+    ZUI_FREE(state->map);
+    _zworld_release(&state->world);
+    _zworld_release(&state->link_world);
+    ZUI_FREE(state->order.at);
+    ZUI_FREE(state->stack.at);
+    ZUI_FREE(state->found.at);
+    ZUI_FREE(state->ords);
+    ZUI_FREE(state->dirty.at);
+    ZUI_FREE(state->journal.events);
+    *state = (zd_node_editor) { 0 };
+}
+
+void znode_compact(zd_node_editor *state) {
+    u32 *nodes = _zpool_remap(&state->nodes), *links = _zpool_remap(&state->links);
+    #define NEW_NODE(p) ((p) ? (zd_node*)_zpool_at(&state->nodes, nodes[(p)->id]) : 0)
+    #define NEW_LINK(p) ((p) ? (zd_node_link*)_zpool_at(&state->links, links[(p)->id]) : 0)
+    // pointers are rewritten while everything is still in its old slot, reading only the ids of what they point to
+    FOR_LINKS(state) {
+        link->output = NEW_NODE(link->output);
+        link->input = NEW_NODE(link->input);
+        link->next_in = NEW_LINK(link->next_in);
+        link->prev_in = NEW_LINK(link->prev_in);
+        link->next_out = NEW_LINK(link->next_out);
+        link->prev_out = NEW_LINK(link->prev_out);
+    }
+    FOR_NODES(state) {
+        node->inputs = NEW_LINK(node->inputs);
+        node->outputs = NEW_LINK(node->outputs);
+        node->shadowed = NEW_NODE(node->shadowed);
+    }
+    for(u32 i = 0; i < state->index_cap; i++)
+        state->index[i] = NEW_NODE(state->index[i]);
+    state->dragged = NEW_NODE(state->dragged);
+    for(u32 i = 0; i < state->order.cnt; i++)
+        state->order.at[i] = NEW_NODE(state->order.at[i]);
+    _znode_dirty_compact(state);
+    for(u32 i = 0; i < state->dirty.cnt; i++)
+        state->dirty.at[i] = NEW_NODE(state->dirty.at[i]);
+    state->grid.cols = state->grid.rows = 0; // refers to the old slots until the next frame is drawn
+    #undef NEW_NODE
+    #undef NEW_LINK
+    _zpool_compact(&state->nodes, nodes);
+    _zpool_compact(&state->links, links);
+    for(u32 i = 0; i < state->nodes.end; i++)
+        ((zd_node*)_zpool_at(&state->nodes, i))->id = i;
+    for(u32 i = 0; i < state->links.end; i++)
+        ((zd_node_link*)_zpool_at(&state->links, i))->id = i;
+    ZUI_FREE(nodes);
+    ZUI_FREE(links);
+    // the grid is rebuilt by the next frame, the visible nodes keep their marks in their new slots
+    state->map_current = false;
+    _zworld_release(&state->world);
+    _zworld_release(&state->link_world);
+    _znode_bits(&state->visible, &state->visible_words, state->nodes.end);
+    FOR_NODES(state)
+        if(node->flags & NODE_VISIBLE) state->visible[node->id / 64] |= 1ULL << (node->id % 64);
+    _znode_record(state, ZNODE_EV_COMPACT, 0, 0);
+}
+
+u64 znode_save(zd_node_editor *state, void *out, u64 cap) {
+    u64 bytes = sizeof(zd_node_file) + (u64)state->node_cnt * sizeof(zd_node_file_node) + (u64)state->link_cnt * sizeof(zd_node_file_link);
+    if(!out || cap < bytes) return bytes;
+    zd_node_file *h = out;
+    *h = (zd_node_file) { ZNODE_FILE_MAGIC, ZNODE_FILE_VERSION, state->node_cnt, state->link_cnt, bytes };
+    zd_node_file_node *fn = (zd_node_file_node*)(h + 1);
+    zd_node_file_link *fl = (zd_node_file_link*)(fn + state->node_cnt);
+    u32 *remap = _zpool_remap(&state->nodes);
+    FOR_NODES(state) {
+        fn[remap[node->id]] = (zd_node_file_node) {
+            .rect = node->rect,
+            .uud = (u64)(size_t)node->uud,
+            .uud_type = node->uud_type,
+            .flags = node->flags & ~(NODE_VISIBLE | NODE_SHOWN | ZF_NODE_DIRTY),
+            .cnt_in = node->cnt_in,
+            .cnt_out = node->cnt_out,
+        };
+    }
+    for(u32 i = 0, ord = 0; i < state->order.cnt; i++)
+        if(state->order.at[i]) fn[remap[state->order.at[i]->id]].ord = ord++;
+    u32 i = 0;
+    FOR_LINKS(state)
+        fl[i++] = (zd_node_file_link) { remap[link->output->id], remap[link->input->id], link->id_out, link->id_in };
+    ZUI_FREE(remap);
+    return bytes;
+}
+
+bool znode_save_file(zd_node_editor *state, char *path) {
+    u64 bytes = znode_save(state, 0, 0);
+    void *data = ZUI_MALLOC(bytes);
+    znode_save(state, data, bytes);
+    FILE *f = fopen(path, "wb");
+    bool ok = f && fwrite(data, 1, bytes, f) == bytes;
+    if(f && fclose(f)) ok = false;
+    ZUI_FREE(data);
+    if(!ok) zui_log("couldn't write the graph %s\n", path);
+    return ok;
+}
+
+static i32 _znode_cmp_file_link_in(const void *a, const void *b) {
+    const zd_node_file_link *x = a, *y = b;
+    if(x->id_in != y->id_in) return x->id_in < y->id_in ? -1 : 1;
+    if(x->output != y->output) return x->output < y->output ? -1 : 1;
+    return x->id_out < y->id_out ? -1 : x->id_out > y->id_out;
+}
+static i32 _znode_cmp_file_link_out(const void *a, const void *b) {
+    const zd_node_file_link *x = a, *y = b;
+    return x->id_out < y->id_out ? -1 : x->id_out > y->id_out;
+}
+
+// Groups the links by input (or output) node, then looks for the same link twice or two links on a ZF_NODE_1IN
+// (ZF_NODE_1OUT) port. Groups are sorted when they're too big to compare every pair
+static bool _znode_file_ports_valid(zd_node_file_node *fn, zd_node_file_link *fl, zd_node_file *h, bool by_input) {
+    u32 n = h->node_cnt, *start = ZUI_CALLOC(n + 2, sizeof(u32));
+    zd_node_file_link *group = ZUI_MALLOC((h->link_cnt ? h->link_cnt : 1) * sizeof(zd_node_file_link));
+    for(u32 i = 0; i < h->link_cnt; i++)
+        start[(by_input ? fl[i].input : fl[i].output) + 2]++;
+    for(u32 i = 0; i < n; i++)
+        start[i + 2] += start[i + 1];
+    for(u32 i = 0; i < h->link_cnt; i++)
+        group[start[(by_input ? fl[i].input : fl[i].output) + 1]++] = fl[i];
+    bool ok = true;
+    for(u32 i = 0; i < n && ok; i++) {
+        zd_node_file_link *at = group + start[i];
+        u32 cnt = start[i + 1] - start[i];
+        bool single = fn[i].flags & (by_input ? ZF_NODE_1IN : ZF_NODE_1OUT);
+        if(cnt < 2 || (!by_input && !single)) continue;
+        if(cnt > 8) qsort(at, cnt, sizeof(zd_node_file_link), by_input ? _znode_cmp_file_link_in : _znode_cmp_file_link_out);
+        for(u32 a = 0; a < cnt && ok; a++)
+            for(u32 b = a + 1; b < (cnt > 8 ? a + 2 : cnt) && b < cnt && ok; b++) {
+                zd_node_file_link *x = &at[a], *y = &at[b];
+                ok = by_input ? x->id_in != y->id_in || (!single && (x->output != y->output || x->id_out != y->id_out)) : x->id_out != y->id_out;
+            }
+    }
+    ZUI_FREE(start);
+    ZUI_FREE(group);
+    return ok;
+}
+
+// a permutation of the ords, no link from a node to itself or to one before it, nor to a port its node doesn't have
+static bool _znode_file_valid(zd_node_file *h, u64 len) {
+    if(len < sizeof(zd_node_file) || h->magic != ZNODE_FILE_MAGIC || h->version != ZNODE_FILE_VERSION || h->bytes != len)
+        return false;
+    if(sizeof(zd_node_file) + (u64)h->node_cnt * sizeof(zd_node_file_node) + (u64)h->link_cnt * sizeof(zd_node_file_link) != len)
+        return false;
+    zd_node_file_node *fn = (zd_node_file_node*)(h + 1);
+    zd_node_file_link *fl = (zd_node_file_link*)(fn + h->node_cnt);
+    u64 *seen = ZUI_CALLOC(h->node_cnt / 64 + 1, sizeof(u64));
+    bool ok = true;
+    for(u32 i = 0; i < h->node_cnt && ok; i++) {
+        u32 ord = fn[i].ord;
+        ok = ord < h->node_cnt && !(seen[ord / 64] >> (ord % 64) & 1);
+        if(ok) seen[ord / 64] |= 1ULL << (ord % 64);
+    }
+    ZUI_FREE(seen);
+    for(u32 i = 0; i < h->link_cnt && ok; i++) {
+        zd_node_file_link *l = &fl[i];
+        ok = l->output < h->node_cnt && l->input < h->node_cnt && fn[l->output].ord < fn[l->input].ord &&
+            l->id_out >= 0 && l->id_out < fn[l->output].cnt_out && l->id_in >= 0 && l->id_in < fn[l->input].cnt_in;
+    }
+    bool single_out = false;
+    for(u32 i = 0; i < h->node_cnt && ok; i++)
+        single_out |= (fn[i].flags & ZF_NODE_1OUT) != 0;
+    // nor twice the same link, or two links on a port that takes one
+    ok = ok && _znode_file_ports_valid(fn, fl, h, true);
+    ok = ok && (!single_out || _znode_file_ports_valid(fn, fl, h, false));
+    return ok;
+}
+
+bool znode_load(zd_node_editor *state, void *data, u64 len, znode_uud_fn remap, void *user_data) {
+    zd_node_file *h = data;
+    if(!_znode_file_valid(h, len)) return false;
+    zd_node_file_node *fn = (zd_node_file_node*)(h + 1);
+    zd_node_file_link *fl = (zd_node_file_link*)(fn + h->node_cnt);
+    u32 n = h->node_cnt;
+    // consumers of the journal carry on from where they were
+    zd_node_journal journal = state->journal;
+    state->journal = (zd_node_journal) { 0 };
+    znode_free(state);
+    state->journal = journal;
+
+    _zpool_fill(&state->nodes, sizeof(zd_node), n);
+    state->order.at = ZUI_MALLOC((n ? n : 1) * sizeof(zd_node*));
+    state->order.cnt = state->order.cap = n;
+    state->dirty.at = ZUI_MALLOC((n ? n : 1) * sizeof(zd_node*));
+    state->dirty.cnt = state->dirty.cap = n;
+    state->index_cap = 64;
+    while(n * 4 > state->index_cap * 3) state->index_cap *= 2;
+    state->index = ZUI_CALLOC(state->index_cap, sizeof(zd_node*));
+    for(u32 i = 0; i < n; i++) {
+        zd_node *node = _zpool_at(&state->nodes, i);
+        *node = (zd_node) {
+            .rect = fn[i].rect,
+            .uud = remap ? remap(fn[i].uud, fn[i].uud_type, user_data) : (void*)(size_t)fn[i].uud,
+            .uud_type = fn[i].uud_type,
+            .flags = (fn[i].flags & ~(NODE_VISIBLE | NODE_SHOWN)) | ZF_NODE_DIRTY,
+            .cnt_in = fn[i].cnt_in,
+            .cnt_out = fn[i].cnt_out,
+            .id = i,
+            .ord = fn[i].ord,
+        };
+        state->order.at[node->ord] = node;
+        state->dirty.at[i] = node;
+    }
+    // the index is filled separately, its slots are cache misses which are fetched a few nodes ahead
+    u32 mask = state->index_cap - 1;
+    for(u32 i = 0; i < n; i++) {
+        if(i + 16 < n) {
+            zd_node *ahead = state->dirty.at[i + 16];
+            _znode_prefetch(&state->index[_znode_hash(ahead->uud, ahead->uud_type) & mask]);
+        }
+        _znode_index_add(state, state->dirty.at[i]);
+        state->node_cnt++;
+    }
+
+    _zpool_fill(&state->links, sizeof(zd_node_link), h->link_cnt);
+    for(u32 i = 0; i < h->link_cnt; i++) {
+        zd_node_link *link = _zpool_at(&state->links, i);
+        zd_node *output = _zpool_at(&state->nodes, fl[i].output), *input = _zpool_at(&state->nodes, fl[i].input);
+        *link = (zd_node_link) {
+            .output = output,
+            .input = input,
+            .id_in = fl[i].id_in,
+            .id_out = fl[i].id_out,
+            .id = i,
+            .next_in = input->inputs,
+            .next_out = output->outputs,
+        };
+        if(input->inputs) input->inputs->prev_in = link;
+        if(output->outputs) output->outputs->prev_out = link;
+        output->outputs = input->inputs = link;
+    }
+    state->link_cnt = h->link_cnt;
+    state->has_updated = true;
+    _znode_record(state, ZNODE_EV_LOAD, 0, 0);
+    return true;
+}
+
+bool znode_load_file(zd_node_editor *state, char *path, znode_uud_fn remap, void *user_data) {
+    bool ok = false;
+    i64 len;
+    // the whole file is read anyway
+    void *data = _zui_map_file(path, &len, true);
+    if(data) {
+        ok = znode_load(state, data, len, remap, user_data);
+        _zui_unmap_file(data, len);
+    }
+    if(!ok) zui_log("couldn't load the graph %s\n", path);
+    return ok;
+}
+
 static void _error_if_miscount(zw_node_editor *w) {
-    if(w->cont.children == w->state->node_cnt) return;
-    zui_log("Number of children does not match number of nodes. %d vs %d\n", w->cont.children, w->state->node_cnt);
+    if(w->cont.children == w->state->node_cnt || w->cont.children == w->state->visible_cnt) return;
+    zui_log("Number of children does not match number of nodes. %d vs %d (%d visible)\n", w->cont.children, w->state->node_cnt, w->state->visible_cnt);
     exit(0);
 }
+// the node of the next child widget, which are either one per node or one per shown node
+static zd_node *_znode_next_child(zw_node_editor *w, zd_node *n) {
+    return w->cont.children == w->state->node_cnt ? znode_next(w->state, n) : znode_next_visible(w->state, n);
+}
 static u16 _znode_editor_size(zw_node_editor *w, bool axis, i16 bound) {
-    zd_node *n = w->state->head_node;
+    zd_node *n = _znode_next_child(w, 0);
     _error_if_miscount(w);
     FOR_CHILDREN(w) {
-        n->rect.e[2 + axis] = _ui_sz(child, axis, Z_AUTO);
-        n = n->next;
+        i16 size = n->flags & NODE_SHOWN ? _ui_sz(child, axis, Z_AUTO) : n->rect.e[2 + axis];
+        if(size != n->rect.e[2 + axis]) {
+            n->rect.e[2 + axis] = size;
+            _znode_world_moved(w->state, n);
+        }
+        n = _znode_next_child(w, n);
     }
     return bound;
 }
 static void _znode_editor_pos(zw_node_editor *w, zvec2 pos, i32 zindex) {
-    zd_node *n = w->state->head_node;
+    zd_node *n = _znode_next_child(w, 0);
     zvec2 origin = _vec_add(pos, w->state->offset);
+    f32 zoom = _znode_zoom(w->state);
     _error_if_miscount(w);
+    w->state->view = w->widget.used;
     FOR_CHILDREN(w) { 
-        zvec2 p = _vec_add(origin, n->rect.pos);
-        _ui_pos(child, p, zindex);
-        n = n->next; 
+        zvec2 p = { _znode_clamp(origin.x + n->rect.x * zoom), _znode_clamp(origin.y + n->rect.y * zoom) };
+        if(n->flags & NODE_SHOWN)
+            _ui_pos(child, p, zindex);
+        n = _znode_next_child(w, n);
     }
 }
-static void _draw_connection(zvec2 start, zvec2 end, bool direction, i32 zindex) {
+// control points of a link from <start> to <end>, in <points>, returns how many
+static i32 _znode_curve(zvec2 start, zvec2 end, bool direction, zvec2 *points) {
     if(direction) {
-        zvec2 points[4] = {
-            { start.x, start.y },
-            { end.x, start.y },
-            { start.x, end.y },
-            { end.x, end.y } };
-        _push_bezier_cmd(4, points, 2, (zcolor) { 255, 255, 255, 255 }, zindex);
+        points[0] = (zvec2) { start.x, start.y };
+        points[1] = (zvec2) { end.x, start.y };
+        points[2] = (zvec2) { start.x, end.y };
+        points[3] = (zvec2) { end.x, end.y };
+        return 4;
+    }
+    zvec2 mid = { (end.x + start.x) / 2, (end.y + start.y) / 2 };
+    i32 c = (end.x - start.x) / 4;
+    points[0] = (zvec2) { start.x, start.y };
+    points[1] = (zvec2) { start.x - c, start.y };
+    points[2] = (zvec2) { start.x - c, mid.y };
+    points[3] = (zvec2) { mid.x, mid.y };
+    points[4] = (zvec2) { end.x + c, mid.y };
+    points[5] = (zvec2) { end.x + c, end.y };
+    points[6] = (zvec2) { end.x, end.y };
+    return 7;
+}
+static void _draw_connection(zvec2 start, zvec2 end, bool direction, i32 zindex) {
+    zvec2 points[7];
+    i32 cnt = _znode_curve(start, end, direction, points);
+    _push_bezier_cmd(cnt, points, 2, (zcolor) { 255, 255, 255, 255 }, zindex);
+}
+
+static void _zgrid_begin(zd_node_grid *g, zrect area) {
+    g->area = area;
+    g->cols = (area.w + ZNODE_CELL - 1) / ZNODE_CELL;
+    g->rows = (area.h + ZNODE_CELL - 1) / ZNODE_CELL;
+    g->item_cnt = 0;
+}
+static zd_node_item *_zgrid_add(zd_node_grid *g, zrect rect, u8 kind, u32 id) {
+    if(g->item_cnt == g->item_cap) {
+        g->item_cap = g->item_cap ? g->item_cap * 2 : 256;
+        g->items = ZUI_REALLOC(g->items, g->item_cap * sizeof(zd_node_item));
+    }
+    zd_node_item *item = &g->items[g->item_cnt++];
+    *item = (zd_node_item) { .rect = rect, .id = id, .kind = kind };
+    return item;
+}
+static i32 _zgrid_cell(i32 v, i32 cnt) {
+    v /= ZNODE_CELL;
+    return v < 0 ? 0 : v >= cnt ? cnt - 1 : v;
+}
+// the cells <r> overlaps, false if it misses the grid
+static bool _zgrid_span(zd_node_grid *g, zrect r, i32 *x0, i32 *y0, i32 *x1, i32 *y1) {
+    i32 x = r.x - g->area.x, y = r.y - g->area.y;
+    if(x + r.w < 0 || y + r.h < 0 || x > g->area.w || y > g->area.h || !g->cols || !g->rows) return false;
+    *x0 = _zgrid_cell(x, g->cols);
+    *y0 = _zgrid_cell(y, g->rows);
+    *x1 = _zgrid_cell(x + r.w, g->cols);
+    *y1 = _zgrid_cell(y + r.h, g->rows);
+    return true;
+}
+// buckets the items: counts per cell, offsets, then the refs
+static void _zgrid_end(zd_node_grid *g) {
+    u32 n = g->cols * g->rows, x0, y0, x1, y1;
+    if(n + 1 > g->cell_cap) {
+        g->cell_cap = n + 1;
+        g->cells = ZUI_REALLOC(g->cells, g->cell_cap * sizeof(u32));
+    }
+    memset(g->cells, 0, (n + 1) * sizeof(u32));
+    for(u32 i = 0; i < g->item_cnt; i++) {
+        if(!_zgrid_span(g, g->items[i].rect, (i32*)&x0, (i32*)&y0, (i32*)&x1, (i32*)&y1)) continue;
+        for(u32 y = y0; y <= y1; y++)
+            for(u32 x = x0; x <= x1; x++)
+                g->cells[y * g->cols + x + 1]++;
+    }
+    for(u32 c = 1; c <= n; c++)
+        g->cells[c] += g->cells[c - 1];
+    if(g->cells[n] > g->ref_cap) {
+        g->ref_cap = g->cells[n] * 2;
+        g->refs = ZUI_REALLOC(g->refs, g->ref_cap * sizeof(u32));
+    }
+    // each cell's offset moves up to the next one's while it's filled, then they're shifted back
+    for(u32 i = 0; i < g->item_cnt; i++) {
+        if(!_zgrid_span(g, g->items[i].rect, (i32*)&x0, (i32*)&y0, (i32*)&x1, (i32*)&y1)) continue;
+        for(u32 y = y0; y <= y1; y++)
+            for(u32 x = x0; x <= x1; x++)
+                g->refs[g->cells[y * g->cols + x]++] = i;
+    }
+    memmove(g->cells + 1, g->cells, n * sizeof(u32));
+    g->cells[0] = 0;
+}
+
+// zoomed out, nodes smaller than a pixel aren't drawn. Those never laid out still are, as a dot
+static bool _znode_subpixel(zd_node *n, f32 zoom) {
+    return (n->rect.w || n->rect.h) && n->rect.w * zoom < 1 && n->rect.h * zoom < 1;
+}
+// zoomed out, where the last frame drew <n> in its map, false if it didn't
+static bool _znode_far_rect(zd_node_grid *g, zd_node *n, zrect *rect) {
+    zrect tmp;
+    if(_znode_subpixel(n, g->zoom)) return false;
+    *rect = _znode_padded_rect(n, g->origin, g->zoom, g->padding, g->conn_spacing);
+    return _rect_intersect(*rect, g->area, &tmp);
+}
+// the nodes drawn in the map at a point or across a rect, called by the world grid
+typedef struct znode_found {
+    zd_node_editor *state;
+    zrect rect;
+    zd_node **out, *top;
+    i32 cap, cnt;
+} znode_found;
+static void _znode_found_at(void *ctx, u32 slot) {
+    znode_found *f = ctx;
+    zd_node *n = znode_at(f->state, slot);
+    zrect rect;
+    // the last drawn is on top
+    if(!_znode_far_rect(&f->state->grid, n, &rect) || !_vec_within(f->rect.pos, rect)) return;
+    if(!f->top || f->top->id < n->id) f->top = n;
+}
+static void _znode_found_in(void *ctx, u32 slot) {
+    znode_found *f = ctx;
+    zd_node *n = znode_at(f->state, slot);
+    zrect rect, tmp;
+    if(!_znode_far_rect(&f->state->grid, n, &rect) || !_rect_intersect(rect, f->rect, &tmp)) return;
+    if(f->cnt < f->cap) f->out[f->cnt] = n;
+    f->cnt++;
+}
+
+static f32 _znode_segment_distsq(zvec2 p, f32 ax, f32 ay, f32 bx, f32 by) {
+    f32 dx = bx - ax, dy = by - ay, len = dx * dx + dy * dy;
+    f32 t = len ? ((p.x - ax) * dx + (p.y - ay) * dy) / len : 0;
+    t = t < 0 ? 0 : t > 1 ? 1 : t;
+    f32 ex = ax + t * dx - p.x, ey = ay + t * dy - p.y;
+    return ex * ex + ey * ey;
+}
+// whether <p> is within <dist> pixels of the link, its cubic segments flattened to 16 lines each
+static bool _znode_near_link(zd_node_item *item, zvec2 p, i32 dist) {
+    if(item->shape == 2)
+        return _znode_segment_distsq(p, item->start.x, item->start.y, item->end.x, item->end.y) <= dist * dist;
+    zvec2 c[7];
+    i32 cnt = _znode_curve(item->start, item->end, item->shape, c);
+    for(i32 s = 0; s + 3 < cnt; s += 3) {
+        f32 px = c[s].x, py = c[s].y;
+        for(i32 i = 1; i <= 16; i++) {
+            f32 t = i / 16.f, u = 1 - t;
+            f32 x = u*u*u * c[s].x + 3*u*u*t * c[s+1].x + 3*u*t*t * c[s+2].x + t*t*t * c[s+3].x;
+            f32 y = u*u*u * c[s].y + 3*u*u*t * c[s+1].y + 3*u*t*t * c[s+2].y + t*t*t * c[s+3].y;
+            if(_znode_segment_distsq(p, px, py, x, y) <= dist * dist) return true;
+            px = x;
+            py = y;
+        }
+    }
+    return false;
+}
+
+zd_node_hit znode_hit(zd_node_editor *state, zvec2 pos) {
+    zd_node_grid *g = &state->grid;
+    zd_node_hit hit = { 0 };
+    i32 x, y, x1, y1;
+    if(!_zgrid_span(g, (zrect) { pos.x, pos.y, 0, 0 }, &x, &y, &x1, &y1)) return hit;
+    zd_node_item *best = 0;
+    u32 cell = y * g->cols + x;
+    for(u32 i = g->cells[cell]; i < g->cells[cell + 1]; i++) {
+        zd_node_item *item = &g->items[g->refs[i]];
+        if((best && best->kind > item->kind) || !_vec_within(pos, item->rect)) continue;
+        if(item->kind == ZNODE_ITEM_PORT) {
+            zvec2 center = { item->rect.x + ZNODE_PORT_RADIUS, item->rect.y + ZNODE_PORT_RADIUS };
+            if(_vec_distsq(pos, center) >= ZNODE_PORT_RADIUS * ZNODE_PORT_RADIUS) continue;
+        }
+        if(item->kind == ZNODE_ITEM_LINK && !_znode_near_link(item, pos, 4)) continue;
+        best = item;
+    }
+    if(g->zoomed_out) {
+        // the map's nodes aren't items, they're over the links
+        znode_found f = { state, { pos.x, pos.y, 0, 0 } };
+        i32 margin = _znode_world_margin(state, g->padding, g->conn_spacing);
+        _znode_world_query(state, &state->world, f.rect, g->origin, g->zoom, margin, _znode_found_at, &f);
+        if(f.top) return (zd_node_hit) { f.top };
+    }
+    if(!best) return hit;
+    if(best->kind == ZNODE_ITEM_LINK) {
+        hit.link = znode_link_at(state, best->id);
     } else {
-        zvec2 mid = { (end.x + start.x) / 2, (end.y + start.y) / 2 };
-        i32 c = (end.x - start.x) / 4;
-        zvec2 points[7] = {
-            { start.x, start.y },
-            { start.x - c, start.y },
-            { start.x - c, mid.y },
-            { mid.x, mid.y },
-            { end.x + c, mid.y },
-            { end.x + c, end.y },
-            { end.x, end.y },
-        };
-        _push_bezier_cmd(7, points, 2, (zcolor) { 255, 255, 255, 255 }, zindex);
+        hit.node = znode_at(state, best->id);
+        hit.port = hit.node ? best->port : 0;
     }
+    return hit;
+}
 
+i32 znode_query_rect(zd_node_editor *state, zrect rect, zd_node **out, i32 cap) {
+    zd_node_grid *g = &state->grid;
+    i32 x0, y0, x1, y1, cnt = 0;
+    if(!_rect_intersect(rect, g->area, &rect) || !_zgrid_span(g, rect, &x0, &y0, &x1, &y1)) return 0;
+    if(g->zoomed_out) {
+        znode_found f = { state, rect, out, 0, cap };
+        i32 margin = _znode_world_margin(state, g->padding, g->conn_spacing);
+        _znode_world_query(state, &state->world, rect, g->origin, g->zoom, margin, _znode_found_in, &f);
+        return f.cnt;
+    }
+    for(i32 y = y0; y <= y1; y++) {
+        for(i32 x = x0; x <= x1; x++) {
+            u32 cell = y * g->cols + x;
+            for(u32 i = g->cells[cell]; i < g->cells[cell + 1]; i++) {
+                zd_node_item *item = &g->items[g->refs[i]];
+                zrect tmp;
+                if(item->kind != ZNODE_ITEM_NODE || !_rect_intersect(item->rect, rect, &tmp)) continue;
+                // a node in several cells is reported by the first one where it overlaps <rect>
+                if(_zgrid_cell(tmp.x - g->area.x, g->cols) != x || _zgrid_cell(tmp.y - g->area.y, g->rows) != y) continue;
+                zd_node *node = znode_at(state, item->id);
+                if(!node) continue;
+                if(cnt < cap) out[cnt] = node;
+                cnt++;
+            }
+        }
+    }
+    return cnt;
+}
+
+static void _znode_add_ports(zd_node_grid *g, zd_node *n, zrect r, bool input) {
+    i32 cnt = input ? n->cnt_in : n->cnt_out;
+    if(!input) r.pos.x += r.w;
+    for(i32 i = 0; i < cnt; i++) {
+        zvec2 pos = { r.pos.x, r.pos.y + r.h / (cnt * 2) * (2 * i + 1) };
+        zrect square = { pos.x - ZNODE_PORT_RADIUS, pos.y - ZNODE_PORT_RADIUS, ZNODE_PORT_RADIUS * 2, ZNODE_PORT_RADIUS * 2 };
+        _zgrid_add(g, square, ZNODE_ITEM_PORT, n->id)->port = input ? -1 - i : 1 + i;
+    }
 }
 
-static i32 _draw_connection_points(zd_node *n, zrect r, bool input, i32 zindex, zcolor colors[2]) {
+// <hovered> as in zd_node_hit
+static void _draw_connection_points(zd_node *n, zrect r, bool input, i32 zindex, zcolor colors[2], i32 hovered) {
     i32 cnt = input ? n->cnt_in : n->cnt_out;
-    if(!cnt) return 0;
     zvec2 draw_offset = { input ? -3 : -5, -9 };
     if(!input) r.pos.x += r.w;
-    i32 index_hovered = 0;
     for(i32 i = 0; i < cnt; i++) {
         zvec2 pos = { r.pos.x, r.pos.y + r.h / (cnt * 2) * (2 * i + 1) };
-        bool is_hovered = _vec_distsq(_ui_mpos(), pos) < 100;
+        bool is_hovered = hovered == (input ? -1 - i : 1 + i);
         _push_text_cmd(0, _vec_add(pos, draw_offset), colors[is_hovered], "\xE2\x97\x8F", 3, zindex);
-        if(is_hovered) index_hovered = i + 1;
     }
-    return input ? -index_hovered : index_hovered;
 }
 
-static zrect _znode_padded_rect(zd_node *n, zvec2 origin, zvec2 padding, i32 min_conn_space) {
-    i32 maxcnt = n->cnt_in > n->cnt_out ? n->cnt_in : n->cnt_out;
-    i32 ypad = (min_conn_space * maxcnt - n->rect.h) / 2;
-    if(ypad < padding.y) ypad = padding.y;
-    zrect rect = _rect_pad(n->rect, (zvec2) { padding.x, ypad });
-    rect.pos = _vec_add(rect.pos, origin);
-    return rect;
+static void _znode_deselect(zd_node_editor *state) {
+    FOR_NODES(state)
+        node->flags &= ~ZF_NODE_SELECTED;
 }
 
+// the map drawn zoomed out: a row of cells after another, those of unselected nodes then those of selected ones
+typedef struct znode_map {
+    zd_node_editor *state;
+    u32 cols, rows, words;
+} znode_map;
+static void _znode_map_node(void *ctx, u32 slot) {
+    znode_map *m = ctx;
+    zd_node_grid *g = &m->state->grid;
+    zd_node *n = znode_at(m->state, slot);
+    zrect r;
+    if(!_znode_far_rect(g, n, &r)) return;
+    i32 x0 = r.x - g->area.x, y0 = r.y - g->area.y, x1 = x0 + r.w, y1 = y0 + r.h;
+    x0 = x0 < 0 ? 0 : x0 / ZNODE_LOD_CELL;
+    y0 = y0 < 0 ? 0 : y0 / ZNODE_LOD_CELL;
+    x1 = (x1 > g->area.w ? g->area.w : x1) - 1;
+    y1 = (y1 > g->area.h ? g->area.h : y1) - 1;
+    if(x1 < 0 || y1 < 0) return;
+    x1 /= ZNODE_LOD_CELL;
+    y1 /= ZNODE_LOD_CELL;
+    u64 *layer = m->state->map + (n->flags & ZF_NODE_SELECTED ? m->rows * m->words : 0);
+    for(i32 y = y0; y <= y1; y++) {
+        u64 *row = layer + y * m->words;
+        for(i32 word = x0 / 64; word <= x1 / 64; word++) {
+            u64 mask = ~0ULL;
+            if(word == x0 / 64) mask &= ~0ULL << (x0 % 64);
+            if(word == x1 / 64) mask &= ~0ULL >> (63 - x1 % 64);
+            row[word] |= mask;
+        }
+    }
+}
+// fills the cells nodes cover with a rect for each run of them in a row, which also takes the rows below it that are
+// the same, selected ones in their own color. The cells are kept until the graph, the selection or the view change
+static void _znode_draw_map(zw_node_editor *w, zcolor colors[2], i32 margin) {
+    zd_node_editor *state = w->state;
+    zd_node_grid *g = &state->grid;
+    i32 cell = ZNODE_LOD_CELL;
+    znode_map m = { state, (g->area.w + cell - 1) / cell, (g->area.h + cell - 1) / cell };
+    m.words = m.cols / 64 + 1;
+    u32 cells = m.rows * m.words;
+    if(!state->map_current) {
+        if(cells * 2 > state->map_words) {
+            state->map = ZUI_REALLOC(state->map, cells * 2 * sizeof(u64));
+            state->map_words = cells * 2;
+        }
+        memset(state->map, 0, cells * 2 * sizeof(u64));
+        _znode_world_query(state, &state->world, g->area, g->origin, g->zoom, margin, _znode_map_node, &m);
+        for(u32 i = 0; i < cells; i++)
+            state->map[i] &= ~state->map[cells + i];
+        state->map_current = true;
+    }
+    for(u32 layer = 0; layer < 2; layer++) {
+        u64 *rows = state->map + layer * cells;
+        for(u32 top = 0, y = 1; y <= m.rows; y++) {
+            u64 *row = rows + top * m.words;
+            if(y < m.rows && !memcmp(rows + y * m.words, row, m.words * sizeof(u64))) continue;
+            for(u32 x = _znode_next_bit(row, m.words, 0); x != ~0u; x = _znode_next_bit(row, m.words, x)) {
+                // the row ends with clear bits
+                u32 end = x / 64;
+                u64 clear = ~row[end] & (~0ULL << (x % 64));
+                while(!clear) clear = ~row[++end];
+                end = end * 64 + _znode_ctz(clear);
+                zrect rect = { g->area.x + x * cell, g->area.y + top * cell, (end - x) * cell, (y - top) * cell };
+                if(rect.x + rect.w > g->area.x + g->area.w) rect.w = g->area.x + g->area.w - rect.x;
+                if(rect.y + rect.h > g->area.y + g->area.h) rect.h = g->area.y + g->area.h - rect.y;
+                _push_rect_cmd(rect, colors[layer], w->widget.zindex + 1);
+                x = end;
+            }
+            top = y;
+        }
+    }
+}
 
 static void _znode_editor_draw(zw_node_editor *w) {
     _error_if_miscount(w);
 
     zcolor background = zui_stylec(ID, ZSC_BACKGROUND);
     zcolor foreground = zui_stylec(ID, ZSC_FOREGROUND);
+    zcolor selected = zui_stylec(ID, ZSC_NODE_SELECTED);
 
     zvec2 origin = _vec_add(w->widget.used.pos, w->state->offset);
 
     zvec2 padding = zui_stylev(ID, ZSV_PADDING);
     i32 min_conn_space = zui_stylei(ID, ZSI_NODE_CONN_SPACING);
+    f32 zoom = _znode_zoom(w->state);
+    bool zoomed_out = zoom < ZNODE_LOD_FAR;
+    zd_node_editor *state = w->state;
+    zd_node_grid *grid = &state->grid;
 
     zcolor in_colors[2] = {
         zui_stylec(ID, ZSC_NODE_INPUT),
@@ -307,50 +1436,144 @@ static void _znode_editor_draw(zw_node_editor *w) {
     };
 
     _push_rect_cmd(w->widget.used, background, w->widget.zindex);
-    for(zd_node_link *c = w->state->head_link; c; c = c->next) {
-        zrect start = _znode_padded_rect(c->input, origin, padding, min_conn_space);
-        zrect end   = _znode_padded_rect(c->output, origin, padding, min_conn_space);
-        start.y += start.h / (2 * c->input->cnt_in) * (2 * c->id_in + 1);
-        end.y += end.h / (2 * c->output->cnt_out) * (2 * c->id_out + 1);
+    if(!grid->zoomed_out || grid->zoom != zoom || grid->origin.x != origin.x || grid->origin.y != origin.y ||
+        grid->padding.x != padding.x || grid->padding.y != padding.y || grid->conn_spacing != min_conn_space ||
+        memcmp(&grid->area, &w->widget.used, sizeof(zrect)))
+        state->map_current = false;
+    _zgrid_begin(grid, w->widget.used);
+    grid->zoomed_out = zoomed_out;
+    grid->origin = origin;
+    grid->zoom = zoom;
+    grid->padding = padding;
+    grid->conn_spacing = min_conn_space;
+    // the links the grid finds around the editor, whose ends can be twice as far as a node past its box
+    _znode_bits(&state->drawn_links, &state->link_words, state->links.end);
+    i32 margin = _znode_world_margin(state, padding, min_conn_space);
+    if(zoom >= ZNODE_LOD_LINKS)
+        _znode_world_query(state, &state->link_world, w->widget.used, origin, zoom, margin * 2, _zworld_set_bit, state->drawn_links);
+    FOR_BITS(i, state->drawn_links, state->link_words) {
+        zd_node_link *link = znode_link_at(state, i);
+        if(zoomed_out && (_znode_subpixel(link->input, zoom) || _znode_subpixel(link->output, zoom))) continue;
+        zrect start = _znode_padded_rect(link->input, origin, zoom, padding, min_conn_space);
+        zrect end   = _znode_padded_rect(link->output, origin, zoom, padding, min_conn_space);
+        start.y += start.h / (2 * link->input->cnt_in) * (2 * link->id_in + 1);
+        end.y += end.h / (2 * link->output->cnt_out) * (2 * link->id_out + 1);
         end.x += end.w;
-        _draw_connection(start.pos, end.pos, start.x > end.x, w->widget.zindex);
+        // the curve stays within its control points, which reach a quarter of the width past either end
+        i32 dx = start.x > end.x ? start.x - end.x : end.x - start.x, dy = start.y > end.y ? start.y - end.y : end.y - start.y;
+        zrect box = { (start.x < end.x ? start.x : end.x) - dx / 4 - 2, (start.y < end.y ? start.y : end.y) - 2, dx + dx / 2 + 4, dy + 4 }, tmp;
+        if(!_rect_intersect(box, w->widget.used, &tmp) || (zoomed_out && start.x == end.x && start.y == end.y)) continue;
+        if(zoomed_out) _push_lines_cmd(2, (zvec2[2]) { start.pos, end.pos }, 1, (zcolor) { 255, 255, 255, 255 }, w->widget.zindex);
+        else _draw_connection(start.pos, end.pos, start.x > end.x, w->widget.zindex);
+        zd_node_item *item = _zgrid_add(grid, box, ZNODE_ITEM_LINK, link->id);
+        item->start = start.pos;
+        item->end = end.pos;
+        item->shape = zoomed_out ? 2 : start.x > end.x;
+    }
+    if(zoomed_out) {
+        _znode_draw_map(w, (zcolor[2]) { foreground, selected }, margin);
+    } else {
+        FOR_BITS(i, state->visible, state->visible_words) {
+            zd_node *node = znode_at(state, i);
+            if(!node || !(node->flags & NODE_VISIBLE)) continue;
+            zrect rect = _znode_padded_rect(node, origin, zoom, padding, min_conn_space);
+            _zgrid_add(grid, rect, ZNODE_ITEM_NODE, node->id);
+            _znode_add_ports(grid, node, rect, true);
+            _znode_add_ports(grid, node, rect, false);
+        }
     }
-    zrect selected_rect;
-    zd_node *n = w->state->head_node;
+    _zgrid_end(grid);
+    bool hovered = _ui_cont_hovered(&w->widget);
+    zd_node_hit hit = hovered ? znode_hit(w->state, _ui_mpos()) : (zd_node_hit) { 0 };
+
+    zd_node *n = _znode_next_child(w, 0);
     FOR_CHILDREN(w) { 
-        zrect rect = _znode_padded_rect(n, origin, padding, min_conn_space);
-        _push_rect_cmd(rect, foreground, child->zindex); 
-        // 0 => nothing hovered, index<=-1 => input(1-index), index>=1 => output(index-1)
-        i32 index = _draw_connection_points(n, rect, true, w->widget.zindex, in_colors)
-            + _draw_connection_points(n, rect, false, w->widget.zindex, out_colors);
-        if(_ui_cont_hovered(&w->widget)) {
-            if(_ui_clicked(ZM_LEFT_CLICK) && _vec_within(_ui_mpos(), rect))
-                w->state->dragged = n;
-            if(index != 0) { // a connection point is hovered
-                if(_ui_clicked(ZM_LEFT_CLICK)) {
-                    w->state->drag_state = index; 
-                    w->state->dragged = n;
-                } else if(_ui_clicked(ZM_RIGHT_CLICK)) {
-                    if(index < 0) {
-                        znode_del_in_links(w->state, n, -index-1);
-                    }
-                    else {
-                        znode_del_out_links(w->state, n, index-1);
-                    }
-                    reportstuff(w->state);
-                } else if(_ui_released(ZM_LEFT_CLICK) && (index ^ w->state->drag_state) < 0) { 
-                    if(index > 0) {
-                        znode_link(w->state, n, index - 1, w->state->dragged, -w->state->drag_state - 1);
-                    } else {
-                        znode_link(w->state, w->state->dragged, w->state->drag_state - 1, n, -index - 1); 
-                    }
-                    reportstuff(w->state);
+        if(!(n->flags & NODE_SHOWN)) {
+            n = _znode_next_child(w, n);
+            continue;
+        }
+        zrect rect = _znode_padded_rect(n, origin, zoom, padding, min_conn_space);
+        _push_rect_cmd(rect, n->flags & ZF_NODE_SELECTED ? selected : foreground, child->zindex); 
+        i32 port = hit.node == n ? hit.port : 0;
+        _draw_connection_points(n, rect, true, w->widget.zindex, in_colors, port);
+        _draw_connection_points(n, rect, false, w->widget.zindex, out_colors, port);
+        _ui_draw(child);
+        n = _znode_next_child(w, n);
+    }
+
+    if(hovered) {
+        // port indices: -1 - i => input i, 1 + i => output i
+        i32 index = hit.port;
+        if(_ui_clicked(ZM_LEFT_CLICK)) {
+            w->state->map_current = false; // the selection may change
+            if(hit.node) {
+                w->state->dragged = hit.node;
+                w->state->drag_state = index;
+                if(!index && (_ui_mods() & ZK_SHIFT)) {
+                    hit.node->flags ^= ZF_NODE_SELECTED;
+                } else if(!index && !(hit.node->flags & ZF_NODE_SELECTED)) {
+                    _znode_deselect(w->state);
+                    hit.node->flags |= ZF_NODE_SELECTED;
                 }
+            } else if(_ui_mods() & ZK_SHIFT) {
+                w->state->selecting = true;
+                w->state->marquee_start = _ui_mpos();
+            } else {
+                _znode_deselect(w->state);
+            }
+        } else if(_ui_clicked(ZM_RIGHT_CLICK)) {
+            if(index < 0) {
+                znode_del_in_links(w->state, hit.node, -index-1);
+                reportstuff(w->state);
+            } else if(index > 0) {
+                znode_del_out_links(w->state, hit.node, index-1);
+                reportstuff(w->state);
+            } else if(hit.link) {
+                znode_del_link(w->state, hit.link);
+                reportstuff(w->state);
             }
+        } else if(_ui_released(ZM_LEFT_CLICK) && index && w->state->dragged && (index ^ w->state->drag_state) < 0) { 
+            if(index > 0) {
+                znode_link(w->state, hit.node, index - 1, w->state->dragged, -w->state->drag_state - 1);
+            } else {
+                znode_link(w->state, w->state->dragged, w->state->drag_state - 1, hit.node, -index - 1); 
+            }
+            reportstuff(w->state);
         }
-        if(w->state->dragged == n) selected_rect = rect;
-        _ui_draw(child);
-        n = n->next;
+    }
+
+    if(hovered && _ui_mscroll()) {
+        i32 steps = _ui_mscroll() > 0 ? _ui_mscroll() : -_ui_mscroll();
+        f32 factor = 1;
+        for(i32 i = 0; i < steps && i < 10; i++)
+            factor *= 1.1f;
+        znode_zoom(w->state, _ui_mscroll() > 0 ? zoom * factor : zoom / factor, _ui_mpos());
+    }
+
+    if(w->state->selecting) {
+        zvec2 a = w->state->marquee_start, b = _ui_mpos();
+        zrect marquee = { a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y, abs(b.x - a.x), abs(b.y - a.y) };
+        if(_ui_pressed(ZM_LEFT_CLICK)) {
+            zvec2 outline[5] = { marquee.pos, { marquee.x + marquee.w, marquee.y }, _vec_add(marquee.pos, marquee.sz), { marquee.x, marquee.y + marquee.h }, marquee.pos };
+            _push_lines_cmd(5, outline, 1, (zcolor) { 255, 255, 255, 255 }, w->widget.zindex + 2);
+            return;
+        }
+        zd_node *found[64];
+        i32 cnt = znode_query_rect(w->state, marquee, found, 64);
+        if(cnt > 64) {
+            cnt = znode_query_rect(w->state, marquee, 0, 0);
+            zd_node **all = ZUI_MALLOC(cnt * sizeof(zd_node*));
+            znode_query_rect(w->state, marquee, all, cnt);
+            for(i32 i = 0; i < cnt; i++)
+                all[i]->flags |= ZF_NODE_SELECTED;
+            ZUI_FREE(all);
+        } else {
+            for(i32 i = 0; i < cnt; i++)
+                found[i]->flags |= ZF_NODE_SELECTED;
+        }
+        w->state->map_current = false;
+        w->state->selecting = false;
+        return;
     }
 
     n = w->state->dragged;
@@ -361,9 +1584,22 @@ static void _znode_editor_draw(zw_node_editor *w) {
         return;
     } 
     i32 index = w->state->drag_state;
+    zrect selected_rect = _znode_padded_rect(n, origin, zoom, padding, min_conn_space);
+    // the node follows the mouse in graph units, which are smaller than a pixel when zoomed in
+    zvec2 mouse = _vec_sub(_ui_mpos(), origin);
+    zvec2 at = { mouse.x / zoom, mouse.y / zoom };
+    if(_ui_clicked(ZM_LEFT_CLICK))
+        w->state->grab = _vec_sub(at, n->rect.pos);
     if(_ui_pressed(ZM_LEFT_CLICK)) {
-        if(w->state->drag_state == 0)
-            n->rect.pos = _vec_add(n->rect.pos, _ui_mdelta());
+        if(w->state->drag_state == 0) {
+            zvec2 pos = _vec_sub(at, w->state->grab), delta = _vec_sub(pos, n->rect.pos);
+            znode_move(w->state, n, pos);
+            // the rest of the selection moves along
+            if((n->flags & ZF_NODE_SELECTED) && (delta.x || delta.y))
+                FOR_NODES(w->state)
+                    if(node != n && (node->flags & ZF_NODE_SELECTED))
+                        znode_move(w->state, node, _vec_add(node->rect.pos, delta));
+        }
         if(w->state->drag_state != 0) {
             zvec2 start = _ui_mpos();
             zvec2 end = selected_rect.pos;
@@ -385,6 +1621,7 @@ void zui_node_register() {
     ZSC_NODE_FOUTPUT      = zui_new_sid();
     ZSC_NODE_INPUT        = zui_new_sid();
     ZSC_NODE_FINPUT       = zui_new_sid();
+    ZSC_NODE_SELECTED     = zui_new_sid();
     zui_register(ZW_NODE_EDITOR, "node editor", _znode_editor_size, _znode_editor_pos, _znode_editor_draw);
     zui_default_style(ZW_NODE_EDITOR,
         ZSV_PADDING, (zvec2) { 10, 10 },
@@ -396,5 +1633,6 @@ void zui_node_register() {
         ZSC_NODE_FINPUT, (zcolor) { 150, 255, 150, 255 },
         ZSC_NODE_OUTPUT, (zcolor) { 200, 200, 50, 255 },
         ZSC_NODE_FOUTPUT, (zcolor) { 255, 255, 150, 255 },
+        ZSC_NODE_SELECTED, (zcolor) { 70, 90, 140, 255 },
         ZS_DONE);
 }
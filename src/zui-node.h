@@ -2,7 +2,12 @@
 #define ZNODE_INCLUDED
 #include "zui.h"
 
-#define FOR_NODES(editor) for(zd_node *node = (editor)->head_node; node; node = node->next)
+// nodes and links in the order of their slots in the pools, a linear scan
+#define FOR_NODES(editor) for(zd_node *node = znode_next(editor, 0); node; node = znode_next(editor, node))
+// only the nodes inside the editor's rect, for applications that emit child widgets for visible nodes only. Goes
+// through those alone, in the order of their slots
+#define FOR_VISIBLE_NODES(editor) for(zd_node *node = znode_next_visible(editor, 0); node; node = znode_next_visible(editor, node))
+#define FOR_LINKS(editor) for(zd_node_link *link = znode_next_link(editor, 0); link; link = znode_next_link(editor, link))
 #define FOR_INPUTS(node) for(zd_node_link *link = (node)->inputs; link; link = link->next_in)
 #define FOR_OUTPUTS(node) for(zd_node_link *link = (node)->outputs; link; link = link->next_out)
 
@@ -10,9 +15,9 @@
 typedef struct zd_node_link {
     struct zd_node *output, *input;
     i32 id_in, id_out;
-    struct zd_node_link *next;
-	struct zd_node_link *next_in;
-	struct zd_node_link *next_out;
+    u32 id;   // slot in the link pool
+	struct zd_node_link *next_in, *prev_in;    // in the input node's inputs
+	struct zd_node_link *next_out, *prev_out;  // in the output node's outputs
 } zd_node_link;
 
 typedef struct zd_node {
@@ -23,9 +28,118 @@ typedef struct zd_node {
     i32 cnt_in, cnt_out;
 	zd_node_link *inputs;
 	zd_node_link *outputs;
-    struct zd_node *next;
+    u32 id;   // slot in the node pool
+    struct zd_node *shadowed; // older node with the same uud and uud_type, found again once this one is deleted
+    u32 ord;  // position in the topological order, outputs come before the inputs they're linked to
+    u32 mark; // the last search that visited the node
+    void *result; // cached by the application with znode_clean, the previous one while the node is dirty
 } zd_node;
 
+typedef struct zd_node_list {
+    zd_node **at;
+    u32 cnt, cap;
+} zd_node_list;
+
+// Nodes and links are allocated from blocks of ZNODE_BLOCK elements which never move, so pointers stay valid until
+// the element is deleted or znode_compact runs. Slots are addressed by index, a bitmap tells the live ones apart
+// and deleted slots are reused from a free list.
+#define ZNODE_BLOCK 1024
+typedef struct zd_node_pool {
+    u8 **blocks;
+    u64 *live;      // a bit per slot
+    u32 *free;      // deleted slots
+    u32 free_cnt, free_cap;
+    u32 block_cnt;
+    u32 end;        // slots used so far, live or deleted
+    u32 size;       // of an element
+} zd_node_pool;
+
+// What the editor drew in its last frame, bucketed by screen cells of ZNODE_CELL pixels for hit-testing: the rect
+// of every node crossing the editor, a ZNODE_PORT_RADIUS square around each of their ports and the bounding box of
+// every link crossing it. Built while drawing, an item is in every cell its rect overlaps. Zoomed out past
+// ZNODE_LOD_FAR only links are, queries find the nodes in the world grid (zd_node_world) with the view they were
+// drawn with
+#define ZNODE_CELL 64
+#define ZNODE_PORT_RADIUS 10
+enum {
+    ZNODE_ITEM_LINK,
+    ZNODE_ITEM_NODE,
+    ZNODE_ITEM_PORT,
+};
+typedef struct zd_node_item {
+    zrect rect;
+    zvec2 start, end; // of a link, its input then its output port
+    u32 id;           // slot of the node or link
+    i16 port;         // as in zd_node_hit
+    u8 kind;
+    u8 shape;         // of a link: 0 loops back, 1 curves forward, 2 is a straight line
+} zd_node_item;
+typedef struct zd_node_grid {
+    zrect area;
+    i32 cols, rows;
+    u32 *cells;       // cols * rows + 1 offsets into refs, a cell's items are in the order they were drawn
+    u32 *refs;
+    zd_node_item *items;
+    u32 item_cnt, item_cap, ref_cap, cell_cap;
+    bool zoomed_out;  // zoomed out past ZNODE_LOD_FAR
+    zvec2 origin;     // of the graph on screen
+    f32 zoom;
+    zvec2 padding;    // the editor's style
+    i32 conn_spacing;
+} zd_node_grid;
+
+// Where nodes and links are in the graph, to find the ones crossing the editor without going through all of them: a
+// grid over the whole range of positions in levels of cells of ZNODE_WORLD_CELL << level units. An item is in the cell
+// of its top left corner on the first level where it's smaller than a cell, so a query looks one cell further up and
+// left on each level. A node's box is twice its size, which it can take on screen down to ZNODE_LOD_FAR, and a link's
+// covers both its nodes' boxes and its curve. Built by the editor's first frame, then kept up to date by every edit
+#define ZNODE_WORLD_CELL 512
+#define ZNODE_WORLD_LEVELS 8   // the last one is a single cell over the whole range
+typedef struct zd_node_world_ref {
+    u32 next, prev;   // slots of the other items in the cell, ~0 at either end
+    u32 cell;         // ~0 while the slot isn't in the grid
+} zd_node_world_ref;
+typedef struct zd_node_world {
+    u32 *cells;       // the first item of each cell, level after level, then the nodes that were never laid out
+    zd_node_world_ref *refs; // by slot
+    u32 ref_cap;
+} zd_node_world;
+
+typedef struct zd_node_hit {
+    zd_node *node;       // of a node or port
+    zd_node_link *link;  // when there's no node or port
+    i32 port;            // 0 none, -1 - i the node's input i, 1 + i its output i
+} zd_node_hit;
+
+// A change to the graph, see znode_journal. Nodes are given by slot and by (uud, uud_type), which still mean something
+// once the node is deleted. A link's events give its output node, then its input node
+enum {
+    ZNODE_EV_ADD,
+    ZNODE_EV_DEL,
+    ZNODE_EV_MOVE,
+    ZNODE_EV_LINK,
+    ZNODE_EV_UNLINK,
+    ZNODE_EV_COMPACT,  // znode_compact gave every node and link a new slot
+    ZNODE_EV_LOAD,     // znode_load replaced the whole graph
+};
+typedef struct zd_node_event {
+    u32 kind;
+    u32 node;           // slot
+    void *uud;
+    i32 uud_type;
+    u32 input;          // of a link, its input node
+    void *input_uud;
+    i32 input_type;
+    i32 in, out;        // of a link its ports, of an added node how many ports it has
+    zvec2 pos;          // of an added or moved node
+} zd_node_event;
+typedef struct zd_node_journal {
+    zd_node_event *events;
+    u32 cap;            // a power of 2, 0 while not recording
+    u64 head;           // events recorded so far, the next one goes to head % cap
+    u64 tail;           // the oldest event still kept
+} zd_node_journal;
+
 typedef struct zd_node_editor {
     zvec2 offset;
     i32 drag_state;
@@ -33,15 +147,84 @@ typedef struct zd_node_editor {
     i32 link_cnt;
     bool has_updated;
     zd_node *dragged;
-    zd_node *head_node;
-    zd_node_link *head_link;
+    zd_node_pool nodes;
+    zd_node_pool links;
+    zd_node **index;  // (uud, uud_type) -> newest node with them, see znode_get
+    u32 index_cap;
+    zrect view;       // the editor's rect in the last frame
+    i32 visible_cnt;
+    u64 *visible;     // a bit per node slot, the nodes crossing the editor's rect this frame
+    u64 *drawn_links; // the same for links, while drawing
+    u64 *map;         // zoomed out, the screen cells nodes cover, see ZNODE_LOD_CELL
+    u32 visible_words, link_words, map_words;
+    bool map_current; // the map is of the graph and the selection as they are, drawn with the grid's view
+    zd_node_world world, link_world;
+    i32 world_ports;  // the most ports on a side of a node in the grid, how far past its rect links can start
+    f32 zoom;         // screen pixels per unit of node positions, 0 is 1
+    zvec2 grab;       // where the dragged node was grabbed, relative to its position
+    zd_node_grid grid;
+    zd_node_list order;    // by ord, deleted nodes leave a 0 until there are enough of them to close the gaps
+    u32 order_holes;
+    u32 epoch;             // of the last search through the graph
+    zd_node_list stack, found;
+    u32 *ords;
+    u32 ords_cap;
+    zd_node_list dirty;    // the dirty nodes, along with some deleted or cleaned since, see znode_recompute
+    zd_node_journal journal;
+    bool selecting;   // a marquee is being dragged from marquee_start
+    zvec2 marquee_start;
 } zd_node_editor;
 
+// Graph files (see znode_save) are a zd_node_file, a zd_node_file_node per node then a zd_node_file_link per link, in
+// the byte order of the machine that wrote them. Nodes are in the order of their slots, numbered from 0 without gaps
+#define ZNODE_FILE_MAGIC 0x31474E5A // "ZNG1"
+#define ZNODE_FILE_VERSION 1
+typedef struct zd_node_file {
+    u32 magic;
+    u32 version;
+    u32 node_cnt;
+    u32 link_cnt;
+    u64 bytes;            // of the whole file
+} zd_node_file;
+typedef struct zd_node_file_node {
+    zrect rect;
+    u64 uud;              // the pointer's value, see znode_load
+    i32 uud_type;
+    i32 flags;
+    u16 cnt_in, cnt_out;
+    u32 ord;              // position in the topological order, from 0 without gaps
+} zd_node_file_node;
+typedef struct zd_node_file_link {
+    u32 output, input;    // nodes by their index in the file
+    i32 id_out, id_in;
+} zd_node_file_link;
+// turns a saved uud back into one of the application's
+typedef void *(*znode_uud_fn)(u64 uud, i32 uud_type, void *user_data);
+
 typedef struct zw_node_editor { Z_CONT; zd_node_editor *state; } zw_node_editor;
 
 enum {
     ZF_NODE_1IN = 1,
     ZF_NODE_1OUT = 2,
+    ZF_NODE_SELECTED = 64, // set by clicks and the marquee (shift + drag) in the editor, dragging moves all of them.
+                           // Set by the application, clear map_current for the map to show it
+    ZF_NODE_DIRTY = 128,   // its result is out of date, see znode_dirty
+};
+
+// Below ZNODE_LOD_FAR the editor draws a map of the graph: the screen cells of ZNODE_LOD_CELL pixels covered by a
+// node are filled, a rect for each run of them in a row and the same rows below, so what it sends is bounded by its
+// area rather than by the graph. They're kept until the graph, the selection or the view change. Links are straight
+// lines down to ZNODE_LOD_LINKS and left out below. Nodes smaller than a pixel aren't drawn, nor links to them or
+// whose ends meet. No ports, no child widgets. Closer than ZNODE_LOD_FAR nodes keep the size their widgets need and
+// only the distances between them scale
+#define ZNODE_LOD_FAR 0.5f
+#define ZNODE_LOD_LINKS 0.1f
+#define ZNODE_LOD_CELL 4
+#define ZNODE_ZOOM_MIN 0.02f
+#define ZNODE_ZOOM_MAX 4.0f
+enum {
+    ZNODE_LOD_FULL,
+    ZNODE_LOD_RECTS,
 };
 
 extern i32 ZW_NODE_EDITOR;
@@ -50,19 +233,93 @@ extern i32 ZSC_NODE_OUTPUT;
 extern i32 ZSC_NODE_FOUTPUT;
 extern i32 ZSC_NODE_INPUT;
 extern i32 ZSC_NODE_FINPUT;
+extern i32 ZSC_NODE_SELECTED;
 
+// Copies the nodes in topological order into <arr> and returns how many there are, O(n). The order is kept up to date
+// as links are added (Pearce-Kelly: only the nodes between the two ends are reordered), and znode_link refuses links
+// that would close a cycle
 i32 znode_toposort(zd_node_editor *state, zd_node **arr);
 
+// Incremental evaluation: a node is dirty until the application caches its result with znode_clean. New nodes are
+// dirty, adding or deleting a link dirties the node it feeds, and dirtying a node dirties everything downstream of it
+// along its outputs. Nodes already dirty aren't walked again, so it costs O(nodes it newly dirties)
+void znode_dirty(zd_node_editor *state, zd_node *node);
+void znode_clean(zd_node *node, void *result);
+// The dirty nodes in topological order, O(k log k) for k of them. Computing each from its inputs' results in that order
+// brings the graph up to date. Owned by the editor, valid until the graph is changed
+zd_node **znode_recompute(zd_node_editor *state, i32 *cnt);
+
+// Records every add, delete, move, link and unlink in a ring buffer of the <cap> latest events (rounded up to a power of
+// 2), so that models mirroring the graph can apply the changes instead of comparing the whole graph. 0 stops recording.
+// Off until it's called, and znode_free turns it off again
+void znode_journal(zd_node_editor *state, u32 cap);
+// Copies the events after <*cursor> into <out>, at most <cap> of them, and moves the cursor past them. Returns how many,
+// or -1 if some the consumer hadn't read were overwritten: it has to resync from the graph, and the cursor is moved to
+// the oldest event kept. Every consumer keeps its own cursor, state->journal.head to start from the current graph
+i32 znode_journal_read(zd_node_editor *state, u64 *cursor, zd_node_event *out, i32 cap);
+// Moves a node, recorded in the journal. The editor moves dragged nodes with it
+void znode_move(zd_node_editor *state, zd_node *node, zvec2 pos);
+
+// Writes the graph to <out> as a graph file and returns its size, or only returns the size needed when <out> is 0 or
+// smaller than that. Positions, port counts, flags, links and the topological order are kept, results aren't
+u64 znode_save(zd_node_editor *state, void *out, u64 cap);
+bool znode_save_file(zd_node_editor *state, char *path);
+// Replaces the graph with the one saved in <data>, false if it isn't a valid graph file, leaving the graph as it was.
+// Files holding links znode_link would refuse aren't valid: to ports the nodes don't have, twice the same, or breaking
+// ZF_NODE_1IN / ZF_NODE_1OUT.
+// Every pool is allocated and filled in one pass, without going through znode_add and znode_link, and all nodes are
+// dirty. uuds are saved as numbers, which is enough for ids, while pointers only mean something in the process that
+// saved them: <remap>, if given, turns each into the application's own. The journal records a ZNODE_EV_LOAD
+bool znode_load(zd_node_editor *state, void *data, u64 len, znode_uud_fn remap, void *user_data);
+// maps the file and loads it
+bool znode_load_file(zd_node_editor *state, char *path, znode_uud_fn remap, void *user_data);
+
+// the live node / link after <node> / <link>, the first one for 0
+zd_node *znode_next(zd_node_editor *state, zd_node *node);
+zd_node_link *znode_next_link(zd_node_editor *state, zd_node_link *link);
+// by slot, 0 if the slot isn't in use
+zd_node *znode_at(zd_node_editor *state, u32 id);
+zd_node_link *znode_link_at(zd_node_editor *state, u32 id);
+// Moves every node and link down to the lowest free slots, keeping their order, and frees the blocks left empty.
+// Invalidates all zd_node and zd_node_link pointers held outside the editor: get them again with znode_get
+void znode_compact(zd_node_editor *state);
+
+// O(1), the most recently added node with <uud> and <uud_type>
 zd_node *znode_get(zd_node_editor *state, void *uud, i32 uud_type);
+// Whether the node's child widget is shown: the node is inside the editor's rect and the editor isn't zoomed out
+// past ZNODE_LOD_FAR, decided by zui_node_editor for the frame being built. The editor takes either a child widget for
+// every node (FOR_NODES) or for the shown ones only (FOR_VISIBLE_NODES). Either way only shown nodes are laid out,
+// and only nodes and links crossing the editor's rect are drawn
+bool znode_visible(zd_node *node);
+// the next node after <node> (from the first one if 0) whose child widget is shown, see FOR_VISIBLE_NODES
+zd_node *znode_next_visible(zd_node_editor *state, zd_node *node);
+// Sets the zoom, clamped to ZNODE_ZOOM_MIN..MAX, keeping <anchor> (screen coordinates) over the same point of the
+// graph. The mouse wheel over the editor zooms around the mouse
+void znode_zoom(zd_node_editor *state, f32 zoom, zvec2 anchor);
+i32 znode_lod(zd_node_editor *state);
+// Queries on what the editor drew in its last frame, in screen coordinates. A port wins over its node, a node over a
+// link and what's drawn later over what's below it
+zd_node_hit znode_hit(zd_node_editor *state, zvec2 pos);
+// the nodes whose rect crosses <rect>, returns how many there are, of which the first <cap> are put in <out>
+i32 znode_query_rect(zd_node_editor *state, zrect rect, zd_node **out, i32 cap);
 zd_node *znode_add(zd_node_editor *state, void *uud, i32 uud_type, zvec2 pos, i32 inputs, i32 outputs, i32 flags);
 
 bool znode_del_out_links(zd_node_editor *state, zd_node *node, i32 id_out);
 bool znode_del_in_links(zd_node_editor *state, zd_node *node, i32 id_in);
 bool znode_del(zd_node_editor *state, void *uud, i32 uud_type);
+// Deleting costs O(degree) of the node, a link O(1).
+// The batch versions skip what's already deleted, so the same node or link may be listed twice
+bool znode_del_node(zd_node_editor *state, zd_node *node);
+void znode_del_link(zd_node_editor *state, zd_node_link *link);
+i32 znode_del_nodes(zd_node_editor *state, zd_node **nodes, i32 cnt);
+i32 znode_del_links(zd_node_editor *state, zd_node_link **links, i32 cnt);
 
+// false if the link exists, the port takes a single link (ZF_NODE_1IN / 1OUT) or <input> reaches <output> already
 bool znode_link(zd_node_editor *state, zd_node *output, i32 out_index, zd_node *input, i32 in_index);
 void zui_node_editor(zd_node_editor *state);
 bool znode_updated(zd_node_editor *state);
+// frees every node and link, the editor can be used again afterwards
+void znode_free(zd_node_editor *state);
 void zui_node_register();
 
 #endif
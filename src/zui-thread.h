@@ -0,0 +1,114 @@
+#ifndef ZTHREAD_INCLUDED
+#define ZTHREAD_INCLUDED
+
+// Threads, locks and atomics for the node graph engines (zui-exec.c, zui-layout.c): POSIX threads, or Win32.
+// Like the core's clock, the Win32 calls are declared here so these files don't include windows.h.
+// Atomics take the memory order GCC's builtins take, the Interlocked ones on Windows are full barriers and ignore it.
+// Win32 needs a 64 bit target, there's no 64 bit Interlocked intrinsic on x86.
+
+#ifdef _WIN32
+#include <intrin.h>
+
+typedef void *zthread;
+typedef struct zmutex { void *ptr; } zmutex;    // SRWLOCK
+typedef struct zcond { void *ptr; } zcond;      // CONDITION_VARIABLE
+// the return type of a thread function: static ZTHREAD_FN worker(void *arg) { ... return 0; }
+#define ZTHREAD_FN unsigned long __stdcall
+
+union _LARGE_INTEGER;
+__declspec(dllimport) void *__stdcall CreateThread(void *attributes, unsigned long long stack, unsigned long (__stdcall *fn)(void*), void *arg, unsigned long flags, unsigned long *id);
+__declspec(dllimport) unsigned long __stdcall WaitForSingleObject(void *handle, unsigned long ms);
+__declspec(dllimport) int __stdcall CloseHandle(void *handle);
+__declspec(dllimport) void __stdcall InitializeSRWLock(zmutex *lock);
+__declspec(dllimport) void __stdcall AcquireSRWLockExclusive(zmutex *lock);
+__declspec(dllimport) void __stdcall ReleaseSRWLockExclusive(zmutex *lock);
+__declspec(dllimport) void __stdcall InitializeConditionVariable(zcond *cond);
+__declspec(dllimport) void __stdcall WakeConditionVariable(zcond *cond);
+__declspec(dllimport) void __stdcall WakeAllConditionVariable(zcond *cond);
+__declspec(dllimport) int __stdcall SleepConditionVariableSRW(zcond *cond, zmutex *lock, unsigned long ms, unsigned long flags);
+__declspec(dllimport) unsigned long __stdcall GetActiveProcessorCount(unsigned short group);
+__declspec(dllimport) int __stdcall QueryPerformanceCounter(union _LARGE_INTEGER *count);
+__declspec(dllimport) int __stdcall QueryPerformanceFrequency(union _LARGE_INTEGER *freq);
+
+static inline bool zthread_start(zthread *t, ZTHREAD_FN (*fn)(void*), void *arg) { *t = CreateThread(0, 0, fn, arg, 0, 0); return *t != 0; }
+static inline void zthread_join(zthread t) { WaitForSingleObject(t, 0xFFFFFFFF); CloseHandle(t); }
+static inline void zmutex_init(zmutex *m) { InitializeSRWLock(m); }
+static inline void zmutex_destroy(zmutex *m) { (void)m; }
+static inline void zmutex_lock(zmutex *m) { AcquireSRWLockExclusive(m); }
+static inline void zmutex_unlock(zmutex *m) { ReleaseSRWLockExclusive(m); }
+static inline void zcond_init(zcond *c) { InitializeConditionVariable(c); }
+static inline void zcond_destroy(zcond *c) { (void)c; }
+static inline void zcond_wait(zcond *c, zmutex *m) { SleepConditionVariableSRW(c, m, 0xFFFFFFFF, 0); }
+static inline void zcond_signal(zcond *c) { WakeConditionVariable(c); }
+static inline void zcond_broadcast(zcond *c) { WakeAllConditionVariable(c); }
+// ALL_PROCESSOR_GROUPS
+static inline i32 zthread_cpus() { return GetActiveProcessorCount(0xFFFF); }
+static inline u64 zthread_ns() {
+    static i64 freq;
+    i64 ts;
+    if(!freq) QueryPerformanceFrequency((union _LARGE_INTEGER*)&freq);
+    QueryPerformanceCounter((union _LARGE_INTEGER*)&ts);
+    return (u64)(ts / freq) * 1000000000 + (u64)(ts % freq) * 1000000000 / freq;
+}
+
+#define ZATOMIC_RELAXED 0
+#define ZATOMIC_ACQUIRE 0
+#define ZATOMIC_RELEASE 0
+#define ZATOMIC_ACQ_REL 0
+#define ZATOMIC_SEQ_CST 0
+#define zatomic_load(p, order) (sizeof(*(p)) == 8 ? (u64)_InterlockedOr64((volatile long long*)(p), 0) : \
+                                sizeof(*(p)) == 4 ? (u32)_InterlockedOr((volatile long*)(p), 0) : \
+                                                    (u8)_InterlockedOr8((volatile char*)(p), 0))
+#define zatomic_store(p, v, order) (sizeof(*(p)) == 8 ? (void)_InterlockedExchange64((volatile long long*)(p), (long long)(v)) : \
+                                    sizeof(*(p)) == 4 ? (void)_InterlockedExchange((volatile long*)(p), (long)(v)) : \
+                                                        (void)_InterlockedExchange8((volatile char*)(p), (char)(v)))
+// 32 and 64 bit only, returns the new value
+#define zatomic_add(p, v, order) (sizeof(*(p)) == 8 ? (u64)(_InterlockedExchangeAdd64((volatile long long*)(p), (long long)(v)) + (long long)(v)) : \
+                                                      (u32)(_InterlockedExchangeAdd((volatile long*)(p), (long)(v)) + (long)(v)))
+#define zatomic_sub(p, v, order) zatomic_add(p, -(v), order)
+
+#elif defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef pthread_t zthread;
+typedef pthread_mutex_t zmutex;
+typedef pthread_cond_t zcond;
+// the return type of a thread function: static ZTHREAD_FN worker(void *arg) { ... return 0; }
+#define ZTHREAD_FN void *
+
+static inline bool zthread_start(zthread *t, ZTHREAD_FN (*fn)(void*), void *arg) { return !pthread_create(t, 0, fn, arg); }
+static inline void zthread_join(zthread t) { pthread_join(t, 0); }
+static inline void zmutex_init(zmutex *m) { pthread_mutex_init(m, 0); }
+static inline void zmutex_destroy(zmutex *m) { pthread_mutex_destroy(m); }
+static inline void zmutex_lock(zmutex *m) { pthread_mutex_lock(m); }
+static inline void zmutex_unlock(zmutex *m) { pthread_mutex_unlock(m); }
+static inline void zcond_init(zcond *c) { pthread_cond_init(c, 0); }
+static inline void zcond_destroy(zcond *c) { pthread_cond_destroy(c); }
+static inline void zcond_wait(zcond *c, zmutex *m) { pthread_cond_wait(c, m); }
+static inline void zcond_signal(zcond *c) { pthread_cond_signal(c); }
+static inline void zcond_broadcast(zcond *c) { pthread_cond_broadcast(c); }
+static inline i32 zthread_cpus() { return sysconf(_SC_NPROCESSORS_ONLN); }
+static inline u64 zthread_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+#define ZATOMIC_RELAXED __ATOMIC_RELAXED
+#define ZATOMIC_ACQUIRE __ATOMIC_ACQUIRE
+#define ZATOMIC_RELEASE __ATOMIC_RELEASE
+#define ZATOMIC_ACQ_REL __ATOMIC_ACQ_REL
+#define ZATOMIC_SEQ_CST __ATOMIC_SEQ_CST
+#define zatomic_load(p, order) __atomic_load_n(p, order)
+#define zatomic_store(p, v, order) __atomic_store_n(p, v, order)
+// returns the new value
+#define zatomic_add(p, v, order) __atomic_add_fetch(p, v, order)
+#define zatomic_sub(p, v, order) __atomic_sub_fetch(p, v, order)
+
+#else
+#error "zui-thread.h: no threads for this platform, the node graph engines need POSIX threads or Win32"
+#endif
+
+#endif
@@ -4,7 +4,41 @@
 #define ZUI_SRC
 #include "zui.h"
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
+#ifdef _WIN32
+#include <malloc.h>
+// the few Win32 calls the core makes, declared as windows.h does rather than including it: its near, far, min and max
+// macros would reach every file built together with zui.c
+#ifndef _WINDOWS_
+#ifdef _WIN64
+typedef unsigned long long zwin_size;
+#else
+typedef unsigned long zwin_size;
+#endif
+union _LARGE_INTEGER;
+struct _SECURITY_ATTRIBUTES;
+__declspec(dllimport) int __stdcall QueryPerformanceCounter(union _LARGE_INTEGER *count);
+__declspec(dllimport) int __stdcall QueryPerformanceFrequency(union _LARGE_INTEGER *freq);
+__declspec(dllimport) void *__stdcall CreateFileA(const char *name, unsigned long access, unsigned long share,
+    struct _SECURITY_ATTRIBUTES *security, unsigned long disposition, unsigned long flags, void *template_file);
+__declspec(dllimport) int __stdcall GetFileSizeEx(void *file, union _LARGE_INTEGER *size);
+__declspec(dllimport) void *__stdcall CreateFileMappingA(void *file, struct _SECURITY_ATTRIBUTES *security,
+    unsigned long protect, unsigned long size_high, unsigned long size_low, const char *name);
+__declspec(dllimport) void *__stdcall MapViewOfFile(void *mapping, unsigned long access, unsigned long offset_high,
+    unsigned long offset_low, zwin_size size);
+__declspec(dllimport) int __stdcall UnmapViewOfFile(const void *base);
+__declspec(dllimport) int __stdcall CloseHandle(void *handle);
+#endif
+#else
+#include <alloca.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define _alloca alloca
+#endif
 
 #define min(a, b) ((a) < (b) ? (a) : (b))
 #define max(a, b) ((a) > (b) ? (a) : (b))
@@ -20,6 +54,13 @@ typedef struct zui_type {
     void (*draw)(void*);
 } zui_type;
 
+// A registered font
+typedef struct zui_font_info {
+    zgc_font cache;     // its key and glyphs in the glyph cache file
+    u32 pending;        // the backend is still loading it
+    zui_font_stats stats;
+} zui_font_info;
+
 // Initialize buffer
 void zbuf_init(zui_buf *l, i32 cap, i32 alignment) {
     // get log2 of cap
@@ -29,17 +70,21 @@ void zbuf_init(zui_buf *l, i32 cap, i32 alignment) {
     l->cap = (tmp.i >> 23) - 126;
     l->used = 0;
     l->alignsub1 = alignment - 1;
-    l->data = malloc(cap);
+    l->high_water = 0;
+    l->reallocs = 0;
+    l->data = ZUI_MALLOC(cap);
 }
 void _zbuf_resize(zui_buf *l) {
     if(l->used <= (1 << l->cap)) return;
-    l->cap++;
-    l->data = realloc(l->data, 1 << l->cap);
+    while(l->used > (1 << l->cap)) l->cap++; // large allocations can need more than one doubling
+    l->data = ZUI_REALLOC(l->data, 1 << l->cap);
+    l->reallocs++;
 }
 // Allocate an aligned memory block on a given buffer
 void *zbuf_alloc(zui_buf *l, i32 size) {
     i32 used = l->used;
     l->used += (size + l->alignsub1) & ~l->alignsub1;
+    if(l->used > l->high_water) l->high_water = l->used;
     _zbuf_resize(l);
     return l->data + used;
 }
@@ -57,7 +102,7 @@ void *zbuf_pop(zui_buf *l, i32 size) {
 typedef struct zstyle { u16 widget_id; u16 style_id; union { zcolor c; zvec2 v; i32 i; u32 u; f32 f; } value; } zstyle;
 
 // Dead simple map implementation
-// Our use case doesn't require deletions which simplifies logic quite a bit
+// Linear probing, so deleting shifts the following entries of the cluster back instead of leaving tombstones
 typedef struct zmap {
     u32 cap;
     u32 used;
@@ -67,7 +112,7 @@ typedef struct zmap {
 void zmap_init(zmap *map) {
     map->used = 0;
     map->cap = 16;
-    map->data = calloc(map->cap, sizeof(u64));
+    map->data = ZUI_CALLOC(map->cap, sizeof(u64));
 }
 // Hash bits so we don't have to deal with collisions as much.
 // This hashing function is 31 bit. We use the top bit to determine whether a hashmap slot is filled.
@@ -95,20 +140,58 @@ bool zmap_get(zmap *map, u32 key, u32 *value) {
     *value = (*node >> 32);
     return (u32)*node != 0;
 }
+ZUI_PRIVATE void _zmap_rehash(zmap *map, u32 cap) {
+    u64 *old = (u64*)map->data;
+    u32 old_cap = map->cap;
+    map->cap = cap;
+    map->data = ZUI_CALLOC(map->cap, sizeof(u64));
+    for (u32 i = 0; i < old_cap; i++)
+        if ((u32)old[i])
+            *zmap_node(map, (u32)old[i]) = old[i];
+    ZUI_FREE(old);
+}
 void zmap_set(zmap *map, u32 key, u32 value) {
-    if (map->used * 4 > map->cap * 3) { // if load-factor > 75%, rehash
-        u64 *old = (u64*)map->data;
-        map->cap *= 2;
-        map->data = calloc(map->cap, sizeof(u64));
-        for (i32 i = 0; i < map->cap / 2; i++)
-            if ((u32)old[i])
-                *zmap_node(map, (u32)old[i]) = old[i];
-        free(old);
-    }
+    if (map->used * 4 > map->cap * 3) // if load-factor > 75%, rehash
+        _zmap_rehash(map, map->cap * 2);
     u64 *node = zmap_node(map, key);
     if (!*node) map->used++;
     *node = ((u64)value << 32) | key;
 }
+// empties <node> and moves back the entries after it that would no longer be found past the gap
+ZUI_PRIVATE void _zmap_del_node(zmap *map, u64 *node) {
+    u32 gap = node - map->data;
+    for (u32 i = (gap + 1) % map->cap; (u32)map->data[i]; i = (i + 1) % map->cap) {
+        u32 home = (u32)map->data[i] % map->cap;
+        // the entry stays if its home slot is cyclically in (gap, i]
+        if (gap < i ? gap < home && home <= i : gap < home || home <= i) continue;
+        map->data[gap] = map->data[i];
+        gap = i;
+    }
+    map->data[gap] = 0;
+    map->used--;
+}
+bool zmap_del(zmap *map, u32 key) {
+    u64 *node = zmap_node(map, key);
+    if ((u32)*node == 0) return false;
+    _zmap_del_node(map, node);
+    return true;
+}
+// Walks every slot, so only call it when the map changed
+ZUI_PRIVATE void _zmap_stats(zmap *map, zui_map_stats *stats) {
+    u64 probes = 0;
+    stats->max_probe = 0;
+    for (u32 i = 0; i < map->cap; i++) {
+        u32 key = (u32)map->data[i];
+        if (!key) continue;
+        u32 probe = (i + map->cap - key % map->cap) % map->cap + 1;
+        probes += probe;
+        if (probe > stats->max_probe) stats->max_probe = probe;
+    }
+    stats->used = map->used;
+    stats->capacity = map->cap;
+    stats->load = (f32)map->used / map->cap;
+    stats->avg_probe = map->used ? (f32)probes / map->used : 0;
+}
 // zui-glyph-cache hash
 ZUI_PRIVATE u32 _zgc_hash(u16 font_id, i32 codepoint) {
     // code point must be under U+10FFFF so we can include the font_id in the key
@@ -120,6 +203,7 @@ ZUI_PRIVATE u32 _zs_hash(u16 widget_id, u16 style_id) {
 }
 
 ZUI_PRIVATE u8 _utf8_masks[] = { 0, 0x7F, 0x1F, 0xF, 0x7 };
+ZUI_PRIVATE u8 _utf8_prefixes[] = { 0, 0, 0xC0, 0xE0, 0xF0 };
 // returns the byte length of the first utf8 character in <text> and puts the unicode value in <codepoint>
 i32 utf8_val(char *text, u32 *codepoint) {
     if(*text >= 0) { // most often case
@@ -145,8 +229,8 @@ i32 utf8_len(u32 codepoint) {
 // fills text with the utf8 encoding of <codepoint> given its utf8 byte length <len>
 void utf8_print(char *text, u32 codepoint, i32 len) {
     for (i32 i = len - 1; i > 0; codepoint >>= 6)
-        text[i--] = 0xC0 | (codepoint & 0x3F);
-    text[0] = codepoint & _utf8_masks[len];
+        text[i--] = 0x80 | (codepoint & 0x3F);
+    text[0] = _utf8_prefixes[len] | (codepoint & _utf8_masks[len]);
 }
 
 typedef struct zui_ctx {
@@ -169,7 +253,9 @@ typedef struct zui_ctx {
     zvec2 padding;
     u16 font_id;
     u16 longest_registry_name;
-    i64 *diagnostics;
+    zui_stats stats;
+    i64 text_ns;        // text measured since the last zui_render, including while the tree was built
+    i32 widget_cnt;
     i32 next_flags;
     i32 latest;
     i32 style_edits;
@@ -183,6 +269,22 @@ typedef struct zui_ctx {
     zui_buf zdeque;     // lifetime: generating draw calls
     zui_buf text;
     zui_buf json;       // lifetime: json serialization
+    zui_buf record;     // lifetime: one frame, then written to record_file
+    FILE *record_file;
+    u32 record_flags;
+    u32 record_frames;
+    zui_buf fonts;      // lifetime: all the time. A zui_font_info per registered font
+    zui_buf glyph_log;  // lifetime: until saved. Glyphs measured since zui_glyph_cache_open, as font_id << 21 | codepoint
+    u8 *gc_file;        // mapped glyph cache file
+    i64 gc_len;
+    bool gc_enabled;
+    i32 glyph_queries;
+    i32 glyph_file_hits;
+    i32 glyph_evictions;
+    u32 glyph_limit;    // glyphs kept in ctx->glyphs, 0 for no limit
+    u32 glyph_cnt;      // glyphs in ctx->glyphs, without the font heights
+    u32 glyph_hand;     // slot the CLOCK hand points at
+    zui_font_stats unknown_font; // glyphs of font ids that weren't registered
     zmap style;
     i32 __focused; // used for calculating focused
     i32 focused;
@@ -246,40 +348,335 @@ void zui_log(char *fmt, ...) {
         zui_meta_line(((zw_base*)widget)->meta), ##__VA_ARGS__)
 #endif
 
+// Appends a record to the current recording, padded to 8 bytes
+ZUI_PRIVATE void _zui_record(void *record) {
+    if(!ctx->record_file) return;
+    i32 bytes = ((zcmd*)record)->bytes;
+    u8 *out = zbuf_alloc(&ctx->record, bytes);
+    memcpy(out, record, bytes);
+    memset(out + bytes, 0, zbuf_align(&ctx->record, bytes) - bytes);
+}
+ZUI_PRIVATE void _zui_record_mouse() {
+    _zui_record(&(zccmd_mouse) { { ZCCMD_MOUSE, sizeof(zccmd_mouse) }, ctx->mouse_pos, ctx->mouse_state });
+}
+
+// Glyph cache file
+ZUI_PRIVATE u32 _zgc_family(char *family) {
+    u32 hash = 0x811C9DC5;
+    for(; *family; family++)
+        hash = (hash ^ (u8)*family) * 0x01000193;
+    return hash;
+}
+ZUI_PRIVATE zui_font_info *_zui_font_info(u16 font_id) {
+    return (zui_font_info*)ctx->fonts.data + font_id;
+}
+ZUI_PRIVATE zgc_font *_zgc_file_fonts() {
+    return (zgc_font*)(ctx->gc_file + sizeof(zgc_header));
+}
+ZUI_PRIVATE u64 *_zgc_file_glyphs() {
+    return (u64*)(_zgc_file_fonts() + ((zgc_header*)ctx->gc_file)->font_cnt);
+}
+// points a registered font at its glyphs in the file, if the file has the same face
+ZUI_PRIVATE void _zgc_resolve(zgc_font *font) {
+    font->first = ~0u;
+    font->cnt = 0;
+    if(!ctx->gc_file || !font->identity) return;
+    zgc_font *saved = _zgc_file_fonts();
+    for(u32 i = 0; i < ((zgc_header*)ctx->gc_file)->font_cnt; i++) {
+        if(saved[i].family == font->family && saved[i].size == font->size && saved[i].height == font->height && saved[i].identity == font->identity) {
+            font->first = saved[i].first;
+            font->cnt = saved[i].cnt;
+            return;
+        }
+    }
+}
+ZUI_PRIVATE bool _zgc_lookup(u16 font_id, u32 codepoint, u32 *width) {
+    if(!ctx->gc_file || font_id >= ctx->font_cnt) return false;
+    zgc_font *font = &_zui_font_info(font_id)->cache;
+    if(font->first == ~0u) return false;
+    u64 *glyphs = _zgc_file_glyphs() + font->first;
+    for(u32 lo = 0, hi = font->cnt; lo < hi;) {
+        u32 mid = (lo + hi) / 2, cp = (u32)(glyphs[mid] >> 32);
+        if(cp == codepoint) {
+            *width = (u32)glyphs[mid];
+            return true;
+        }
+        if(cp < codepoint) lo = mid + 1;
+        else hi = mid;
+    }
+    return false;
+}
+ZUI_PRIVATE void _zgc_log(u16 font_id, u32 codepoint) {
+    if(ctx->gc_enabled)
+        *(u32*)zbuf_alloc(&ctx->glyph_log, sizeof(u32)) = ((u32)font_id << 21) | (codepoint & 0x1FFFFF);
+}
+
+// Values in ctx->glyphs are <1 bit referenced><1 bit pinned><14 bits font id><16 bits width>.
+// Font heights are pinned, glyphs are evicted with CLOCK once there are glyph_limit of them
+#define ZGC_REFERENCED 0x80000000u
+#define ZGC_PINNED     0x40000000u
+#define ZGC_WIDTH      0xFFFFu
+ZUI_PRIVATE zui_font_stats *_zgc_stats(u16 font_id) {
+    return font_id < ctx->font_cnt ? &_zui_font_info(font_id)->stats : &ctx->unknown_font;
+}
+// the hot path: one probe and one store marking the glyph as used, which leaves nothing to lock or branch on
+ZUI_PRIVATE bool _zgc_get(u32 hash, u32 *width) {
+    u64 *node = zmap_node(&ctx->glyphs, hash);
+    u64 found = (u32)*node != 0;
+    *node |= ((u64)ZGC_REFERENCED << 32) & -found;
+    *width = (u32)(*node >> 32) & ZGC_WIDTH;
+    return found;
+}
+// the hand clears the referenced bit of the glyphs it passes and evicts the first one that wasn't used since its
+// last pass, so it stops within two turns
+ZUI_PRIVATE void _zgc_evict() {
+    zmap *map = &ctx->glyphs;
+    for(;;) {
+        u64 *node = &map->data[ctx->glyph_hand];
+        u32 v = *node >> 32;
+        ctx->glyph_hand = (ctx->glyph_hand + 1) % map->cap;
+        if(!(u32)*node || v & ZGC_PINNED) continue;
+        if(v & ZGC_REFERENCED) {
+            *node &= ~((u64)ZGC_REFERENCED << 32);
+            continue;
+        }
+        zui_font_stats *stats = _zgc_stats(v >> 16 & 0x3FFF);
+        stats->glyphs--;
+        stats->evictions++;
+        ctx->glyph_cnt--;
+        ctx->glyph_evictions++;
+        _zmap_del_node(map, node);
+        return;
+    }
+}
+ZUI_PRIVATE void _zgc_set(u16 font_id, u32 hash, u32 width) {
+    if(!zmap_get_ptr(&ctx->glyphs, hash)) {
+        if(ctx->glyph_limit && ctx->glyph_cnt >= ctx->glyph_limit) _zgc_evict();
+        ctx->glyph_cnt++;
+        _zgc_stats(font_id)->glyphs++;
+    }
+    zmap_set(&ctx->glyphs, hash, ZGC_REFERENCED | (u32)(font_id & 0x3FFF) << 16 | (width & ZGC_WIDTH));
+}
+ZUI_PRIVATE void _zgc_set_height(u16 font_id, u16 height) {
+    zmap_set(&ctx->glyphs, _zgc_hash(font_id, 0x1FFFFF), ZGC_PINNED | height);
+}
+void zui_glyph_cache_limit(u32 glyphs) {
+    ctx->glyph_limit = glyphs;
+    if(!glyphs) return;
+    while(ctx->glyph_cnt > glyphs) _zgc_evict();
+    // gives back the memory of a table grown for more glyphs
+    u32 cap = 16;
+    while((u64)(glyphs + ctx->font_cnt) * 4 > (u64)cap * 3) cap *= 2;
+    if(cap < ctx->glyphs.cap) {
+        _zmap_rehash(&ctx->glyphs, cap);
+        ctx->glyph_hand = 0;
+    }
+}
+zui_font_stats *zui_get_font_stats(u16 font_id) {
+    return font_id < ctx->font_cnt ? &_zui_font_info(font_id)->stats : 0;
+}
+void *_zui_map_file(char *path, i64 *len, bool populate) {
+#ifdef _WIN32
+    // GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL. The view keeps the mapping open once the
+    // handles are closed
+    void *file = CreateFileA(path, 0x80000000, 1, 0, 3, 0x80, 0), *mapping = 0, *data = 0;
+    i64 size = 0;
+    if(file == (void*)-1) return 0;
+    GetFileSizeEx(file, (union _LARGE_INTEGER*)&size);
+    if(size) mapping = CreateFileMappingA(file, 0, 2, 0, 0, 0); // PAGE_READONLY
+    if(mapping) data = MapViewOfFile(mapping, 4, 0, 0, 0);      // FILE_MAP_READ
+    if(mapping) CloseHandle(mapping);
+    CloseHandle(file);
+    *len = size;
+    return data;
+#else
+    i32 fd = open(path, O_RDONLY);
+    if(fd < 0) return 0;
+    struct stat st;
+    i32 flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    if(populate) flags |= MAP_POPULATE; // faulting the file in at once is cheaper than page by page
+#endif
+    void *data = fstat(fd, &st) || !st.st_size ? MAP_FAILED : mmap(0, st.st_size, PROT_READ, flags, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED) return 0;
+    *len = st.st_size;
+    return data;
+#endif
+}
+void _zui_unmap_file(void *data, i64 len) {
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+#else
+    munmap(data, len);
+#endif
+}
+
+ZUI_PRIVATE void _zgc_unmap() {
+    if(!ctx->gc_file) return;
+    _zui_unmap_file(ctx->gc_file, ctx->gc_len);
+    ctx->gc_file = 0;
+    ctx->gc_len = 0;
+}
+ZUI_PRIVATE bool _zgc_valid() {
+    zgc_header *h = (zgc_header*)ctx->gc_file;
+    if(ctx->gc_len < (i64)sizeof(zgc_header) || h->magic != ZGC_MAGIC || h->version != ZGC_VERSION || h->bytes != ctx->gc_len)
+        return false;
+    if(sizeof(zgc_header) + (i64)h->font_cnt * sizeof(zgc_font) + (i64)h->glyph_cnt * sizeof(u64) != ctx->gc_len)
+        return false;
+    zgc_font *fonts = _zgc_file_fonts();
+    for(u32 i = 0; i < h->font_cnt; i++)
+        if((u64)fonts[i].first + fonts[i].cnt > h->glyph_cnt) return false;
+    return true;
+}
+ZUI_PRIVATE bool _zgc_map(char *path) {
+    ctx->gc_file = _zui_map_file(path, &ctx->gc_len, false);
+    if(!ctx->gc_file) return false;
+    if(_zgc_valid()) return true;
+    zui_log("glyph cache %s is invalid, ignoring it\n", path);
+    _zgc_unmap();
+    return false;
+}
+
 i64 zui_ts() {
     zcmd_any ts = { .base = { ZCMD_TIMESTAMP, sizeof(zcmd_timestamp) } };
     ctx->renderer(&ts, ctx->user_data);
+    _zui_record(&(zrcmd_timestamp) { { ZRCMD_TIMESTAMP, sizeof(zrcmd_timestamp) }, 0, ts.timestamp.resp_ns });
     return ts.timestamp.resp_ns;
 }
 
+// Monotonic clock in ns for statistics and tracing.
+// Unlike zui_ts it doesn't go through the renderer, so it's cheap enough to call per widget
+ZUI_PRIVATE i64 _zui_clock() {
+#ifdef _WIN32
+    static i64 freq;
+    i64 ts;
+    if(!freq) QueryPerformanceFrequency((union _LARGE_INTEGER*)&freq);
+    QueryPerformanceCounter((union _LARGE_INTEGER*)&ts);
+    return (ts / freq) * 1000000000 + (ts % freq) * 1000000000 / freq;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (i64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+#ifdef ZUI_TRACE
+// Trace events are written to ctx->json in the Chrome trace event format (JSON array form),
+// which chrome://tracing and ui.perfetto.dev both open
+ZUI_PRIVATE void _zui_trace_printf(char *fmt, ...) {
+    i32 reserve = 256 + ctx->longest_registry_name;
+    i32 used = ctx->json.used; // 0: empty, 1: only the opening bracket
+    char *out = zbuf_alloc(&ctx->json, reserve);
+    i32 n = 0;
+    if(used == 0)     out[n++] = '[';
+    else if(used > 1) out[n++] = ',';
+    out[n++] = '\n';
+    va_list args;
+    va_start(args, fmt);
+    n += vsnprintf(out + n, reserve - n, fmt, args);
+    va_end(args);
+    ctx->json.used -= reserve - min(n, reserve - 1);
+}
+ZUI_PRIVATE void _zui_trace_phase(char ph, char *name, i64 ts) {
+    _zui_trace_printf("{\"name\":\"%s\",\"cat\":\"render\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":1}",
+        name, ph, ts / 1000.0);
+}
+ZUI_PRIVATE void _zui_trace_span(char *name, char *cat, i64 ts) {
+    i64 now = _zui_clock();
+    _zui_trace_printf("{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1}",
+        name, cat, ts / 1000.0, (now - ts) / 1000.0);
+}
+ZUI_PRIVATE void _zui_trace_glyph(u16 font_id, u32 codepoint, i64 ts) {
+    i64 now = _zui_clock();
+    _zui_trace_printf("{\"name\":\"glyph miss\",\"cat\":\"glyph\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1,"
+        "\"args\":{\"font\":%d,\"codepoint\":%u}}", ts / 1000.0, (now - ts) / 1000.0, font_id, codepoint);
+}
+char *zui_trace(i32 *len) {
+    if(!ctx->json.used) *(char*)zbuf_alloc(&ctx->json, 1) = '[';
+    memcpy(zbuf_alloc(&ctx->json, 3), "\n]", 3);
+    ctx->json.used -= 3; // the closing bracket is overwritten by the next event
+    if(len) *len = ctx->json.used + 2;
+    return (char*)ctx->json.data;
+}
+void zui_trace_clear() {
+    ctx->json.used = 0;
+}
+#define ZT_START(var)           i64 var = _zui_clock()
+#define ZT_SPAN(name, cat, var) _zui_trace_span(name, cat, var)
+#define ZT_PHASE(ph, name, ts)  _zui_trace_phase(ph, name, ts)
+#define ZT_GLYPH(font, cp, var) _zui_trace_glyph(font, cp, var)
+#else
+#define ZT_START(var)
+#define ZT_SPAN(name, cat, var)
+#define ZT_PHASE(ph, name, ts)
+#define ZT_GLYPH(font, cp, var)
+#endif
+
+zui_stats *zui_get_stats() {
+    return &ctx->stats;
+}
+
 // Returns the width and height of text given the font id [S]
 i32 zui_text_width(u16 font_id, char *text, i32 len) {
     if(len == -1) len = 0x7FFFFFFF;
-    u32 codepoint, v;
+    u32 codepoint, v, hits = 0, misses = 0;
     i32 ret = 0;
-    i64 tmp = zui_ts();
+    i64 tmp = _zui_clock();
     for(i32 n, i = 0; (n = utf8_val(&text[i], &codepoint)) && codepoint && i < len; i += n, ret += v) {
         u32 hash = _zgc_hash(font_id, (i32)codepoint);
-        if(zmap_get(&ctx->glyphs, hash, &v))
+        if(_zgc_get(hash, &v)) {
+            hits++;
             continue;
+        }
+        if(font_id < ctx->font_cnt && _zui_font_info(font_id)->pending) {
+            // laid out with an estimate until the font is loaded, and not cached
+            v = _zui_font_info(font_id)->cache.size / 2;
+            continue;
+        }
         zcmd_any sz = { .glyph_sz = {
             .header = { ZCMD_GLYPH_SZ, sizeof(zcmd_glyph_sz) },
             .font_id = font_id,
             .codepoint = codepoint
         }};
+        if(_zgc_lookup(font_id, codepoint, &v)) {
+            // an input to the recording, the replay doesn't have the file
+            _zui_record(&(zccmd_glyph) { { ZCCMD_GLYPH, sizeof(zccmd_glyph) }, font_id, codepoint, { v, zui_text_height(font_id) } });
+            _zgc_set(font_id, hash, v);
+            ctx->glyph_file_hits++;
+            misses++;
+            continue;
+        }
+        ZT_START(miss);
         ctx->renderer(&sz, ctx->user_data);
+        ZT_GLYPH(font_id, codepoint, miss);
+        _zui_record(&(zccmd_glyph) { { ZRCMD_GLYPH_SZ, sizeof(zccmd_glyph) }, font_id, codepoint, sz.glyph_sz.response });
         v = sz.glyph_sz.response.x;
-        zmap_set(&ctx->glyphs, hash, v);
-    }
-    tmp = zui_ts() - tmp;
-    ctx->diagnostics[0] += tmp;
+        _zgc_set(font_id, hash, v);
+        _zgc_log(font_id, codepoint);
+        ctx->glyph_queries++;
+        misses++;
+    }
+    zui_font_stats *stats = _zgc_stats(font_id);
+    stats->hits += hits;
+    stats->misses += misses;
+    tmp = _zui_clock() - tmp;
+    ctx->text_ns += tmp;
     return ret;
 }
 
+// advance of the first glyph of <text>, <n> bytes long
+ZUI_PRIVATE i32 _zui_glyph_width(u16 font_id, char *text, i32 n) {
+    u32 codepoint, v;
+    utf8_val(text, &codepoint);
+    if(_zgc_get(_zgc_hash(font_id, codepoint), &v)) return v;
+    return zui_text_width(font_id, text, n);
+}
+
 i32 zui_text_height(u16 font_id) {
     u32 h;
     zmap_get(&ctx->glyphs, _zgc_hash(font_id, 0x1FFFFF), &h);
-    return h;
+    return h & ZGC_WIDTH;
 }
 
 zvec2 zui_text_vec(u16 font_id, char *text, i32 len) {
@@ -299,22 +696,32 @@ i32 (*zui_text_sz[2])(u16 font_id, char *text, i32 len) = {
 };
 
 // Report mouse button press
-void zui_mouse_down(u16 btn) { ctx->mouse_state |= btn; }
+void zui_mouse_down(u16 btn) { ctx->mouse_state |= btn; _zui_record_mouse(); }
 // Report mouse button release
-void zui_mouse_up(u16 btn) { ctx->mouse_state &= ~btn; }
+void zui_mouse_up(u16 btn) { ctx->mouse_state &= ~btn; _zui_record_mouse(); }
 
-void zui_mouse_scroll(i32 delta) { ctx->mouse_scroll += delta; }
+void zui_mouse_scroll(i32 delta) {
+    ctx->mouse_scroll += delta;
+    _zui_record(&(zccmd_scroll) { { ZCCMD_SCROLL, sizeof(zccmd_scroll) }, delta });
+}
 // Report mouse move
-void zui_mouse_move(zvec2 pos) { ctx->mouse_pos = pos; }
+void zui_mouse_move(zvec2 pos) { ctx->mouse_pos = pos; _zui_record_mouse(); }
 // Report key modifiers shift/alt/etc.
-void zui_key_mods(u16 mod) { ctx->keyboard_modifiers = mod; }
+void zui_key_mods(u16 mod) {
+    ctx->keyboard_modifiers = mod;
+    _zui_record(&(zccmd_keys) { { ZCCMD_KEYS, sizeof(zccmd_keys) }, 0, mod });
+}
 
-// Report key press
-void zui_key_char(i32 c) {
+ZUI_PRIVATE void _zui_key_char(i32 c) {
     i32 len = utf8_len(c);
     char *utf8 = (char*)zbuf_alloc(&ctx->text, len);
     utf8_print(utf8, c, len);
 }
+// Report key press
+void zui_key_char(i32 c) {
+    _zui_key_char(c);
+    _zui_record(&(zccmd_keys) { { ZCCMD_KEYS, sizeof(zccmd_keys) }, c, ctx->keyboard_modifiers });
+}
 bool zui_key_pressed(i32 c) {
     char utf8[4];
     i32 len = utf8_len(c);
@@ -327,6 +734,7 @@ bool zui_key_pressed(i32 c) {
 // Report window resize
 void zui_resize(u16 width, u16 height) {
     ctx->window_sz = (zvec2) { width, height };
+    _zui_record(&(zccmd_win) { { ZCCMD_WIN, sizeof(zccmd_win) }, ctx->window_sz });
 }
 // Returns widget pointer given index
 zw_base *_ui_widget(i32 index) {
@@ -364,6 +772,7 @@ void *_ui_alloc(i32 id, i32 size) {
     zw_base *prev = _ui_widget(ctx->latest);
     ctx->latest = prev->next = ctx->ui.used;
     zw_base *widget = zbuf_alloc(&ctx->ui, size);
+    ctx->widget_cnt++;
     memset(widget, 0, size);
     widget->id = id;
     widget->bytes = size;
@@ -423,8 +832,26 @@ void _push_clip_cmd(zrect rect, i32 zindex) {
     zcmd_clip *r = &_draw_alloc(ZCMD_DRAW_CLIP, sizeof(zcmd_clip), zindex)->clip;
     r->rect = rect;
 }
+// Only the glyphs that intersect the clip rect are sent, so a long line in a narrow column stays a short command.
+// Walks the advances up to the right edge of the clip rect, never the rest of the string
 void _push_text_cmd(u16 font_id, zvec2 coord, zcolor color, char *text, i32 len, i32 zindex) {
     if(len == -1) len = strlen(text);
+    zrect clip = ctx->clip_rect;
+    if(coord.y >= clip.y + clip.h || coord.y + zui_text_height(font_id) <= clip.y) return;
+    i32 start = 0, end = 0, x = coord.x, right = clip.x + clip.w;
+    for(i32 n, w; end < len && x < right; end += n, x += w) {
+        u32 codepoint;
+        n = max(utf8_val(&text[end], &codepoint), 1);
+        if(!codepoint) break;
+        w = _zui_glyph_width(font_id, &text[end], n);
+        if(x + w <= clip.x) { // left of the clip rect
+            start = end + n;
+            coord.x = x + w;
+        }
+    }
+    if(start >= end) return;
+    text += start;
+    len = end - start;
     zcmd_text *r = &_draw_alloc(ZCMD_DRAW_TEXT, sizeof(zcmd_text) + len, zindex)->text;
     r->font_id = font_id;
     r->pos = coord;
@@ -548,6 +975,8 @@ void _ui_print(zw_base *cmd, int indent, bool expand_children) {
 
 zvec2 _ui_mpos() { return ctx->mouse_pos; }
 zvec2 _ui_mdelta() { return _vec_sub(ctx->mouse_pos, ctx->prev_mouse_pos); }
+i32 _ui_mscroll() { return ctx->mouse_scroll; }
+u16 _ui_mods() { return ctx->keyboard_modifiers; }
 
 i32 _ui_child_cnt(zw_base *ui) { return (ui->flags & ZF_CONTAINER) ? ((zw_cont*)ui)->children : 0; }
 bool _ui_is_child(zw_base *container, zw_base *other) {
@@ -597,6 +1026,7 @@ i16 _ui_sz(zw_base *ui, bool axis, i16 bound) {
     zui_type type = ((zui_type*)ctx->registry.data)[ui->id - ZW_FIRST];
     bool applied = _ui_apply_styles(ui);
     if(ui->flags & (ZF_SELF_WIDTH << axis)) bound = ui->bounds.sz.e[axis];
+    ZT_START(start);
     i16 sz = type.size(ui, axis, bound);
     // second pass if FILL on axis with auto size.
     if((ui->flags & (ZF_FILL_X << axis)) && bound == Z_AUTO) {
@@ -604,6 +1034,7 @@ i16 _ui_sz(zw_base *ui, bool axis, i16 bound) {
         type.size(ui, axis, sz);
         recalc = false;
     }
+    ZT_SPAN(type.name, axis ? "size y" : "size x", start);
     ui->used.sz.e[axis] = sz;
     ui->bounds.sz.e[axis] = bound == Z_AUTO ? ui->used.sz.e[axis] : bound;
     if(applied) _ui_restore_styles(ui);
@@ -627,7 +1058,9 @@ void _ui_pos_recurse(zw_base *ui, zvec2 pos, i32 zindex) {
     zui_type type = ((zui_type*)ctx->registry.data)[ui->id - ZW_FIRST];
     if(!type.pos) return;
     bool applied = _ui_apply_styles(ui);
+    ZT_START(start);
     type.pos(ui, pos, zindex);
+    ZT_SPAN(type.name, "pos", start);
     if(applied) _ui_restore_styles(ui);
 }
 // _ui_pos serves two purposes.
@@ -684,7 +1117,9 @@ void _ui_draw(zw_base *ui) {
     {
         _push_clip_cmd(ctx->clip_rect, ui->zindex);
         bool applied = _ui_apply_styles(ui);
+        ZT_START(start);
         type.draw(ui);
+        ZT_SPAN(type.name, "draw", start);
         if(applied) _ui_restore_styles(ui);
         _push_clip_cmd(prev_clip, ui->zindex);
     }
@@ -739,17 +1174,46 @@ u16 zui_new_font(char *family, i32 size) {
     font->font_id = ctx->font_cnt;
     font->size = size;
     font->response_height = 0;
+    font->response_identity = 0;
     memcpy(font->family, family, len);
     font->family[len] = 0;
     ctx->renderer((zcmd_any*)font, ctx->user_data);
+    _zui_record(&(zccmd_font) { { ZRCMD_REG_FONT, sizeof(zccmd_font) }, font->font_id, font->response_height, font->response_identity });
     if(!font->response_height) {
         zui_log("Failed to create font %s\n", family);
         return 0;
     }
-    zmap_set(&ctx->glyphs, _zgc_hash(ctx->font_cnt, 0x1FFFFF), font->response_height);
+    bool pending = font->response_height == ZFONT_PENDING;
+    u16 height = pending ? size + size / 4 : font->response_height;
+    _zgc_set_height(ctx->font_cnt, height);
+    zui_font_info *info = zbuf_alloc(&ctx->fonts, sizeof(zui_font_info));
+    *info = (zui_font_info) { { _zgc_family(family), size, height, pending ? 0 : font->response_identity }, pending };
+    _zgc_resolve(&info->cache);
     return ctx->font_cnt++;
 }
 
+bool zui_font_ready(u16 font_id) {
+    return font_id < ctx->font_cnt && !_zui_font_info(font_id)->pending;
+}
+
+// the metrics of a font arrived, for one loaded in the background or to replace an estimate
+ZUI_PRIVATE void _zui_font_metrics(zccmd_font *cmd) {
+    if(cmd->font_id >= ctx->font_cnt) {
+        if(cmd->height) _zgc_set_height(cmd->font_id, cmd->height);
+        return;
+    }
+    zui_font_info *font = _zui_font_info(cmd->font_id);
+    font->pending = false;
+    if(!cmd->height) { // keeps the estimates
+        zui_log("Failed to load font %u\n", cmd->font_id);
+        return;
+    }
+    _zgc_set_height(cmd->font_id, cmd->height);
+    font->cache.height = cmd->height;
+    font->cache.identity = cmd->identity;
+    _zgc_resolve(&font->cache);
+}
+
 // set zui font
 void zui_font(u16 font_id) {
     ctx->font_id = font_id;
@@ -822,6 +1286,43 @@ zvec2  zui_stylev(u16 widget_id, u16 style_id) { zvec2  ret; _zui_get_style(widg
 float  zui_stylef(u16 widget_id, u16 style_id) { float  ret; _zui_get_style(widget_id, style_id, &ret); return ret; }
 i32    zui_stylei(u16 widget_id, u16 style_id) { i32    ret; _zui_get_style(widget_id, style_id, &ret); return ret; }
 
+ZUI_PRIVATE void _zui_buf_stats(zui_buf *buf, zui_buf_stats *stats) {
+    stats->used = buf->used;
+    stats->high_water = buf->high_water;
+    stats->capacity = buf->data ? 1 << buf->cap : 0;
+    stats->reallocs = buf->reallocs;
+}
+
+ZUI_PRIVATE void _zui_fill_stats(i64 szx, i64 szy, i64 pos, i64 draw, i64 sort, i64 submit) {
+    zui_stats *s = &ctx->stats;
+    s->frame++;
+    s->ns[ZP_TEXT] = ctx->text_ns;
+    s->ns[ZP_SIZE_X] = szx;
+    s->ns[ZP_SIZE_Y] = szy;
+    s->ns[ZP_POS] = pos;
+    s->ns[ZP_DRAW] = draw;
+    s->ns[ZP_SORT] = sort;
+    s->ns[ZP_SUBMIT] = submit;
+    s->widgets = ctx->widget_cnt;
+    s->glyph_queries = ctx->glyph_queries;
+    s->glyph_file_hits = ctx->glyph_file_hits;
+    s->glyph_evictions = ctx->glyph_evictions;
+    s->cmds = ctx->zdeque.used / sizeof(u64);
+    s->cmd_bytes = ctx->draw.used;
+    _zui_buf_stats(&ctx->ui, &s->bufs[ZB_UI]);
+    _zui_buf_stats(&ctx->registry, &s->bufs[ZB_REGISTRY]);
+    _zui_buf_stats(&ctx->cont_stack, &s->bufs[ZB_CONT_STACK]);
+    _zui_buf_stats(&ctx->draw, &s->bufs[ZB_DRAW]);
+    _zui_buf_stats(&ctx->zdeque, &s->bufs[ZB_ZDEQUE]);
+    _zui_buf_stats(&ctx->text, &s->bufs[ZB_TEXT]);
+    _zui_buf_stats(&ctx->json, &s->bufs[ZB_JSON]);
+    // style entries are never removed, so the probe lengths only change when something was added
+    if (s->glyphs.used != ctx->glyphs.used || s->glyphs.capacity != ctx->glyphs.cap || s->glyph_evictions)
+        _zmap_stats(&ctx->glyphs, &s->glyphs);
+    if (s->style.used != ctx->style.used || s->style.capacity != ctx->style.cap)
+        _zmap_stats(&ctx->style, &s->style);
+}
+
 void zui_render() {
     if (ctx->cont_stack.used != 0) {
         zui_log("incorrect # of zui_end calls\n");
@@ -829,56 +1330,83 @@ void zui_render() {
     }
     if(ctx->window_sz.x == 0 || ctx->window_sz.y == 0) return;
 
-    i64 tmp = 0;
-    ctx->diagnostics = &tmp;
-
     // calculate sizes
     zw_base *root = _ui_widget(0);
     root->next = 0;
-    i64 szx_time = zui_ts();
+    i64 szx_time = _zui_clock();
+    ZT_PHASE('B', "size x", szx_time);
     //zui_log("%d,%d\n", ctx->window_sz.x, ctx->window_sz.y) ;
 
     _ui_sz(root, 0, ctx->window_sz.x);
-    szx_time = zui_ts() - szx_time;
-    i64 szy_time = zui_ts();
+    szx_time = _zui_clock() - szx_time;
+    ZT_PHASE('E', "size x", _zui_clock());
+    i64 szy_time = _zui_clock();
+    ZT_PHASE('B', "size y", szy_time);
     _ui_sz(root, 1, ctx->window_sz.y);
-    szy_time = zui_ts() - szy_time;
+    szy_time = _zui_clock() - szy_time;
+    ZT_PHASE('E', "size y", _zui_clock());
 
     // calculate positions
     ctx->hovered = 0;
     root->bounds.x = 0;
     root->bounds.y = 0;
-    i64 pos_time = zui_ts();
+    i64 pos_time = _zui_clock();
+    ZT_PHASE('B', "pos", pos_time);
     _ui_pos(root, (zvec2) { 0, 0 }, 0);
-    pos_time = zui_ts() - pos_time;
+    pos_time = _zui_clock() - pos_time;
+    ZT_PHASE('E', "pos", _zui_clock());
     if (ctx->__focused) {
         ctx->focused = ctx->__focused;
         ctx->__focused = 0;
     }
 
     // generate draw commands
-    i64 draw_time = zui_ts();
+    i64 draw_time = _zui_clock();
+    ZT_PHASE('B', "draw", draw_time);
     ctx->clip_rect = root->used;
     _ui_draw(root);
-    draw_time = zui_ts() - draw_time;
+    draw_time = _zui_clock() - draw_time;
+    ZT_PHASE('E', "draw", _zui_clock());
 
     // sort draw commands by zindex / index (order of creation)
     // despite qsort not being a stable sort, the order of draw cmd creation is preserved due to index being part of each u64
+    i64 sort_time = _zui_clock();
+    ZT_PHASE('B', "sort", sort_time);
     u64 *deque_reader = (u64*)ctx->zdeque.data;
     _zui_qsort(deque_reader, ctx->zdeque.used / sizeof(u64));
-    i64 render_time = zui_ts();
+    sort_time = _zui_clock() - sort_time;
+    ZT_PHASE('E', "sort", _zui_clock());
+    i64 render_time = _zui_clock();
+    ZT_PHASE('B', "submit", render_time);
     zcmd_any begin = { .base = { ZCMD_RENDER_BEGIN, sizeof(zcmd) } };
     ctx->renderer(&begin, ctx->user_data);
-    i32 i = 0;
+    bool hash = ctx->record_file && ctx->record_flags & ZREC_OUTPUT;
+    zrcmd_frame frame = { { ZRCMD_FRAME, sizeof(zrcmd_frame) }, ctx->record_frames, hash ? 0xCBF29CE484222325ULL : 0 };
     while(deque_reader < (u64*)(ctx->zdeque.data + ctx->zdeque.used)) {
         u64 next_pair = *deque_reader++;
         i32 index = next_pair & 0x7FFFFFFF;
         zcmd_any *next = (zcmd_any*)(ctx->draw.data + index);
         ctx->renderer(next, ctx->user_data);
+        if(hash) // FNV-1a, same as the headless backend
+            for(i32 i = 0; i < next->base.bytes; i++)
+                frame.hash = (frame.hash ^ ((u8*)next)[i]) * 0x100000001B3ULL;
     }
     zcmd_any end = { .base = { ZCMD_RENDER_END, sizeof(zcmd) } };
     ctx->renderer(&end, ctx->user_data);
-    render_time = zui_ts() - render_time;
+    render_time = _zui_clock() - render_time;
+    ZT_PHASE('E', "submit", _zui_clock());
+
+    _zui_fill_stats(szx_time, szy_time, pos_time, draw_time, sort_time, render_time);
+    if(ctx->record_file) {
+        frame.widgets = ctx->stats.widgets;
+        frame.cmds = ctx->stats.cmds;
+        frame.cmd_bytes = ctx->stats.cmd_bytes;
+        memcpy(frame.ns, ctx->stats.ns, sizeof(frame.ns));
+        _zui_record(&frame);
+        fwrite(ctx->record.data, 1, ctx->record.used, ctx->record_file);
+        ctx->record.used = 0;
+        ctx->record_frames++;
+    }
 
     ctx->prev_mouse_pos = ctx->mouse_pos;
     ctx->prev_mouse_state = ctx->mouse_state;
@@ -887,34 +1415,189 @@ void zui_render() {
     ctx->zdeque.used = 0;
     ctx->draw.used = 0;
     ctx->ui.used = 0;
+    ctx->widget_cnt = 0;
+    ctx->text_ns = 0;
+    ctx->glyph_queries = 0;
+    ctx->glyph_file_hits = 0;
+    ctx->glyph_evictions = 0;
 
     // zui_log("DIAGNOSTICS\n");
-    // zui_log("txt sz: %.2fms\n", ctx->diagnostics[0] / 1000000.0);
+    // zui_log("txt sz: %.2fms\n", ctx->stats.ns[ZP_TEXT] / 1000000.0);
     // zui_log("size:   %.2fms | %.2f + %.2f\n", (szx_time + szy_time) / 1000000.0, szx_time / 1000000.0, szy_time / 1000000.0);
     // zui_log("pos:    %.2fms\n", pos_time / 1000000.0);
     // zui_log("draw:   %.2fms\n", draw_time / 1000000.0);
     // zui_log("render: %.2fms\n", render_time / 1000000.0);
 }
 
-// void zui_push(zccmd *cmd) {
-//     switch (cmd->base.id) {
-//     case ZCCMD_MOUSE:
-//         ctx->mouse_pos = cmd->mouse.pos;
-//         ctx->mouse_state = cmd->mouse.state;
-//         break;
-//     case ZCCMD_KEYS: {
-//         i32 len = _utf8_len(cmd->keys.key);
-//         char *utf8 = (char*)_buf_alloc(&ctx->text, len);
-//         _utf8_print(utf8, cmd->keys.key, len);
-//     } break;
-//     case ZCCMD_GLYPH:
-//         _zmap_set(&ctx->glyphs, _zgc_hash(cmd->glyph.c.font_id, cmd->glyph.c.c), cmd->glyph.c.width);
-//         break;
-//     case ZCCMD_WIN:
-//         ctx->window_sz = cmd->win.sz;
-//         break;
-//     }
-// }
+// Applies input or metrics that arrived outside of a renderer callback.
+// Glyph and font metrics overwrite whatever was cached, so a backend can answer
+// ZCMD_GLYPH_SZ / ZCMD_REG_FONT with an estimate and correct it later.
+void zui_push(zccmd *cmd) {
+    switch (cmd->base.id) {
+    case ZCCMD_MOUSE:
+        ctx->mouse_pos = cmd->mouse.pos;
+        ctx->mouse_state = cmd->mouse.state;
+        break;
+    case ZCCMD_SCROLL:
+        ctx->mouse_scroll += cmd->scroll.delta;
+        break;
+    case ZCCMD_KEYS:
+        ctx->keyboard_modifiers = cmd->keys.modifiers;
+        if(cmd->keys.key) _zui_key_char(cmd->keys.key);
+        break;
+    case ZCCMD_GLYPH:
+        _zgc_set(cmd->glyph.font_id, _zgc_hash(cmd->glyph.font_id, cmd->glyph.codepoint), cmd->glyph.sz.x);
+        _zgc_log(cmd->glyph.font_id, cmd->glyph.codepoint);
+        break;
+    case ZCCMD_FONT:
+        _zui_font_metrics(&cmd->font);
+        break;
+    case ZCCMD_WIN:
+        ctx->window_sz = cmd->win.sz;
+        break;
+    case ZRCMD_GLYPHS: {
+        zrcmd_glyphs *glyphs = (zrcmd_glyphs*)cmd;
+        for(u32 i = 0; i < glyphs->cnt; i++) {
+            u32 key = (u32)glyphs->entries[i], v = glyphs->entries[i] >> 32;
+            if(v & ZGC_PINNED) zmap_set(&ctx->glyphs, key, v);
+            else _zgc_set(v >> 16 & 0x3FFF, key, v);
+        }
+    } return;
+    default: return;
+    }
+    _zui_record(cmd);
+}
+
+bool zui_record_start(char *path, u32 flags) {
+    zui_record_stop();
+    FILE *f = fopen(path, "wb");
+    if(!f) {
+        zui_log("couldn't open %s for recording\n", path);
+        return false;
+    }
+    zrec_header header = {
+        .magic = ZREC_MAGIC,
+        .version = ZREC_VERSION,
+        .flags = flags,
+        .font_cnt = ctx->font_cnt,
+        .mouse_state = ctx->mouse_state,
+        .window_sz = ctx->window_sz,
+        .mouse_pos = ctx->mouse_pos,
+        .keyboard_modifiers = ctx->keyboard_modifiers
+    };
+    fwrite(&header, sizeof(header), 1, f);
+    // the glyph cache is stored as is, split into records that fit a u16 size
+    u32 cnt = 0, per_record = (0xFFF8 - sizeof(zrcmd_glyphs)) / sizeof(u64);
+    for(u32 i = 0; i < ctx->glyphs.cap; i++) {
+        if(!(u32)ctx->glyphs.data[i]) continue;
+        if(cnt++ % per_record == 0) {
+            u32 n = min(per_record, ctx->glyphs.used - cnt + 1);
+            zrcmd_glyphs glyphs = { { ZRCMD_GLYPHS, (u16)(sizeof(zrcmd_glyphs) + n * sizeof(u64)) }, n };
+            fwrite(&glyphs, sizeof(glyphs), 1, f);
+        }
+        fwrite(&ctx->glyphs.data[i], sizeof(u64), 1, f);
+    }
+    ctx->record_file = f;
+    ctx->record_flags = flags;
+    ctx->record_frames = 0;
+    return true;
+}
+
+void zui_record_stop() {
+    if(!ctx->record_file) return;
+    fwrite(ctx->record.data, 1, ctx->record.used, ctx->record_file);
+    ctx->record.used = 0;
+    fseek(ctx->record_file, offsetof(zrec_header, frames), SEEK_SET);
+    fwrite(&ctx->record_frames, sizeof(u32), 1, ctx->record_file);
+    fclose(ctx->record_file);
+    ctx->record_file = 0;
+}
+
+bool zui_glyph_cache_open(char *path) {
+    _zgc_unmap();
+    ctx->gc_enabled = true;
+    bool mapped = _zgc_map(path);
+    for(i32 i = 0; i < ctx->font_cnt; i++)
+        _zgc_resolve(&_zui_font_info(i)->cache);
+    return mapped;
+}
+
+ZUI_PRIVATE i32 _zgc_cmp(const void *a, const void *b) {
+    u32 x = *(u32*)a, y = *(u32*)b;
+    return x < y ? -1 : x > y;
+}
+
+bool zui_glyph_cache_save(char *path) {
+    // the log sorted is every glyph measured, grouped by font and ordered by codepoint
+    u32 *log = (u32*)ctx->glyph_log.data, log_cnt = ctx->glyph_log.used / sizeof(u32);
+    qsort(log, log_cnt, sizeof(u32), _zgc_cmp);
+    u32 file_fonts = ctx->gc_file ? ((zgc_header*)ctx->gc_file)->font_cnt : 0;
+    u32 file_glyphs = ctx->gc_file ? ((zgc_header*)ctx->gc_file)->glyph_cnt : 0;
+    zgc_font *fonts = ZUI_MALLOC((ctx->font_cnt + file_fonts) * sizeof(zgc_font) + 1);
+    u64 *glyphs = ZUI_MALLOC(((u64)file_glyphs + log_cnt) * sizeof(u64) + 1);
+    u32 font_cnt = 0, glyph_cnt = 0, l = 0;
+    // registered fonts: the file's glyphs merged with the measured ones, at their current width
+    for(u16 id = 0; id < ctx->font_cnt; id++) {
+        zgc_font *font = &_zui_font_info(id)->cache;
+        u32 begin = l;
+        while(l < log_cnt && log[l] >> 21 == id) l++;
+        bool seen = false;
+        for(u32 i = 0; i < font_cnt && !seen; i++)
+            seen = fonts[i].family == font->family && fonts[i].size == font->size && fonts[i].identity == font->identity;
+        if(!font->identity || seen) continue;
+        u64 *saved = font->first != ~0u ? _zgc_file_glyphs() + font->first : 0;
+        u32 saved_cnt = saved ? font->cnt : 0, first = glyph_cnt;
+        for(u32 s = 0, m = begin; s < saved_cnt || m < l;) {
+            u32 cp = s < saved_cnt ? (u32)(saved[s] >> 32) : ~0u, measured = m < l ? log[m] & 0x1FFFFF : ~0u, width = ~0u, v;
+            if(measured <= cp) {
+                cp = measured;
+                while(m < l && (log[m] & 0x1FFFFF) == cp) m++;
+            }
+            if(s < saved_cnt && (u32)(saved[s] >> 32) == cp) width = (u32)saved[s++];
+            if(zmap_get(&ctx->glyphs, _zgc_hash(id, cp), &v)) width = v & ZGC_WIDTH;
+            // measured, but evicted since
+            if(width != ~0u) glyphs[glyph_cnt++] = ((u64)cp << 32) | width;
+        }
+        fonts[font_cnt] = *font;
+        fonts[font_cnt].first = first;
+        fonts[font_cnt++].cnt = glyph_cnt - first;
+    }
+    // fonts of the file this run didn't register are kept as they were, other faces of the registered ones dropped
+    for(u32 f = 0; f < file_fonts; f++) {
+        zgc_font *font = _zgc_file_fonts() + f;
+        bool seen = false;
+        for(u32 i = 0; i < font_cnt && !seen; i++)
+            seen = fonts[i].family == font->family && fonts[i].size == font->size;
+        if(seen) continue;
+        memcpy(glyphs + glyph_cnt, _zgc_file_glyphs() + font->first, font->cnt * sizeof(u64));
+        fonts[font_cnt] = *font;
+        fonts[font_cnt++].first = glyph_cnt;
+        glyph_cnt += font->cnt;
+    }
+    zgc_header header = {
+        .magic = ZGC_MAGIC,
+        .version = ZGC_VERSION,
+        .font_cnt = font_cnt,
+        .bytes = sizeof(zgc_header) + font_cnt * sizeof(zgc_font) + glyph_cnt * sizeof(u64),
+        .glyph_cnt = glyph_cnt
+    };
+    // the file may be the one mapped, which can't be truncated while it is
+    _zgc_unmap();
+    FILE *f = fopen(path, "wb");
+    bool ok = f
+        && fwrite(&header, sizeof(header), 1, f) == 1
+        && fwrite(fonts, sizeof(zgc_font), font_cnt, f) == font_cnt
+        && fwrite(glyphs, sizeof(u64), glyph_cnt, f) == glyph_cnt;
+    if(f && fclose(f)) ok = false;
+    ZUI_FREE(fonts);
+    ZUI_FREE(glyphs);
+    if(ok)
+        ctx->glyph_log.used = 0; // everything measured is in the file now
+    else
+        zui_log("couldn't write the glyph cache %s\n", path);
+    zui_glyph_cache_open(path);
+    return ok;
+}
 
 void zui_blank() {
     _ui_alloc(ZW_BLANK, sizeof(zw_base));
@@ -978,6 +1661,7 @@ ZUI_PRIVATE void _zui_popup_draw(zw_popup *p) {
 
 void zui_window() {
     ctx->ui.used = 0;
+    ctx->widget_cnt = 0;
     ctx->next_flags = 0;
     _cont_alloc(ZW_WINDOW, sizeof(zw_box));
 }
@@ -1045,14 +1729,14 @@ ZUI_PRIVATE i32 _append_f64(char *s, i32 n, double v, i32 leading, i32 precision
 }
 
 void zui_labelf(const char *fmt, ...) {
-    zw_labelf *l = _ui_alloc(ZW_LABELF, sizeof(zw_labelf));
     va_list args;
     va_start(args, fmt);
-    i32 n = 0;
-    vsnprintf(tmp, 256, fmt, args);
-    for(i32 i = 0; i < 256 && tmp[i]; i++)
-        _append(l->text, n++, tmp[i]);
-    _append(l->text, n, 0);
+    i32 n = vsnprintf(tmp, 256, fmt, args);
+    n = n < 0 ? 0 : min(n, 255);
+    // allocate the whole text up front, growing it in place can realloc the ui buffer out from under <l>
+    zw_labelf *l = _ui_alloc(ZW_LABELF, sizeof(zw_labelf) + n + 1);
+    memcpy(l->text, tmp, n + 1);
+    l->widget.bytes -= 1; // the terminator isn't part of the text
     // for(; *fmt; fmt++) {
     //     if(*fmt != '%') {
     //         _append(l->text, n++, *fmt);
@@ -1074,7 +1758,6 @@ void zui_labelf(const char *fmt, ...) {
     //         case '%': _append(l->text, n++, '%'); break;
     //     }
     // }
-    l->widget.bytes += n;
     va_end(args);
 }
 
@@ -1088,6 +1771,142 @@ ZUI_PRIVATE void _zui_labelf_draw(zw_labelf *data) {
     _push_text_cmd(ctx->font_id, data->widget.used.pos, zui_stylec(ZW_LABEL, ZSC_FOREGROUND), data->text, len, data->widget.zindex);
 }
 
+// LAZY LABELF
+// Arguments are captured into 8 byte slots when the label is created, and formatted later by replaying
+// the format string one conversion at a time. Integer conversions are widened to long long so every
+// slot can be printed the same way regardless of its original length modifier.
+typedef union zfmt_arg { i64 i; f64 f; void *p; } zfmt_arg;
+
+enum { ZFMT_NONE, ZFMT_INT, ZFMT_UINT, ZFMT_CHAR, ZFMT_DOUBLE, ZFMT_PTR, ZFMT_STORE };
+
+// parses the conversion spec starting at <fmt> (which points at '%')
+// returns the length of the spec, and writes the conversion class, length modifier and '*' count
+// a spec with more than two '*' is malformed: it keeps its class so its arguments are still captured, but it prints nothing
+ZUI_PRIVATE i32 _zfmt_spec(const char *fmt, i32 *cls, char *lmod, i32 *stars) {
+    i32 i = 1;
+    *stars = 0;
+    *lmod = 0;
+    while(fmt[i] && strchr("-+ #0", fmt[i])) i++;
+    for(; fmt[i] == '*' || (fmt[i] >= '0' && fmt[i] <= '9') || fmt[i] == '.'; i++)
+        if(fmt[i] == '*') (*stars)++;
+    for(; fmt[i] && strchr("hljztLq", fmt[i]); i++) // 'H' = hh, 'Q' = ll
+        *lmod = (*lmod != fmt[i]) ? fmt[i] : (fmt[i] == 'h' ? 'H' : 'Q');
+    switch(fmt[i]) {
+        case 'd': case 'i': *cls = ZFMT_INT; break;
+        case 'u': case 'o': case 'x': case 'X': *cls = ZFMT_UINT; break;
+        case 'c': *cls = ZFMT_CHAR; break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A': *cls = ZFMT_DOUBLE; break;
+        case 's': case 'p': *cls = ZFMT_PTR; break;
+        case 'n': *cls = ZFMT_STORE; break;
+        case 0: *cls = ZFMT_NONE; return i;
+        default: *cls = ZFMT_NONE; break; // '%%' or unknown
+    }
+    return i + 1;
+}
+
+ZUI_PRIVATE i64 _zfmt_capture_int(va_list *args, char lmod, bool is_signed) {
+    switch(lmod) {
+        case 'H': return is_signed ? (i64)(signed char)va_arg(*args, int) : (i64)(u8)va_arg(*args, int);
+        case 'h': return is_signed ? (i64)(short)va_arg(*args, int) : (i64)(u16)va_arg(*args, int);
+        case 'l': return is_signed ? (i64)va_arg(*args, long) : (i64)va_arg(*args, unsigned long);
+        case 'z': return (i64)va_arg(*args, size_t);
+        case 't': return (i64)va_arg(*args, ptrdiff_t);
+        case 'Q': case 'q': case 'j': return va_arg(*args, long long);
+        default: return is_signed ? (i64)va_arg(*args, int) : (i64)va_arg(*args, unsigned int);
+    }
+}
+
+void zui_labelf_lazy(i16 fixed_width, const char *fmt, ...) {
+    i32 cls, stars, argc = 0;
+    char lmod;
+    for(const char *f = fmt; (f = strchr(f, '%')); ) {
+        f += _zfmt_spec(f, &cls, &lmod, &stars);
+        argc += stars + (cls != ZFMT_NONE);
+    }
+    zw_labelf_lazy *l = _ui_alloc(ZW_LABELF_LAZY, sizeof(zw_labelf_lazy) + argc * sizeof(zfmt_arg));
+    zfmt_arg *slot = (zfmt_arg*)l->args;
+    l->fmt = fmt;
+    l->fixed_width = fixed_width;
+    l->argc = argc;
+    va_list args;
+    va_start(args, fmt);
+    for(const char *f = fmt; (f = strchr(f, '%')); ) {
+        f += _zfmt_spec(f, &cls, &lmod, &stars);
+        for(i32 i = 0; i < stars; i++)
+            (slot++)->i = va_arg(args, int);
+        switch(cls) {
+            case ZFMT_INT:    (slot++)->i = _zfmt_capture_int(&args, lmod, true); break;
+            case ZFMT_UINT:   (slot++)->i = _zfmt_capture_int(&args, lmod, false); break;
+            case ZFMT_CHAR:   (slot++)->i = va_arg(args, int); break;
+            case ZFMT_DOUBLE: (slot++)->f = lmod == 'L' ? (f64)va_arg(args, long double) : va_arg(args, double); break;
+            case ZFMT_PTR:
+            case ZFMT_STORE:  (slot++)->p = va_arg(args, void*); break;
+        }
+    }
+    va_end(args);
+}
+
+// formats a lazy label into <out>, returns the length of the resulting string
+ZUI_PRIVATE i32 _zui_labelf_lazy_format(zw_labelf_lazy *data, char *out, i32 cap) {
+    zfmt_arg *slot = (zfmt_arg*)data->args;
+    const char *f = data->fmt;
+    char spec[32];
+    i32 n = 0;
+    while(*f && n < cap - 1) {
+        if(*f != '%') { out[n++] = *f++; continue; }
+        i32 cls, stars;
+        char lmod;
+        i32 len = _zfmt_spec(f, &cls, &lmod, &stars);
+        if(cls == ZFMT_NONE || stars > 2) { // '%%' prints a percent, unknown conversions and malformed specs print nothing
+            if(cls == ZFMT_NONE && f[len - 1] == '%') out[n++] = '%';
+            slot += stars + (cls != ZFMT_NONE);
+            f += len;
+            continue;
+        }
+        // rebuild the spec without its length modifier, integers are printed as long long
+        i32 s = 0;
+        for(i32 i = 0; i < len - 1 && s < (i32)sizeof(spec) - 4; i++)
+            if(!strchr("hljztLq", f[i])) spec[s++] = f[i];
+        if(cls == ZFMT_INT || cls == ZFMT_UINT) { spec[s++] = 'l'; spec[s++] = 'l'; }
+        spec[s++] = f[len - 1];
+        spec[s] = 0;
+        f += len;
+        i32 w[2] = { 0, 0 };
+        for(i32 i = 0; i < stars; i++) w[i] = (i32)(slot++)->i;
+        zfmt_arg v = *slot++;
+        char *dst = out + n;
+        i32 left = cap - n, r = 0;
+        #define ZFMT_PRINT(val) \
+            r = stars == 0 ? snprintf(dst, left, spec, val) : \
+                stars == 1 ? snprintf(dst, left, spec, w[0], val) : \
+                             snprintf(dst, left, spec, w[0], w[1], val)
+        switch(cls) {
+            case ZFMT_INT:    ZFMT_PRINT((long long)v.i); break;
+            case ZFMT_UINT:   ZFMT_PRINT((unsigned long long)v.i); break;
+            case ZFMT_CHAR:   ZFMT_PRINT((int)v.i); break;
+            case ZFMT_DOUBLE: ZFMT_PRINT(v.f); break;
+            case ZFMT_PTR:    ZFMT_PRINT(v.p); break;
+            case ZFMT_STORE:  break; // %n is not supported
+        }
+        #undef ZFMT_PRINT
+        n += r < 0 ? 0 : min(r, left - 1);
+    }
+    out[n] = 0;
+    return n;
+}
+
+ZUI_PRIVATE i16 _zui_labelf_lazy_size(zw_labelf_lazy *data, bool axis, i16 bound) {
+    if(axis) return zui_text_height(ctx->font_id);
+    if(data->fixed_width != Z_AUTO) return data->fixed_width;
+    i32 len = _zui_labelf_lazy_format(data, tmp, sizeof(tmp));
+    return zui_text_width(ctx->font_id, tmp, len);
+}
+
+ZUI_PRIVATE void _zui_labelf_lazy_draw(zw_labelf_lazy *data) {
+    i32 len = _zui_labelf_lazy_format(data, tmp, sizeof(tmp));
+    _push_text_cmd(ctx->font_id, data->widget.used.pos, zui_stylec(ZW_LABEL, ZSC_FOREGROUND), tmp, len, data->widget.zindex);
+}
+
 void zui_labeln(char *text, i32 len) {
     zw_label *l = _ui_alloc(ZW_LABEL, sizeof(zw_label));
     l->text = text;
@@ -1691,7 +2510,8 @@ void zui_grid(i32 cols, i32 rows, ...) {
 }
 ZUI_PRIVATE i16 _zui_grid_size(zw_grid *grid, bool axis, i16 bound) {
     zvec2 spacing = zui_stylev(grid->cont.id, ZSV_SPACING);
-    i16 i = 0, cnt = axis ? grid->rows : grid->cols;
+    i32 i = 0; // child counter, grids can hold more than 32k cells
+    i16 cnt = axis ? grid->rows : grid->cols;
     i16 sz = spacing.e[axis] * (cnt - 1);
     i16 real_sizes[cnt];
     i16 *cfg_sizes = grid->data + (axis ? grid->cols : 0);
@@ -1911,6 +2731,12 @@ void zui_init(zui_render_fn fn, zui_log_fn logger, void *user_data) {
     zbuf_init(&global_ctx.cont_stack, 256, sizeof(i32));
     zbuf_init(&global_ctx.zdeque, 256, sizeof(u64));
     zbuf_init(&global_ctx.text, 256, sizeof(char));
+    zbuf_init(&global_ctx.record, 256, 8);
+    zbuf_init(&global_ctx.fonts, 256, sizeof(u32));
+    zbuf_init(&global_ctx.glyph_log, 256, sizeof(u32));
+#ifdef ZUI_TRACE
+    zbuf_init(&global_ctx.json, 4096, sizeof(char));
+#endif
     zmap_init(&global_ctx.glyphs);
     zmap_init(&global_ctx.style);
     global_ctx.padding = (zvec2) { 15, 15 };
@@ -1988,6 +2814,7 @@ void zui_init(zui_render_fn fn, zui_log_fn logger, void *user_data) {
         ZS_DONE);
 
     zui_register(ZW_SURROGATE, "surrogate", _zui_surrogate_size, 0, _zui_surrogate_draw);
+    zui_register(ZW_LABELF_LAZY, "labelf lazy", _zui_labelf_lazy_size, 0, _zui_labelf_lazy_draw);
 
     ctx->next_wid = ZW_LAST;
     ctx->next_sid = ZS_LAST;
@@ -1997,13 +2824,23 @@ void zui_init(zui_render_fn fn, zui_log_fn logger, void *user_data) {
 }
 
 void zui_close() {
-    free(ctx->draw.data);
-    free(ctx->ui.data);
-    free(ctx->registry.data);
-    free(ctx->cont_stack.data);
-    free(ctx->zdeque.data);
-    free(ctx->text.data);
-    free(ctx->glyphs.data);
-    free(ctx->style.data);
+    zui_record_stop();
+    _zgc_unmap();
+    ctx->gc_enabled = false;
+    ctx->font_cnt = 0;
+    ctx->glyph_cnt = ctx->glyph_hand = ctx->glyph_limit = 0;
+    ctx->unknown_font = (zui_font_stats) { 0 };
+    ZUI_FREE(ctx->record.data);
+    ZUI_FREE(ctx->fonts.data);
+    ZUI_FREE(ctx->glyph_log.data);
+    ZUI_FREE(ctx->draw.data);
+    ZUI_FREE(ctx->ui.data);
+    ZUI_FREE(ctx->registry.data);
+    ZUI_FREE(ctx->cont_stack.data);
+    ZUI_FREE(ctx->zdeque.data);
+    ZUI_FREE(ctx->text.data);
+    ZUI_FREE(ctx->json.data);
+    ZUI_FREE(ctx->glyphs.data);
+    ZUI_FREE(ctx->style.data);
     ctx = 0;
 }
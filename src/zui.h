@@ -5,7 +5,7 @@
 #define TYPES_INCLUDED
 typedef unsigned char u8;
 typedef unsigned short u16;
-typedef unsigned long u32;
+typedef unsigned int u32;
 typedef unsigned long long u64;
 
 typedef char i8;
@@ -91,6 +91,30 @@ enum ZUI_STYLEABLE {
     ZS_LAST,
 };
 
+// phases of zui_render, indices into zui_stats.ns
+enum ZUI_PHASES {
+    ZP_TEXT,   // measuring text (overlaps the size and draw phases)
+    ZP_SIZE_X,
+    ZP_SIZE_Y,
+    ZP_POS,
+    ZP_DRAW,
+    ZP_SORT,
+    ZP_SUBMIT, // handing the sorted commands to the renderer
+    ZP_LAST
+};
+
+// buffers owned by the context, indices into zui_stats.bufs
+enum ZUI_BUFFERS {
+    ZB_UI,
+    ZB_REGISTRY,
+    ZB_CONT_STACK,
+    ZB_DRAW,
+    ZB_ZDEQUE,
+    ZB_TEXT,
+    ZB_JSON,
+    ZB_LAST
+};
+
 enum ZUI_FLAGS {
     ZJ_CENTER = 0, // justification flags
     ZJ_LEFT =   1 << 0,
@@ -147,7 +171,10 @@ typedef struct zcmd_text { zcmd header; zvec2 pos;  zcolor color; u16 font_id; c
 typedef struct zcmd_lines { zcmd header; zcolor color; i32 width; zvec2 points[0]; } zcmd_bezier, zcmd_lines; // draw bezier
 typedef struct zcmd_get_clipboard { zcmd header; char *response; } zcmd_get_clipboard;                    // get clipboard
 typedef struct zcmd_set_clipboard { zcmd header; char text[0]; } zcmd_set_clipboard;                      // set clipboard
-typedef struct zcmd_reg_font { zcmd header; u16 font_id; u16 size; u16 response_height; char family[0]; } zcmd_reg_font; // register font
+typedef struct zcmd_reg_font { zcmd header; u16 font_id; u16 size; u16 response_height; u32 response_identity; char family[0]; } zcmd_reg_font; // register font. identity: of the face loaded, 0 if unknown
+// response_height of a font the backend loads in the background. It's laid out with estimated metrics until the
+// backend pushes its ZCCMD_FONT
+#define ZFONT_PENDING 0xFFFF
 typedef struct zcmd_glyph_sz { zcmd header; u16 font_id; i32 codepoint; zvec2 response; } zcmd_glyph_sz; // get text size
 typedef struct zcmd_timestamp { zcmd header; u64 resp_ns; } zcmd_timestamp;
 typedef union {
@@ -177,20 +204,99 @@ typedef struct zimpl {
 
 void zui_launch(zimpl implementation, void *settings);
 
-typedef struct zccmd_mouse { zcmd header; zvec2 pos; u16 state; } zccmd_mouse;     // mouse movement / state
-typedef struct zccmd_keys { zcmd header; u32 key; u16 modifiers; } zccmd_keys;     // key presses
-//typedef struct zccmd_glyph { zcmd header; zglyph_data c; } zccmd_glyph;            // sent every time a new glyph needs to be displayed
-typedef struct zccmd_win { zcmd header; zvec2 sz; } zccmd_win;                     // new window size
-typedef struct zccmd_font { zcmd header; u32 status; } zccmd_stat;                 // response to server command
+// commands passed to zui_push, used by backends that receive input and metrics asynchronously (e.g. over a network)
+enum ZUI_CLIENT_CMDS {
+    ZCCMD_MOUSE,
+    ZCCMD_SCROLL,
+    ZCCMD_KEYS,
+    ZCCMD_WIN,
+    ZCCMD_GLYPH,
+    ZCCMD_FONT,
+    ZCCMD_CLIPBOARD, // handled by the backend, ignored by zui_push
+    ZCCMD_CLOSE,     // handled by the backend, ignored by zui_push
+};
+
+typedef struct zccmd_mouse { zcmd header; zvec2 pos; u16 state; } zccmd_mouse;                // mouse movement / state
+typedef struct zccmd_scroll { zcmd header; i32 delta; } zccmd_scroll;                         // mouse wheel
+typedef struct zccmd_keys { zcmd header; u32 key; u16 modifiers; } zccmd_keys;                // key press, key 0 only sets the modifiers
+typedef struct zccmd_glyph { zcmd header; u16 font_id; i32 codepoint; zvec2 sz; } zccmd_glyph; // glyph size, replaces the cached size
+typedef struct zccmd_win { zcmd header; zvec2 sz; } zccmd_win;                                // new window size
+typedef struct zccmd_font { zcmd header; u16 font_id; u16 height; u32 identity; } zccmd_font; // font height and identity, replaces the registered ones
+typedef struct zccmd_clipboard { zcmd header; char text[0]; } zccmd_clipboard;                // clipboard contents
 typedef union zccmd {
     zcmd        base;
     zccmd_mouse mouse;
+    zccmd_scroll scroll;
     zccmd_keys  keys;
-    //zccmd_glyph glyph;
+    zccmd_glyph glyph;
     zccmd_win   win;
-    zccmd_stat  status;
+    zccmd_font  font;
+    zccmd_clipboard clipboard;
 } zccmd;
 
+// Recordings (see zui_record_start) are a zrec_header followed by records padded to 8 bytes. Each record starts
+// with a zcmd: inputs are stored as the zccmd zui_push takes (ZCCMD_MOUSE, SCROLL, KEYS, WIN, GLYPH, FONT),
+// everything else as one of the records below. They're written in the order they happened, so a replay can feed
+// every input and renderer response back at the same point of the same frame.
+#define ZREC_MAGIC   0x4345525A // "ZREC"
+#define ZREC_VERSION 2
+enum ZUI_RECORD_FLAGS {
+    ZREC_OUTPUT = 1, // hash the draw commands of every frame
+};
+enum ZUI_RECORD_CMDS {
+    ZRCMD_GLYPHS = 0x100, // glyph cache entries when the recording started
+    ZRCMD_GLYPH_SZ,       // response to ZCMD_GLYPH_SZ, as a zccmd_glyph
+    ZRCMD_REG_FONT,       // response to ZCMD_REG_FONT, as a zccmd_font
+    ZRCMD_TIMESTAMP,      // response to ZCMD_TIMESTAMP
+    ZRCMD_FRAME,          // end of a zui_render
+};
+typedef struct zrec_header {
+    u32 magic;
+    u16 version;
+    u16 flags;
+    u32 frames;           // written when the recording stops
+    u16 font_cnt;         // fonts registered before the recording started
+    u16 mouse_state;      // input state when the recording started
+    zvec2 window_sz;
+    zvec2 mouse_pos;
+    u16 keyboard_modifiers;
+    u16 reserved[3];
+} zrec_header;
+typedef struct zrcmd_glyphs { zcmd header; u32 cnt; u64 entries[0]; } zrcmd_glyphs;  // raw glyph cache slots
+typedef struct zrcmd_timestamp { zcmd header; u32 reserved; u64 ns; } zrcmd_timestamp;
+typedef struct zrcmd_frame {
+    zcmd header;
+    u32 frame;
+    u64 hash;             // FNV-1a of the draw commands (as headless_frame_hash), 0 without ZREC_OUTPUT
+    i32 widgets;
+    i32 cmds;
+    i32 cmd_bytes;
+    i32 reserved;
+    i64 ns[ZP_LAST];      // phase timings of the frame
+} zrcmd_frame;
+
+// Glyph cache files (see zui_glyph_cache_open) are a zgc_header, a zgc_font per font, then the glyphs of every font
+// as u64 (codepoint << 32 | width) sorted by codepoint. Fonts are found by family and size rather than font id, and
+// only used while the backend answers ZCMD_REG_FONT with the same height and identity it did when they were saved.
+#define ZGC_MAGIC 0x3143475A // "ZGC1"
+#define ZGC_VERSION 1
+typedef struct zgc_header {
+    u32 magic;
+    u16 version;
+    u16 font_cnt;
+    u32 bytes;            // of the whole file
+    u32 glyph_cnt;
+} zgc_header;
+typedef struct zgc_font {
+    u32 family;           // FNV-1a of the family name
+    u16 size;
+    u16 height;
+    u32 identity;         // response_identity of ZCMD_REG_FONT, never 0
+    u32 first;            // index of the font's first glyph, ~0 for a registered font without any in the file
+    u32 cnt;
+    u32 reserved;
+} zgc_font;
+
 enum ZUI_WIDGETS {
     ZW_FIRST,
     ZW_BLANK = ZW_FIRST,
@@ -211,6 +317,7 @@ enum ZUI_WIDGETS {
     ZW_GRID,
     ZW_TABSET,
     ZW_SURROGATE,
+    ZW_LABELF_LAZY,
     ZW_LAST
 };
 
@@ -247,6 +354,7 @@ typedef struct zw_combo  { Z_CONT; zd_combo *state; i32 tooltip; extract_txt_fn
 
 typedef struct zw_label  { Z_WIDGET; char *text; i32 len; } zw_label;
 typedef struct zw_labelf { Z_WIDGET; char text[0]; } zw_labelf;
+typedef struct zw_labelf_lazy { Z_WIDGET; const char *fmt; i16 fixed_width; i16 argc; u64 args[0]; } zw_labelf_lazy;
 typedef struct zw_scroll { Z_CONT; bool xbar, ybar; zd_scroll *state; } zw_scroll;
 
 #ifdef ZUI_DEV
@@ -255,6 +363,14 @@ typedef struct zw_scroll { Z_CONT; bool xbar, ybar; zd_scroll *state; } zw_scrol
 #define FOR_N_SIBLINGS(ui, sibling, n) for(i32 i = 0; sibling && i < n; sibling = _ui_next(sibling), i++)
 #define SWAP(type, a, b) { type tmp = a; a = b; b = tmp; }
 
+// allocation hooks, define all four before including zui.h to route zui's memory elsewhere
+#ifndef ZUI_MALLOC
+#define ZUI_MALLOC(size) malloc(size)
+#define ZUI_CALLOC(cnt, size) calloc(cnt, size)
+#define ZUI_REALLOC(ptr, size) realloc(ptr, size)
+#define ZUI_FREE(ptr) free(ptr)
+#endif
+
 ZUI_API zw_base *_ui_widget(i32 index);
 ZUI_API i32 _ui_index(zw_base *ui);
 ZUI_API zw_base *_ui_next(zw_base *widget);
@@ -276,6 +392,9 @@ ZUI_API i32 _vec_distsq(zvec2 a, zvec2 b);
 ZUI_API bool _vec_within(zvec2 v, zrect bounds);
 ZUI_API bool _rect_within(zrect r, zrect bounds);
 ZUI_API bool _rect_intersect(zrect a, zrect b, zrect *intersect);
+// maps a file to read it, 0 if it can't or it's empty. <populate> faults it in at once where the OS allows it
+ZUI_API void *_zui_map_file(char *path, i64 *len, bool populate);
+ZUI_API void _zui_unmap_file(void *data, i64 len);
 ZUI_API void _rect_justify(zrect *used, zrect bounds, i32 justification);
 ZUI_API void _ui_schedule_focus(zw_base *widget);
 ZUI_API zw_base *_ui_find_with_flag(zw_base *start, u32 flags);
@@ -287,6 +406,8 @@ ZUI_API bool _ui_released(i32 buttons);
 ZUI_API void _ui_print(zw_base *cmd, int indent, bool expand_children);
 ZUI_API zvec2 _ui_mpos();
 ZUI_API zvec2 _ui_mdelta();
+ZUI_API i32 _ui_mscroll();
+ZUI_API u16 _ui_mods();
 ZUI_API i16 _ui_sz(zw_base *ui, bool axis, i16 bound);
 ZUI_API bool _ui_is_child(zw_base *container, zw_base *other);
 ZUI_API bool _ui_hovered(zw_base *ui);
@@ -313,6 +434,8 @@ typedef struct zui_buf {
     u16 cap;
     u16 alignsub1;
     u8 *data;
+    i32 high_water;
+    i32 reallocs;
 } zui_buf;
 ZUI_API void zbuf_resize(zui_buf *l);
 ZUI_API void zbuf_init(zui_buf *l, i32 cap, i32 alignment);
@@ -328,6 +451,7 @@ ZUI_API void zmap_init(zmap *map);
 ZUI_API u32  zmap_hash(u32 n);
 ZUI_API void zmap_set(zmap *map, u32 key, u32 value);
 ZUI_API bool zmap_get(zmap *map, u32 key, u32 *value);
+ZUI_API bool zmap_del(zmap *map, u32 key);
 #endif
 
 // CLIENT COMMANDS
@@ -356,11 +480,71 @@ ZUI_API void zui_key_char(i32 c);
 ZUI_API bool zui_key_pressed(i32 c);
 ZUI_API void zui_resize(u16 width, u16 height);
 
+// Statistics of the last zui_render
+typedef struct zui_buf_stats {
+    i32 used;       // bytes in use when the frame was submitted
+    i32 high_water; // most bytes ever in use
+    i32 capacity;
+    i32 reallocs;
+} zui_buf_stats;
+typedef struct zui_map_stats {
+    u32 used;
+    u32 capacity;
+    f32 load;      // used / capacity
+    f32 avg_probe; // average slots visited to find a stored key
+    u32 max_probe;
+} zui_map_stats;
+typedef struct zui_stats {
+    u64 frame;     // number of frames rendered
+    i64 ns[ZP_LAST];
+    i32 widgets;
+    i32 cmds;      // draw commands submitted
+    i32 cmd_bytes;
+    zui_buf_stats bufs[ZB_LAST];
+    zui_map_stats glyphs;
+    zui_map_stats style;
+    i32 glyph_queries;   // glyph sizes the renderer was asked for since the last frame
+    i32 glyph_file_hits; // glyph sizes found in the glyph cache file instead
+    i32 glyph_evictions; // glyph sizes dropped to stay under zui_glyph_cache_limit
+} zui_stats;
+// glyph cache use of one font, since it was registered
+typedef struct zui_font_stats {
+    u32 glyphs;    // glyph sizes cached now
+    u32 hits;
+    u32 misses;    // looked up in the glyph cache file or measured by the renderer
+    u32 evictions;
+} zui_font_stats;
+
 // SERVER COMMANDS
 ZUI_API void zui_init(zui_render_fn renderer, zui_log_fn logger, void *user_data);
 ZUI_API void zui_push(zccmd *cmd);
 ZUI_API void zui_render();
 ZUI_API i64 zui_ts();
+// returns the statistics of the last zui_render. Valid until the next zui_render
+ZUI_API zui_stats *zui_get_stats();
+// Records inputs, renderer responses and per-frame timings to <path> until zui_record_stop or zui_close.
+// With ZREC_OUTPUT each frame also stores a hash of its draw commands.
+// Start it after the fonts are registered and the replay can run the application's init unchanged.
+ZUI_API bool zui_record_start(char *path, u32 flags);
+ZUI_API void zui_record_stop();
+// Persistent glyph cache, to skip the renderer's glyph queries on start. Glyphs of the fonts registered with a known
+// identity are looked up in <path> (memory mapped) on a cache miss, and zui_glyph_cache_save writes the file back
+// with everything measured since. Open it before registering the fonts; false if there's no valid file yet.
+ZUI_API bool zui_glyph_cache_open(char *path);
+ZUI_API bool zui_glyph_cache_save(char *path);
+// Keeps at most <glyphs> glyph sizes in memory, evicting the least recently used ones (CLOCK). Font heights always
+// stay. 0, the default, never evicts
+ZUI_API void zui_glyph_cache_limit(u32 glyphs);
+// 0 if <font_id> isn't registered
+ZUI_API zui_font_stats *zui_get_font_stats(u16 font_id);
+#ifdef ZUI_TRACE
+// Tracing is compiled in with ZUI_TRACE. zui_render then records each phase, the size / pos / draw
+// span of every widget (named by widget type) and glyph cache misses as Chrome trace events.
+// returns the events recorded since the last zui_trace_clear as a JSON array, which
+// chrome://tracing and ui.perfetto.dev can open. Events accumulate until cleared.
+ZUI_API char *zui_trace(i32 *len);
+ZUI_API void zui_trace_clear();
+#endif
 
 ZUI_API void zui_print_tree();
 ZUI_API void zui_print_active();
@@ -383,7 +567,11 @@ ZUI_API i32    zui_stylei(u16 widget_id, u16 style_id);
 
 //void zui_size(i32 w, i32 h);
 ZUI_API u16  zui_new_font(char *family, i32 size);
-//zvec2 zui_text_sz(u16 id, char *text, i32 len);
+// false while the backend is still loading the font, its metrics are estimates until then
+ZUI_API bool zui_font_ready(u16 font_id);
+// width of <len> bytes of text (-1 for all of it) and line height, from the glyph cache
+ZUI_API i32  zui_text_width(u16 font_id, char *text, i32 len);
+ZUI_API i32  zui_text_height(u16 font_id);
 ZUI_API void zui_font(u16 id);
 
 ZUI_API void zui_end();
@@ -392,6 +580,11 @@ ZUI_API zvec2 zui_window_sz();
 ZUI_API void zui_label(const char *text);
 ZUI_API void zui_labeln(char *text, i32 len);
 ZUI_API void zui_labelf(const char *fmt, ...);
+// like zui_labelf, but only formats when the label is measured or drawn.
+// a <fixed_width> other than Z_AUTO is the label's width whatever it prints: it's never measured, so labels that get
+// culled are never formatted, and text wider than that is cut off.
+// %s arguments and <fmt> must stay alive until zui_render, same as zui_label.
+ZUI_API void zui_labelf_lazy(i16 fixed_width, const char *fmt, ...);
 ZUI_API void zui_sliderf(char *tooltip, f32 min, f32 max, f32 *value);
 ZUI_API void zui_slideri(char *tooltip, i32 min, i32 max, i32 *value);
 ZUI_API void zui_combo_set(zd_combo *state, i32 index);
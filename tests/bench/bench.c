@@ -0,0 +1,530 @@
+// Layout / render benchmarks.
+// Builds synthetic UIs against a null renderer and prints one JSON object per scenario:
+//   per-phase ns per widget, commands per frame, and allocation counts.
+//
+// usage: bench [scenario] [n] [frames]
+//   without arguments every scenario runs at its default sizes
+//   built with ZUI_TRACE (./build.sh trace) the last frame of each scenario is saved as a trace
+//   exits with 1 when a scenario checks its results and they're wrong
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static long long bench_allocs, bench_alloc_bytes;
+static void *bench_malloc(size_t size) { bench_allocs++; bench_alloc_bytes += size; return malloc(size); }
+static void *bench_calloc(size_t cnt, size_t size) { bench_allocs++; bench_alloc_bytes += cnt * size; return calloc(cnt, size); }
+static void *bench_realloc(void *ptr, size_t size) { bench_allocs++; bench_alloc_bytes += size; return realloc(ptr, size); }
+#define ZUI_MALLOC(size) bench_malloc(size)
+#define ZUI_CALLOC(cnt, size) bench_calloc(cnt, size)
+#define ZUI_REALLOC(ptr, size) bench_realloc(ptr, size)
+#define ZUI_FREE(ptr) free(ptr)
+
+// unity build so the allocation hooks apply to the library too
+#include "../../src/zui.c"
+#include "../../src/zui-node.c"
+
+void print_link(zd_node_link *link) {}
+void print_node(zd_node *node) {}
+
+static u64 bench_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// answers queries with fixed metrics and drops every draw command
+static void null_renderer(zcmd_any *cmd, void *user_data) {
+    switch(cmd->base.id) {
+        case ZCMD_REG_FONT: cmd->font.response_height = 16; break;
+        case ZCMD_GLYPH_SZ: cmd->glyph_sz.response = (zvec2) { 6 + cmd->glyph_sz.codepoint % 4, 16 }; break;
+        case ZCMD_TIMESTAMP: cmd->timestamp.resp_ns = bench_ns(); break;
+        case ZCMD_GET_CLIPBOARD: cmd->get_clipboard.response = ""; break;
+    }
+}
+
+typedef struct scenario {
+    char *name;
+    i32 n;            // default size
+    void (*setup)(i32 n);
+    void (*frame)(i32 n);
+    f64 commands, command_bytes, ms; // per frame in the last run
+} scenario;
+
+// a scenario's own check failed: the numbers it prints would mean nothing
+static void bench_check(bool ok, char *scenario, char *what) {
+    if(ok) return;
+    fprintf(stderr, "%s: failed, %s\n", scenario, what);
+    exit(1);
+}
+
+// labels are laid out 10 per row, coordinates are i16 so very tall columns overflow
+static void labels_frame(i32 n) {
+    static zd_scroll scroll;
+    zui_scroll(false, true, &scroll);
+        zui_col(Z_AUTO_ALL);
+        for(i32 i = 0; i < n; i += 10) {
+            zui_row(Z_AUTO_ALL);
+            for(i32 j = i; j < i + 10 && j < n; j++)
+                zui_label("The quick brown fox");
+            zui_end();
+        }
+        zui_end();
+    zui_end();
+}
+
+static void labelf_frame(i32 n) {
+    static zd_scroll scroll;
+    zui_scroll(false, true, &scroll);
+        zui_col(Z_AUTO_ALL);
+        for(i32 i = 0; i < n; i += 10) {
+            zui_row(Z_AUTO_ALL);
+            for(i32 j = i; j < i + 10 && j < n; j++)
+                zui_labelf("item %d: %.2f", j, j * 0.5);
+            zui_end();
+        }
+        zui_end();
+    zui_end();
+}
+
+// most labels sit in a tab that isn't shown, which is where lazy formatting pays off
+static void labelf_lazy_frame(i32 n) {
+    static i32 tab = 0;
+    zui_tabset("visible,hidden", &tab);
+        zui_col(Z_AUTO_ALL);
+        for(i32 i = 0; i < 10; i++)
+            zui_labelf_lazy(120, "item %d: %.2f", i, i * 0.5);
+        zui_end();
+        zui_col(Z_AUTO_ALL);
+        for(i32 i = 0; i < n; i++)
+            zui_labelf_lazy(120, "item %d: %.2f", i, i * 0.5);
+        zui_end();
+    zui_end();
+}
+
+// alternating rows / columns, every level filling the space left by its sibling
+static void nested_frame(i32 n) {
+    for(i32 i = 0; i < n; i++) {
+        zui_fill(ZF_FILL_X | ZF_FILL_Y);
+        if(i & 1) zui_col(2, Z_AUTO, Z_FILL);
+        else      zui_row(2, Z_AUTO, Z_FILL);
+        zui_label("level");
+    }
+    zui_blank();
+    for(i32 i = 0; i < n; i++)
+        zui_end();
+}
+
+static void grid_frame(i32 n) {
+    i32 side = 1;
+    while(side * side < n) side++;
+    zui_grid(side, side, Z_AUTO_ALL, Z_AUTO_ALL);
+    for(i32 i = 0; i < side * side; i++)
+        zui_label("cell");
+    zui_end();
+}
+
+static void tabset_frame(i32 n) {
+    static i32 tabs[1024];
+    i32 sets = n / 40 > 0 ? n / 40 : 1;
+    if(sets > 1024) sets = 1024;
+    zui_col(Z_AUTO_ALL);
+    for(i32 s = 0; s < sets; s++) {
+        zui_tabset("first,second,third,fourth", &tabs[s]);
+        for(i32 t = 0; t < 4; t++) {
+            zui_col(Z_AUTO_ALL);
+            for(i32 i = 0; i < 8; i++)
+                zui_label("tab content");
+            zui_end();
+        }
+        zui_end();
+    }
+    zui_end();
+}
+
+static void scroll_frame(i32 n) {
+    static zd_scroll scrolls[1024];
+    i32 cnt = n / 20 > 0 ? n / 20 : 1;
+    if(cnt > 1024) cnt = 1024;
+    zui_col(Z_AUTO_ALL);
+    for(i32 s = 0; s < cnt; s++) {
+        zui_scroll(false, true, &scrolls[s]);
+        zui_col(Z_AUTO_ALL);
+        for(i32 i = 0; i < 20; i++)
+            zui_label("scrolled");
+        zui_end();
+        zui_end();
+    }
+    zui_end();
+}
+
+static char (*text_buffers)[32];
+static zd_text *text_states;
+static void text_setup(i32 n) {
+    text_buffers = calloc(n, 32);
+    text_states = calloc(n, sizeof(zd_text));
+    for(i32 i = 0; i < n; i++)
+        snprintf(text_buffers[i], 32, "input %d", i);
+}
+static void text_frame(i32 n) {
+    zui_col(Z_AUTO_ALL);
+    for(i32 i = 0; i < n; i++)
+        zui_text(text_buffers[i], 32, &text_states[i]);
+    zui_end();
+}
+
+static zd_node_editor editor;
+static void nodes_setup(i32 n) {
+    znode_free(&editor);
+    zd_node *prev = 0;
+    for(i32 i = 0; i < n; i++) {
+        zvec2 pos = { (i % 100) * 150, (i / 100) * 80 };
+        zd_node *node = znode_add(&editor, (void*)(size_t)(i + 1), 0, pos, 1, 1, 0);
+        if(prev) znode_link(&editor, prev, 0, node, 0);
+        prev = node;
+    }
+}
+static void nodes_frame(i32 n) {
+    zui_node_editor(&editor);
+    FOR_NODES(&editor)
+        zui_label("node");
+    zui_end();
+}
+
+// log lines of n characters in a 300 pixel column, only the glyphs inside it are sent. Sizes are i16, so n is kept
+// under ~32k pixels of text
+static char *long_line;
+static void longline_setup(i32 n) {
+    long_line = realloc(long_line, n + 1);
+    for(i32 i = 0; i < n; i++)
+        long_line[i] = 'a' + i % 26;
+    long_line[n] = 0;
+}
+static void longline_frame(i32 n) {
+    zui_col(Z_AUTO_ALL);
+    for(i32 i = 0; i < 20; i++) {
+        zui_row(1, 300);
+            zui_labeln(long_line, n);
+        zui_end();
+    }
+    zui_end();
+}
+
+// user content in many scripts: each frame shows a window of 2048 code points that moves by 512 every frame, while
+// the glyph cache holds 4096 so the sizes of the scripts no longer shown get evicted. Runs last, it keeps the limit
+static void scripts_setup(i32 n) {
+    zui_glyph_cache_limit(4096);
+}
+static void scripts_frame(i32 n) {
+    static u32 f;
+    static zd_scroll scroll;
+    u32 base = 0x400 + (f++ % 32) * 512;
+    zui_scroll(false, true, &scroll);
+        zui_col(Z_AUTO_ALL);
+        for(i32 i = 0; i < n; i++) {
+            char text[33];
+            i32 len = 0;
+            for(i32 k = 0; k < 8; k++) {
+                u32 cp = base + (i * 8 + k) % 2048;
+                utf8_print(&text[len], cp, utf8_len(cp));
+                len += utf8_len(cp);
+            }
+            zui_labelf("%.*s", len, text);
+        }
+        zui_end();
+    zui_end();
+}
+
+// an application model of n objects is synced into the editor every frame, looking each one up by its pointer
+static u8 *sync_model;
+static void node_sync_setup(i32 n) {
+    znode_free(&editor);
+    sync_model = realloc(sync_model, n);
+}
+static void node_sync_frame(i32 n) {
+    for(i32 i = 0; i < n; i++)
+        if(!znode_get(&editor, &sync_model[i], 1))
+            znode_add(&editor, &sync_model[i], 1, (zvec2) { (i % 100) * 150, (i / 100) * 80 }, 1, 1, 0);
+    nodes_frame(n);
+}
+
+// a large graph of which only a window's worth is on screen, the application only emits widgets for those
+static void nodes_visible_frame(i32 n) {
+    zui_node_editor(&editor);
+    FOR_VISIBLE_NODES(&editor)
+        zui_label("node");
+    zui_end();
+}
+
+// the same graph zoomed out until all of it fits, drawn as a map of the screen cells nodes cover and no widgets are
+// laid out. Has to cost less than nodes_visible
+static void nodes_far_setup(i32 n) {
+    nodes_setup(n);
+    FOR_NODES(&editor)
+        node->rect.sz = (zvec2) { 60, 20 }; // as laid out when zoomed in
+    editor.zoom = 0.05f;
+}
+// and panned by a pixel every frame, so the map is made again from every node in view
+static void nodes_far_pan_frame(i32 n) {
+    static i32 f;
+    editor.offset.x = f++ % 2;
+    nodes_visible_frame(n);
+}
+
+// an evaluator that needs the order after every edit: a layered graph where each frame makes 100 links between nodes
+// a few layers apart, in either direction so some close a cycle and are refused, removes them and reads the order
+static zd_node **order_buf;
+static void node_order_setup(i32 n) {
+    znode_free(&editor);
+    order_buf = realloc(order_buf, n * sizeof(zd_node*));
+    u32 seed = 1;
+    for(i32 i = 0; i < n; i++) {
+        zd_node *node = znode_add(&editor, (void*)(size_t)(i + 1), 0, (zvec2) { (i / 200) * 150, (i % 200) * 80 }, 2, 2, 0);
+        for(i32 k = 0; k < 2 && i >= 200; k++) {
+            seed = seed * 1103515245 + 12345;
+            znode_link(&editor, znode_get(&editor, (void*)(size_t)(i / 200 * 200 - 200 + (seed >> 8) % 200 + 1), 0), k, node, k);
+        }
+    }
+}
+static void node_order_frame(i32 n) {
+    static u32 seed = 1;
+    i32 linked = 0, refused = 0, cnt = 0;
+    for(i32 e = 0; e < 100; e++) {
+        seed = seed * 1103515245 + 12345;
+        i32 a = (seed >> 8) % n, b = a + ((seed >> 20) % 7 - 3) * 200 + (seed >> 4) % 9;
+        if(b < 0 || b >= n || a == b) continue;
+        zd_node *out = znode_get(&editor, (void*)(size_t)(a + 1), 0), *in = znode_get(&editor, (void*)(size_t)(b + 1), 0);
+        if(znode_link(&editor, out, 1, in, 1)) {
+            znode_del_link(&editor, in->inputs);
+            linked++;
+        } else refused++;
+        cnt = znode_toposort(&editor, order_buf);
+    }
+    zui_col(Z_AUTO_ALL);
+    zui_labelf("%d nodes in order, %d linked, %d refused", cnt, linked, refused);
+    zui_end();
+}
+
+// an evaluator keeping results up to date on the same graph: each frame changes 10 parameters, then recomputes the
+// nodes downstream of them in order. Costs what they reach rather than the whole graph
+static void node_dirty_setup(i32 n) {
+    node_order_setup(n);
+    i32 cnt;
+    zd_node **dirty = znode_recompute(&editor, &cnt);
+    for(i32 i = 0; i < cnt; i++)
+        znode_clean(dirty[i], 0);
+}
+static void node_dirty_frame(i32 n) {
+    static u32 seed = 1;
+    i32 cnt;
+    for(i32 e = 0; e < 10; e++) {
+        seed = seed * 1103515245 + 12345;
+        znode_dirty(&editor, znode_get(&editor, (void*)(size_t)((seed >> 8) % n + 1), 0));
+    }
+    zd_node **dirty = znode_recompute(&editor, &cnt);
+    for(i32 i = 0; i < cnt; i++) {
+        size_t sum = (size_t)dirty[i]->uud;
+        FOR_INPUTS(dirty[i])
+            sum += (size_t)link->output->result;
+        znode_clean(dirty[i], (void*)sum);
+    }
+    zui_col(Z_AUTO_ALL);
+    zui_labelf("%d of %d nodes recomputed", cnt, n);
+    zui_end();
+}
+
+// a mirror of the same graph kept in sync through the journal: each frame moves 100 nodes and links each to a node a
+// few layers further, removing the link again, then the mirror applies the events. Timing only, tests/node checks
+// the mirror against the graph
+static zd_node_event journal_buf[256];
+static struct {
+    i32 n;
+    bool *live;
+    zvec2 *pos;
+    i32 *in_cnt;
+    u64 *in_sum;    // of the hashes of the node's input links, a set compared in one number
+    u64 cursor;
+} mirror;
+static u64 mirror_hash(void *out_uud, i32 id_out, i32 id_in) {
+    u64 h = (u64)(size_t)out_uud * 0x9E3779B97F4A7C15ull ^ (u64)(u32)id_out << 32 ^ (u32)id_in;
+    h = (h ^ h >> 31) * 0xBF58476D1CE4E5B9ull;
+    return h ^ h >> 29;
+}
+static void mirror_resync() {
+    memset(mirror.live, 0, mirror.n * sizeof(bool));
+    memset(mirror.in_cnt, 0, mirror.n * sizeof(i32));
+    memset(mirror.in_sum, 0, mirror.n * sizeof(u64));
+    FOR_NODES(&editor) {
+        i32 u = (i32)(size_t)node->uud - 1;
+        mirror.live[u] = true;
+        mirror.pos[u] = (zvec2) { node->rect.x, node->rect.y };
+    }
+    FOR_LINKS(&editor) {
+        i32 u = (i32)(size_t)link->input->uud - 1;
+        mirror.in_cnt[u]++;
+        mirror.in_sum[u] += mirror_hash(link->output->uud, link->id_out, link->id_in);
+    }
+    mirror.cursor = editor.journal.head;
+}
+static void mirror_apply(zd_node_event *ev) {
+    i32 u = (i32)(size_t)ev->uud - 1, v = (i32)(size_t)ev->input_uud - 1;
+    switch(ev->kind) {
+        case ZNODE_EV_ADD: mirror.live[u] = true; // fallthrough
+        case ZNODE_EV_MOVE: mirror.pos[u] = ev->pos; break;
+        case ZNODE_EV_DEL: mirror.live[u] = false; break;
+        case ZNODE_EV_LINK: mirror.in_cnt[v]++; mirror.in_sum[v] += mirror_hash(ev->uud, ev->out, ev->in); break;
+        case ZNODE_EV_UNLINK: mirror.in_cnt[v]--; mirror.in_sum[v] -= mirror_hash(ev->uud, ev->out, ev->in); break;
+        case ZNODE_EV_LOAD: mirror_resync(); break;
+    }
+}
+static void node_journal_setup(i32 n) {
+    node_order_setup(n);
+    znode_journal(&editor, 4096);
+    mirror.n = n;
+    mirror.live = realloc(mirror.live, n * sizeof(bool));
+    mirror.pos = realloc(mirror.pos, n * sizeof(zvec2));
+    mirror.in_cnt = realloc(mirror.in_cnt, n * sizeof(i32));
+    mirror.in_sum = realloc(mirror.in_sum, n * sizeof(u64));
+    mirror_resync();
+}
+static void node_journal_frame(i32 n) {
+    static u32 seed = 1;
+    for(i32 e = 0; e < 100; e++) {
+        seed = seed * 1103515245 + 12345;
+        i32 a = (seed >> 8) % n, b = a + (1 + (seed >> 4) % 3) * 200;
+        zd_node *node = znode_get(&editor, (void*)(size_t)(a + 1), 0);
+        znode_move(&editor, node, (zvec2) { node->rect.x + 1, node->rect.y });
+        if(b >= n) continue;
+        zd_node *in = znode_get(&editor, (void*)(size_t)(b + 1), 0);
+        if(znode_link(&editor, node, 1, in, 1)) znode_del_link(&editor, in->inputs);
+    }
+    i32 cnt, events = 0, moves = 0;
+    while((cnt = znode_journal_read(&editor, &mirror.cursor, journal_buf, 256))) {
+        if(cnt < 0) {
+            mirror_resync();
+            continue;
+        }
+        for(i32 i = 0; i < cnt; i++) {
+            mirror_apply(&journal_buf[i]);
+            moves += journal_buf[i].kind == ZNODE_EV_MOVE;
+        }
+        events += cnt;
+    }
+    zui_col(Z_AUTO_ALL);
+    zui_labelf("%d events, %d moves", events, moves);
+    zui_end();
+}
+
+static scenario scenarios[] = {
+    { "labels",      10000,  0,           labels_frame },
+    { "labelf",      10000,  0,           labelf_frame },
+    { "labelf_lazy", 10000,  0,           labelf_lazy_frame },
+    { "nested",      200,    0,           nested_frame },
+    { "grid",        10000,  0,           grid_frame },
+    { "tabset",      10000,  0,           tabset_frame },
+    { "scroll",      10000,  0,           scroll_frame },
+    { "text",        10000,  text_setup,  text_frame },
+    { "nodes",       2000,   nodes_setup, nodes_frame },
+    { "node_sync",   20000,  node_sync_setup, node_sync_frame },
+    { "nodes_visible", 20000, nodes_setup, nodes_visible_frame },
+    { "nodes_far",   20000,  nodes_far_setup, nodes_visible_frame },
+    { "nodes_far_pan", 20000, nodes_far_setup, nodes_far_pan_frame },
+    { "node_order",  20000,  node_order_setup, node_order_frame },
+    { "node_dirty",  20000,  node_dirty_setup, node_dirty_frame },
+    { "node_journal", 20000, node_journal_setup, node_journal_frame },
+    { "longline",    4000,   longline_setup, longline_frame },
+    { "scripts",     1000,   scripts_setup, scripts_frame },
+};
+
+static scenario *find_scenario(char *name) {
+    for(i32 i = 0; i < (i32)(sizeof(scenarios) / sizeof(scenarios[0])); i++)
+        if(!strcmp(scenarios[i].name, name)) return &scenarios[i];
+    return 0;
+}
+
+static void run_frame(scenario *s, i32 n) {
+    zui_window();
+    s->frame(n);
+    zui_end();
+    zui_render();
+}
+
+static void run(scenario *s, i32 n, i32 frames, bool first) {
+    if(s->setup) s->setup(n);
+    i64 allocs = bench_allocs;
+    run_frame(s, n); // warmup, grows buffers and fills the glyph cache
+    i64 warmup_allocs = bench_allocs - allocs;
+    i64 sum[ZP_LAST] = { 0 }, widget_sum = 0, cmd_sum = 0, cmd_bytes_sum = 0, query_sum = 0, eviction_sum = 0;
+    allocs = bench_allocs;
+    i64 alloc_bytes = bench_alloc_bytes;
+    u64 start = bench_ns();
+    for(i32 f = 0; f < frames; f++) {
+#ifdef ZUI_TRACE
+        if(f == frames - 1) zui_trace_clear();
+#endif
+        run_frame(s, n);
+        zui_stats *stats = zui_get_stats();
+        for(i32 i = 0; i < ZP_LAST; i++)
+            sum[i] += stats->ns[i];
+        widget_sum += stats->widgets;
+        cmd_sum += stats->cmds;
+        cmd_bytes_sum += stats->cmd_bytes;
+        query_sum += stats->glyph_queries;
+        eviction_sum += stats->glyph_evictions;
+    }
+    u64 wall = bench_ns() - start;
+    s->commands = (f64)cmd_sum / frames;
+    s->command_bytes = (f64)cmd_bytes_sum / frames;
+    s->ms = wall / 1e6 / frames;
+    f64 widgets = (f64)widget_sum / frames;
+    f64 per_widget = widgets > 0 ? 1.0 / (widgets * frames) : 0;
+    printf("%s{\"scenario\":\"%s\",\"n\":%d,\"frames\":%d,\"widgets\":%.0f,\"commands\":%.0f,\"command_bytes\":%.0f,",
+        first ? "" : ",\n", s->name, n, frames, widgets, s->commands, s->command_bytes);
+    printf("\"ns_per_widget\":{\"text\":%.2f,\"size_x\":%.2f,\"size_y\":%.2f,\"pos\":%.2f,\"draw\":%.2f,\"sort\":%.2f,\"submit\":%.2f,\"frame\":%.2f},",
+        sum[ZP_TEXT] * per_widget, sum[ZP_SIZE_X] * per_widget, sum[ZP_SIZE_Y] * per_widget, sum[ZP_POS] * per_widget,
+        sum[ZP_DRAW] * per_widget, sum[ZP_SORT] * per_widget, sum[ZP_SUBMIT] * per_widget, wall * per_widget);
+    printf("\"ms_per_frame\":%.3f,\"allocs\":{\"warmup\":%lld,\"per_frame\":%.2f,\"bytes_per_frame\":%.0f},",
+        s->ms, warmup_allocs, (f64)(bench_allocs - allocs) / frames, (f64)(bench_alloc_bytes - alloc_bytes) / frames);
+    zui_map_stats *glyphs = &zui_get_stats()->glyphs;
+    printf("\"glyphs\":{\"cached\":%u,\"capacity\":%u,\"queries_per_frame\":%.1f,\"evictions_per_frame\":%.1f}}",
+        glyphs->used, glyphs->capacity, (f64)query_sum / frames, (f64)eviction_sum / frames);
+    fflush(stdout);
+#ifdef ZUI_TRACE
+    char path[256];
+    i32 len;
+    char *trace = zui_trace(&len);
+    snprintf(path, sizeof(path), "bin/trace-%s.json", s->name);
+    FILE *f = fopen(path, "wb");
+    if(f) {
+        fwrite(trace, 1, len, f);
+        fclose(f);
+    }
+#endif
+}
+
+i32 main(i32 argc, char **argv) {
+    char *only = argc > 1 ? argv[1] : 0;
+    i32 n = argc > 2 ? atoi(argv[2]) : 0;
+    i32 frames = argc > 3 ? atoi(argv[3]) : 10;
+    zui_init(null_renderer, 0, 0);
+    zui_node_register();
+    zui_new_font("null", 16);
+    zui_resize(1920, 1080);
+    zui_mouse_move((zvec2) { 10, 10 });
+    bool first = true;
+    printf("[\n");
+    for(i32 i = 0; i < (i32)(sizeof(scenarios) / sizeof(scenarios[0])); i++) {
+        if(only && strcmp(only, scenarios[i].name)) continue;
+        run(&scenarios[i], n ? n : scenarios[i].n, frames, first);
+        first = false;
+    }
+    printf("\n]\n");
+    zui_close();
+    // zoomed out past ZNODE_LOD_FAR the editor sends less than for the window of nodes it shows up close
+    scenario *visible = find_scenario("nodes_visible"), *zoomed_out = find_scenario("nodes_far");
+    if(visible->ms && zoomed_out->ms) {
+        bench_check(zoomed_out->commands <= visible->commands, "nodes_far", "more commands than nodes_visible");
+        bench_check(zoomed_out->command_bytes <= visible->command_bytes, "nodes_far", "more command bytes than nodes_visible");
+        bench_check(zoomed_out->ms <= visible->ms, "nodes_far", "slower than nodes_visible");
+    }
+}
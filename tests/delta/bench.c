@@ -0,0 +1,204 @@
+// Frame-delta codec benchmark.
+// Records sessions with the headless backend, encodes every frame against the previous one, checks that decoding
+// gives back the exact stream and prints one JSON object per session: sizes, compression ratio and throughput.
+//
+// usage: delta-bench [session] [frames]
+#define ZUI_IMPL
+#include "../../src/zui.h"
+#include "../../src/zui-node.h"
+#include "../../src/zui-delta.h"
+#include "../../backends/headless/zui-headless.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+void print_link(zd_node_link *link) {}
+void print_node(zd_node *node) {}
+
+static u64 bench_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+typedef struct session {
+    char *name;
+    void (*frame)(i32 f);
+} session;
+
+// a static list with a counter that changes every frame
+static void counter_frame(i32 f) {
+    zui_col(Z_AUTO_ALL);
+    zui_labelf("frame %d", f);
+    for(i32 i = 0; i < 15; i++)
+        zui_label("static text");
+    zui_end();
+}
+
+// every command moves a few pixels per frame
+static void scroll_frame(i32 f) {
+    static zd_scroll scroll;
+    scroll.pos.y = -((f * 3) % 2000);
+    zui_scroll(false, true, &scroll);
+        zui_col(Z_AUTO_ALL);
+        for(i32 i = 0; i < 200; i++)
+            zui_labelf("row %d", i);
+        zui_end();
+    zui_end();
+}
+
+// one line of text grows, a caret moves
+static void typing_frame(i32 f) {
+    static char buffer[256];
+    static zd_text state;
+    if(f == 0) {
+        memset(&state, 0, sizeof(state));
+        strcpy(buffer, "name: ");
+    } else if(f == 1) {
+        zui_mouse_move((zvec2) { 20, 120 }); // focus the text box
+        zui_mouse_down(ZM_LEFT_CLICK);
+    } else if(f == 2) {
+        zui_mouse_up(ZM_LEFT_CLICK);
+    } else if(f % 4 == 0 && strlen(buffer) < 60) {
+        zui_key_char('a' + (f / 4) % 26);
+    }
+    zui_col(Z_AUTO_ALL);
+    zui_text(buffer, sizeof(buffer), &state);
+    for(i32 i = 0; i < 10; i++)
+        zui_label("static text");
+    zui_end();
+}
+
+// the mouse sweeps over a grid of buttons, changing which one is hovered
+static void hover_frame(i32 f) {
+    static u8 states[64];
+    zui_mouse_move((zvec2) { 20 + (f * 7) % 600, 20 + (f * 3) % 400 });
+    zui_grid(8, 8, Z_AUTO_ALL, Z_AUTO_ALL);
+    for(i32 i = 0; i < 64; i++)
+        zui_button_txt("button", &states[i]);
+    zui_end();
+}
+
+// panning a node graph moves every node and link
+static zd_node_editor editor;
+static void nodes_frame(i32 f) {
+    if(f == 0) {
+        znode_free(&editor);
+        zd_node *prev = 0;
+        for(i32 i = 0; i < 60; i++) {
+            zd_node *node = znode_add(&editor, (void*)(size_t)(i + 1), 0, (zvec2) { (i % 10) * 150, (i / 10) * 90 }, 1, 1, 0);
+            if(prev) znode_link(&editor, prev, 0, node, 0);
+            prev = node;
+        }
+    }
+    editor.offset = (zvec2) { -(f % 200), -(f % 100) };
+    zui_node_editor(&editor);
+    FOR_NODES(&editor)
+        zui_label("node");
+    zui_end();
+}
+
+// switching tabs every 30 frames replaces most of the frame
+static void tabs_frame(i32 f) {
+    static i32 tab;
+    tab = (f / 30) % 3;
+    zui_tabset("first,second,third", &tab);
+    for(i32 t = 0; t < 3; t++) {
+        zui_col(Z_AUTO_ALL);
+        for(i32 i = 0; i < 12; i++)
+            zui_labelf("tab %d item %d", t, i);
+        zui_end();
+    }
+    zui_end();
+}
+
+static session sessions[] = {
+    { "counter", counter_frame },
+    { "scroll",  scroll_frame },
+    { "typing",  typing_frame },
+    { "hover",   hover_frame },
+    { "nodes",   nodes_frame },
+    { "tabs",    tabs_frame },
+};
+
+static void run(session *s, i32 frames, bool first) {
+    u8 **stream = malloc(frames * sizeof(u8*));
+    i32 *len = malloc(frames * sizeof(i32));
+    i64 raw = 0;
+    for(i32 f = 0; f < frames; f++) {
+        zui_window();
+        s->frame(f);
+        zui_end();
+        zui_render();
+        u8 *data = headless_frame(&len[f]);
+        stream[f] = malloc(len[f]);
+        memcpy(stream[f], data, len[f]);
+        raw += len[f];
+    }
+
+    zdelta d = { 0 };
+    u8 **encoded = malloc(frames * sizeof(u8*));
+    i32 *enc_len = malloc(frames * sizeof(i32));
+    i64 total = 0, keyframes = 0;
+    for(i32 f = 0; f < frames; f++)
+        encoded[f] = malloc(zdelta_bound(len[f]));
+    u64 start = bench_ns();
+    for(i32 f = 0; f < frames; f++) {
+        enc_len[f] = zdelta_encode(&d, f ? stream[f - 1] : 0, f ? len[f - 1] : 0, stream[f], len[f], encoded[f]);
+        total += enc_len[f];
+    }
+    u64 encode_ns = bench_ns() - start;
+    // every frame on its own, only deltas within the frame
+    u8 *tmp = malloc(zdelta_bound(len[frames - 1]) + 1);
+    for(i32 f = 0; f < frames; f++) {
+        tmp = realloc(tmp, zdelta_bound(len[f]));
+        keyframes += zdelta_encode(&d, 0, 0, stream[f], len[f], tmp);
+    }
+
+    u8 *out = 0;
+    i32 out_cap = 0;
+    bool exact = true;
+    start = bench_ns();
+    for(i32 f = 0; f < frames; f++) {
+        if(out_cap < len[f]) out = realloc(out, out_cap = len[f] * 2);
+        i32 n = zdelta_decode(f ? stream[f - 1] : 0, f ? len[f - 1] : 0, encoded[f], enc_len[f], out, out_cap);
+        exact &= n == len[f] && !memcmp(out, stream[f], n);
+    }
+    u64 decode_ns = bench_ns() - start;
+
+    printf("%s{\"session\":\"%s\",\"frames\":%d,\"raw_bytes\":%lld,\"encoded_bytes\":%lld,\"ratio\":%.2f,\"keyframe_ratio\":%.2f,",
+        first ? "" : ",\n", s->name, frames, raw, total, (f64)raw / total, (f64)raw / keyframes);
+    printf("\"bytes_per_frame\":{\"raw\":%.0f,\"encoded\":%.1f},\"encode_mb_s\":%.1f,\"decode_mb_s\":%.1f,\"exact\":%s}",
+        (f64)raw / frames, (f64)total / frames, raw / (encode_ns / 1e9) / 1e6, raw / (decode_ns / 1e9) / 1e6, exact ? "true" : "false");
+    fflush(stdout);
+
+    for(i32 f = 0; f < frames; f++) {
+        free(stream[f]);
+        free(encoded[f]);
+    }
+    free(stream); free(len); free(encoded); free(enc_len); free(tmp); free(out);
+    zdelta_free(&d);
+    if(!exact) exit(1);
+}
+
+void LOG(char *fmt, va_list args, void *user_data) { vprintf(fmt, args); }
+
+i32 main(i32 argc, char **argv) {
+    char *only = argc > 1 ? argv[1] : 0;
+    i32 frames = argc > 2 ? atoi(argv[2]) : 600;
+    if(frames < 1) frames = 1;
+    zui_headless_args args = { .width = 800, .height = 600, .fallback_metrics = true, .record = true, .fixed_clock = true, .tick_manually = true };
+    zui_init(headless_renderer, LOG, &args);
+    zui_node_register();
+    zui_new_font("Consolas", 16);
+    printf("[\n");
+    bool first = true;
+    for(i32 i = 0; i < (i32)(sizeof(sessions) / sizeof(sessions[0])); i++) {
+        if(only && strcmp(only, sessions[i].name)) continue;
+        run(&sessions[i], frames, first);
+        first = false;
+    }
+    printf("\n]\n");
+    zui_close();
+}
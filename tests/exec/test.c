@@ -0,0 +1,160 @@
+// Execution engine test.
+// Evaluates a layered graph whose nodes hash their inputs' values, serially along znode_toposort and with the engine
+// at 1 and <threads> workers, while the main thread only polls like a UI frame would. Every run must give the serial
+// values. Then checks that a failing node skips what's downstream of it and that cancelling ends a run early.
+// Prints one JSON object, exits with 1 on any difference.
+//
+// usage: exec-test [nodes] [threads] [work]
+//   work: iterations of busy work per node
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include "../../src/zui-exec.h"
+
+typedef struct model {
+    u64 value;
+    u32 done;
+    i32 index;
+} model;
+
+static model *models;
+static i32 work = 2000, fail_at = -1;
+static u32 order_errors;
+
+static u64 test_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static bool compute(zd_node *node, void *user_data) {
+    model *m = node->uud;
+    u64 v = m->index + 1;
+    FOR_INPUTS(node) {
+        model *in = link->output->uud;
+        if(!__atomic_load_n(&in->done, __ATOMIC_ACQUIRE)) __atomic_add_fetch(&order_errors, 1, __ATOMIC_RELAXED);
+        v = v * 31 + in->value + link->id_in;
+    }
+    for(i32 i = 0; i < work; i++)
+        v = v * 6364136223846793005ULL + 1442695040888963407ULL;
+    m->value = v;
+    __atomic_store_n(&m->done, 1, __ATOMIC_RELEASE);
+    return m->index != fail_at;
+}
+
+static void reset(i32 n) {
+    for(i32 i = 0; i < n; i++)
+        models[i] = (model) { .index = i };
+}
+
+// polls the way a frame loop would, returns how many times it did
+static u32 poll(zexec *e) {
+    u32 polls = 0;
+    while(zexec_state(e) == ZEXEC_RUNNING) {
+        polls++;
+        struct timespec ts = { 0, 100000 };
+        nanosleep(&ts, 0);
+    }
+    return polls;
+}
+
+void print_link(zd_node_link *link) {}
+void print_node(zd_node *node) {}
+
+i32 main(i32 argc, char **argv) {
+    i32 n = argc > 1 ? atoi(argv[1]) : 20000;
+    i32 threads = argc > 2 ? atoi(argv[2]) : 0;
+    if(argc > 3) work = atoi(argv[3]);
+    if(n < 400) n = 400;
+    static zd_node_editor editor;
+    models = calloc(n, sizeof(model));
+    // 200 nodes per layer, each takes two inputs from the layer before
+    u32 seed = 1;
+    for(i32 i = 0; i < n; i++) {
+        zd_node *node = znode_add(&editor, &models[i], 1, (zvec2) { 0 }, 2, 2, 0);
+        for(i32 k = 0; k < 2 && i >= 200; k++) {
+            seed = seed * 1103515245 + 12345;
+            znode_link(&editor, znode_get(&editor, &models[i / 200 * 200 - 200 + (seed >> 8) % 200], 1), k, node, k);
+        }
+    }
+
+    zd_node **order = malloc(n * sizeof(zd_node*));
+    u64 *expected = malloc(n * sizeof(u64));
+    reset(n);
+    u64 start = test_ns();
+    i32 cnt = znode_toposort(&editor, order);
+    for(i32 i = 0; i < cnt; i++)
+        compute(order[i], 0);
+    u64 serial_ns = test_ns() - start;
+    for(i32 i = 0; i < n; i++)
+        expected[i] = models[i].value;
+
+    bool ok = cnt == n;
+    u64 run_ns[2];
+    u32 polls = 0;
+    i32 workers[2] = { 1, threads };
+    for(i32 r = 0; r < 2; r++) {
+        zexec *e = zexec_new(workers[r]);
+        zexec_register(e, 1, compute, 0);
+        for(i32 rep = 0; rep < 3; rep++) {
+            reset(n);
+            ok &= zexec_run(e, &editor);
+            polls += poll(e);
+            ok &= zexec_wait(e) == ZEXEC_DONE;
+            for(i32 i = 0; i < n; i++)
+                ok &= models[i].value == expected[i];
+        }
+        run_ns[r] = zexec_run_ns(e);
+        zexec_timing *t = zexec_node_timing(e, order[n - 1]);
+        ok &= t && t->state == ZEXEC_NODE_DONE && t->start_ns < run_ns[r];
+        zexec_free(e);
+    }
+
+    zexec *e = zexec_new(threads);
+    zexec_register(e, 1, compute, 0);
+    // a node of the first layer fails: everything it reaches is skipped, the rest runs
+    reset(n);
+    fail_at = 7;
+    zexec_run(e, &editor);
+    ok &= zexec_wait(e) == ZEXEC_DONE;
+    fail_at = -1;
+    u32 failed = 0, skipped = 0, wrong = 0;
+    for(i32 i = 0; i < cnt; i++) {
+        zexec_timing *t = zexec_node_timing(e, order[i]);
+        bool upstream_failed = false;
+        FOR_INPUTS(order[i]) {
+            u8 s = zexec_node_timing(e, link->output)->state;
+            upstream_failed |= s == ZEXEC_NODE_FAILED || s == ZEXEC_NODE_SKIPPED;
+        }
+        failed += t->state == ZEXEC_NODE_FAILED;
+        skipped += t->state == ZEXEC_NODE_SKIPPED;
+        wrong += upstream_failed != (t->state == ZEXEC_NODE_SKIPPED);
+    }
+    ok &= failed == 1 && skipped > 0 && !wrong;
+
+    // cancelled once a tenth of the nodes are done
+    reset(n);
+    zexec_run(e, &editor);
+    u32 total, done;
+    while((done = zexec_progress(e, &total)) < total / 10 && zexec_state(e) == ZEXEC_RUNNING)
+        sched_yield();
+    zexec_cancel(e);
+    i32 cancelled = zexec_wait(e);
+    u32 ran = 0;
+    for(i32 i = 0; i < n; i++)
+        ran += models[i].done;
+    ok &= cancelled == ZEXEC_CANCELLED && ran < (u32)n && zexec_progress(e, 0) == total;
+    i32 worker_cnt = zexec_threads(e);
+    zexec_free(e);
+    ok &= !order_errors;
+
+    printf("{\"nodes\":%d,\"links\":%d,\"threads\":%d,\"serial_ms\":%.2f,\"run_ms\":{\"single\":%.2f,\"pool\":%.2f},\"speedup\":%.2f,",
+        n, editor.link_cnt, worker_cnt, serial_ns / 1e6, run_ns[0] / 1e6, run_ns[1] / 1e6, (f64)run_ns[0] / run_ns[1]);
+    printf("\"polls\":%u,\"failed\":%u,\"skipped\":%u,\"cancelled_after\":%u,\"order_errors\":%u}\n", polls, failed, skipped, ran, order_errors);
+    printf("%s\n", ok ? "ok" : "FAILED");
+    znode_free(&editor);
+    free(order); free(expected); free(models);
+    return ok ? 0 : 1;
+}
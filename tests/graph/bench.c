@@ -0,0 +1,132 @@
+// Graph file benchmark.
+// Builds layered graphs of each size with znode_add / znode_link, saves them to memory and to a file, then loads them
+// back from memory and with the mmap loader. Checks that the loaded graph saves to the same bytes and prints one JSON
+// object per size: file size, build time and save / load throughput.
+//
+// usage: graph-bench [nodes...]
+#define ZUI_IMPL
+#include "../../src/zui.h"
+#include "../../src/zui-node.h"
+#include "../../backends/headless/zui-headless.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+void print_link(zd_node_link *link) {}
+void print_node(zd_node *node) {}
+
+static u64 bench_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// 200 nodes per layer, each takes two inputs from the layer before
+static void build(zd_node_editor *editor, i32 n) {
+    u32 seed = 1;
+    for(i32 i = 0; i < n; i++) {
+        zd_node *node = znode_add(editor, (void*)(size_t)(i + 1), 0, (zvec2) { (i / 200) * 150 % 30000, (i % 200) * 80 }, 2, 2, 0);
+        for(i32 k = 0; k < 2 && i >= 200; k++) {
+            seed = seed * 1103515245 + 12345;
+            znode_link(editor, znode_get(editor, (void*)(size_t)(i / 200 * 200 - 200 + (seed >> 8) % 200 + 1), 0), k, node, k);
+        }
+    }
+}
+
+// every node has the inputs it had, in the same order
+static bool same_graph(zd_node_editor *a, zd_node_editor *b) {
+    if(a->node_cnt != b->node_cnt || a->link_cnt != b->link_cnt) return false;
+    FOR_NODES(a) {
+        zd_node *other = znode_get(b, node->uud, node->uud_type);
+        if(!other || other->rect.x != node->rect.x || other->rect.y != node->rect.y || other->cnt_in != node->cnt_in)
+            return false;
+        zd_node_link *l = other->inputs;
+        FOR_INPUTS(node) {
+            if(!l || l->output->uud != link->output->uud || l->id_in != link->id_in || l->id_out != link->id_out)
+                return false;
+            l = l->next_in;
+        }
+        if(l) return false;
+    }
+    return true;
+}
+
+static void run(i32 n, bool first) {
+    static zd_node_editor editor, loaded;
+    znode_free(&editor);
+    u64 start = bench_ns();
+    build(&editor, n);
+    u64 build_ns = bench_ns() - start;
+
+    u64 bytes = znode_save(&editor, 0, 0);
+    u8 *data = malloc(bytes), *again = malloc(bytes);
+    start = bench_ns();
+    znode_save(&editor, data, bytes);
+    u64 save_ns = bench_ns() - start;
+    start = bench_ns();
+    bool ok = znode_save_file(&editor, "bin/graph.zng");
+    u64 save_file_ns = bench_ns() - start;
+
+    start = bench_ns();
+    ok &= znode_load(&loaded, data, bytes, 0, 0);
+    u64 load_ns = bench_ns() - start;
+    ok &= same_graph(&editor, &loaded);
+    start = bench_ns();
+    ok &= znode_load_file(&loaded, "bin/graph.zng", 0, 0);
+    u64 load_file_ns = bench_ns() - start;
+    ok &= same_graph(&editor, &loaded) && znode_save(&loaded, again, bytes) == bytes && !memcmp(data, again, bytes);
+    // damaged files are refused, and leave the loaded graph as it was. The last two links both go into the last node,
+    // ports 0 and 1, from port 0 and port 1
+    zd_node_file_node *fn = (zd_node_file_node*)((zd_node_file*)data + 1);
+    zd_node_file_link *last = (zd_node_file_link*)(data + bytes) - 1, *before = last - 1, saved[2] = { *before, *last };
+    for(i32 c = 0; c < 8; c++) {
+        *before = saved[0];
+        *last = saved[1];
+        fn[last->input].flags = fn[before->output].flags = 0;
+        bool valid = false;
+        switch(c) {
+            case 0: last->input = n; break;
+            case 1: last->id_in = -5; break;
+            case 2: last->id_in = fn[last->input].cnt_in; break;
+            case 3: last->id_out = fn[last->output].cnt_out; break;
+            case 4: *last = *before; break;
+            // both into port 0, fine unless it takes a single link
+            case 5: last->id_in = 0; valid = true; break;
+            case 6: last->id_in = 0; fn[last->input].flags = ZF_NODE_1IN; break;
+            // both from the same port
+            case 7: last->output = before->output; last->id_out = before->id_out; fn[before->output].flags = ZF_NODE_1OUT; break;
+        }
+        ok &= znode_load(&loaded, data, bytes, 0, 0) == valid && loaded.node_cnt == n;
+    }
+
+    printf("%s{\"nodes\":%d,\"links\":%d,\"bytes\":%llu,\"build_ms\":%.2f,\"save_ms\":%.2f,\"save_file_ms\":%.2f,\"load_ms\":%.2f,\"load_file_ms\":%.2f,",
+        first ? "" : ",\n", n, editor.link_cnt, bytes, build_ns / 1e6, save_ns / 1e6, save_file_ns / 1e6, load_ns / 1e6, load_file_ns / 1e6);
+    printf("\"save_mb_s\":%.1f,\"load_mb_s\":%.1f,\"load_file_mb_s\":%.1f,\"load_vs_build\":%.1f,\"exact\":%s}",
+        bytes / (save_ns / 1e9) / 1e6, bytes / (load_ns / 1e9) / 1e6, bytes / (load_file_ns / 1e9) / 1e6,
+        (f64)build_ns / load_file_ns, ok ? "true" : "false");
+    fflush(stdout);
+    free(data);
+    free(again);
+    znode_free(&loaded);
+    if(!ok) exit(1);
+}
+
+void LOG(char *fmt, va_list args, void *user_data) { vprintf(fmt, args); }
+
+i32 main(i32 argc, char **argv) {
+    zui_headless_args args = { .width = 800, .height = 600, .fallback_metrics = true };
+    zui_init(headless_renderer, LOG, &args);
+    zui_node_register();
+    printf("[\n");
+    if(argc > 1) {
+        for(i32 i = 1; i < argc; i++)
+            run(atoi(argv[i]) < 400 ? 400 : atoi(argv[i]), i == 1);
+    } else {
+        i32 sizes[] = { 10000, 100000, 1000000 };
+        for(i32 i = 0; i < 3; i++)
+            run(sizes[i], i == 0);
+    }
+    printf("\n]\n");
+    zui_close();
+}
@@ -0,0 +1,70 @@
+#define ZUI_IMPL
+#include "../../src/zui.h"
+#include "../../backends/headless/zui-headless.h"
+#include <stdio.h>
+#include <string.h>
+
+static char *font = "Consolas";
+static char *glyph_cache;
+static bool async;
+
+void init(void *user_data) {
+    zui_log("init\n");
+    if(glyph_cache)
+        zui_log("glyph cache %s: %s\n", glyph_cache, zui_glyph_cache_open(glyph_cache) ? "loaded" : "empty");
+    zui_new_font(font, 16);
+}
+
+void frame(void *user_data) {
+    static i32 tab = 0;
+    static i32 n = 0;
+    zui_window(); {
+        zui_col(3, Z_AUTO, Z_AUTO, Z_AUTO); {
+            zui_label("Hello!");
+            zui_labelf("frame %d", n++);
+            zui_tabset("One,Two", &tab); {
+                zui_label("first tab");
+                zui_label("second tab");
+            } zui_end();
+        } zui_end();
+    } zui_end();
+    zui_render();
+    i32 len;
+    headless_frame(&len);
+    zui_log("frame %d: %d commands, %d bytes, hash %016llx\n", n - 1, headless_frame_cmds(), len, headless_frame_hash());
+    zui_stats *stats = zui_get_stats();
+    zui_log("  %d widgets, ui buffer %d/%d bytes, %d glyphs cached (load %.2f, avg probe %.2f)\n",
+        stats->widgets, stats->bufs[ZB_UI].high_water, stats->bufs[ZB_UI].capacity,
+        stats->glyphs.used, stats->glyphs.load, stats->glyphs.avg_probe);
+    zui_log("  %d glyph queries, %d glyphs from the cache file, font %s (height %d)\n", stats->glyph_queries, stats->glyph_file_hits,
+        zui_font_ready(0) ? "ready" : "loading", zui_text_height(0));
+    // frames a display would show 16ms apart, the font loads meanwhile
+    for(i64 start = zui_ts(); async && !zui_font_ready(0) && zui_ts() - start < 16000000;);
+}
+
+void finish(void *user_data) {
+    if(glyph_cache) zui_glyph_cache_save(glyph_cache);
+    printf("close\n");
+}
+
+void LOG(char *fmt, va_list args, void *user_data) { vprintf(fmt, args); }
+
+// usage: headless-test [async] [font.ttf] [glyphs.zgc]
+i32 main(i32 argc, char **argv) {
+    async = argc > 1 && !strcmp(argv[1], "async");
+    if(async) argv++, argc--;
+    if(argc > 1) font = argv[1];
+    if(argc > 2) glyph_cache = argv[2];
+    zui_init(headless_renderer, LOG, &(zui_headless_args) {
+        .async_fonts = async,
+        .width = 300,
+        .height = 200,
+        .frames = 3,
+        .fallback_metrics = true,
+        .record = true,
+        .init = init,
+        .frame = frame,
+        .close = finish
+    });
+    zui_close();
+}
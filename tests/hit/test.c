@@ -0,0 +1,406 @@
+// Hit-test check.
+// Draws a random graph with overlapping nodes, nodes spanning several grid cells and links between them, zoomed in,
+// at 1 and zoomed out past ZNODE_LOD_FAR, editing it between frames, then compares znode_hit and znode_query_rect on
+// the grid of each frame with a scan of every node, port and link: a port wins over its node, a node over a link and
+// the later drawn over the earlier. Prints one JSON object, exits with 1 on a mismatch.
+//
+// usage: hit-test [nodes] [seed]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// unity build so the scan can use the editor's own geometry
+#include "../../src/zui.c"
+#include "../../src/zui-node.c"
+
+void print_link(zd_node_link *link) {}
+void print_node(zd_node *node) {}
+
+// the rects sent in the last frame
+static zcmd_rect *drawn;
+static i32 drawn_cnt, drawn_cap;
+
+static void null_renderer(zcmd_any *cmd, void *user_data) {
+    switch(cmd->base.id) {
+        case ZCMD_DRAW_RECT:
+            if(drawn_cnt == drawn_cap) {
+                drawn_cap = drawn_cap ? drawn_cap * 2 : 256;
+                drawn = realloc(drawn, drawn_cap * sizeof(zcmd_rect));
+            }
+            drawn[drawn_cnt++] = cmd->rect;
+            break;
+        case ZCMD_REG_FONT: cmd->font.response_height = 16; break;
+        case ZCMD_GLYPH_SZ: cmd->glyph_sz.response = (zvec2) { 6 + cmd->glyph_sz.codepoint % 4, 16 }; break;
+        case ZCMD_GET_CLIPBOARD: cmd->get_clipboard.response = ""; break;
+    }
+}
+
+static u32 seed = 1;
+static u32 rnd() {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 8;
+}
+
+// the editor's default style
+#define PADDING ((zvec2) { 10, 10 })
+#define CONN_SPACING 20
+
+static zd_node_editor editor;
+static char labels[2][64];
+
+static void frame() {
+    drawn_cnt = 0;
+    zui_window();
+    zui_node_editor(&editor);
+    FOR_VISIBLE_NODES(&editor)
+        zui_label(labels[(size_t)node->uud % 5 == 0]);
+    zui_end();
+    zui_end();
+    zui_render();
+}
+
+static zvec2 origin() {
+    return _vec_add(editor.view.pos, editor.offset);
+}
+static zrect node_rect(zd_node *node) {
+    return _znode_padded_rect(node, origin(), _znode_zoom(&editor), PADDING, CONN_SPACING);
+}
+// zoomed out, laid out to less than a pixel
+static bool subpixel(zd_node *node) {
+    f32 zoom = _znode_zoom(&editor);
+    return znode_lod(&editor) == ZNODE_LOD_RECTS && (node->rect.w || node->rect.h) && node->rect.w * zoom < 1 && node->rect.h * zoom < 1;
+}
+// the link as the editor draws it, false if it isn't drawn: zoomed out only down to ZNODE_LOD_LINKS, between nodes of
+// a pixel or more and when its ends are apart
+static bool link_item(zd_node_link *link, zd_node_item *item) {
+    bool zoomed_out = znode_lod(&editor) == ZNODE_LOD_RECTS;
+    if(zoomed_out && (_znode_zoom(&editor) < ZNODE_LOD_LINKS || subpixel(link->input) || subpixel(link->output))) return false;
+    zrect start = node_rect(link->input), end = node_rect(link->output), tmp;
+    start.y += start.h / (2 * link->input->cnt_in) * (2 * link->id_in + 1);
+    end.y += end.h / (2 * link->output->cnt_out) * (2 * link->id_out + 1);
+    end.x += end.w;
+    i32 dx = abs(start.x - end.x), dy = abs(start.y - end.y);
+    item->rect = (zrect) { min(start.x, end.x) - dx / 4 - 2, min(start.y, end.y) - 2, dx + dx / 2 + 4, dy + 4 };
+    item->start = start.pos;
+    item->end = end.pos;
+    item->shape = zoomed_out ? 2 : start.x > end.x;
+    return _rect_intersect(item->rect, editor.view, &tmp) && !(zoomed_out && start.x == end.x && start.y == end.y);
+}
+static zvec2 port_center(zd_node *node, zrect r, i32 port) {
+    bool input = port < 0;
+    i32 i = input ? -1 - port : port - 1, cnt = input ? node->cnt_in : node->cnt_out;
+    return (zvec2) { input ? r.x : r.x + r.w, r.y + r.h / (cnt * 2) * (2 * i + 1) };
+}
+
+static struct {
+    i32 points, ports, nodes, links, port_over_node, node_over_link, spanning, rects, found, mismatches, map_cells, subpixel;
+} stats;
+
+// what's at <p>, every node, port and link in the order they're drawn
+static zd_node_hit scan_hit(zvec2 p) {
+    zd_node_hit hit = { 0 }, node_hit = { 0 };
+    zd_node_link *link_hit = 0;
+    bool zoomed_out = znode_lod(&editor) == ZNODE_LOD_RECTS;
+    if(!_vec_within(p, editor.view)) return hit;
+    FOR_LINKS(&editor) {
+        zd_node_item item;
+        if(link_item(link, &item) && _vec_within(p, item.rect) && _znode_near_link(&item, p, 4)) link_hit = link;
+    }
+    FOR_NODES(&editor) {
+        zrect r = node_rect(node);
+        if(subpixel(node)) continue;
+        if(_vec_within(p, r)) node_hit = (zd_node_hit) { node };
+        for(i32 port = -node->cnt_in; port <= node->cnt_out && !zoomed_out; port++) {
+            zvec2 c = port_center(node, r, port);
+            zrect square = { c.x - ZNODE_PORT_RADIUS, c.y - ZNODE_PORT_RADIUS, ZNODE_PORT_RADIUS * 2, ZNODE_PORT_RADIUS * 2 };
+            if(port && _vec_within(p, square) && _vec_distsq(p, c) < ZNODE_PORT_RADIUS * ZNODE_PORT_RADIUS)
+                hit = (zd_node_hit) { node, 0, port };
+        }
+    }
+    stats.port_over_node += hit.node && node_hit.node;
+    stats.node_over_link += (hit.node || node_hit.node) && link_hit;
+    if(hit.node) return hit;
+    if(node_hit.node) return node_hit;
+    return (zd_node_hit) { 0, link_hit };
+}
+
+static bool check_point(zvec2 p) {
+    zd_node_hit want = scan_hit(p), got = znode_hit(&editor, p);
+    stats.points++;
+    stats.ports += want.port != 0;
+    stats.nodes += want.node && !want.port;
+    stats.links += want.link != 0;
+    if(want.node == got.node && want.link == got.link && want.port == got.port) return true;
+    if(++stats.mismatches > 20) return false;
+    fprintf(stderr, "hit at %d %d: node %d port %d link %d, scan found node %d port %d link %d\n", p.x, p.y,
+        got.node ? (i32)got.node->id : -1, got.port, got.link ? (i32)got.link->id : -1,
+        want.node ? (i32)want.node->id : -1, want.port, want.link ? (i32)want.link->id : -1);
+    return false;
+}
+
+static i32 cmp_ptr(const void *a, const void *b) {
+    size_t x = *(size_t*)a, y = *(size_t*)b;
+    return x < y ? -1 : x > y;
+}
+static bool check_rect(zrect rect, zd_node **want, zd_node **got) {
+    i32 cnt = 0;
+    zrect clip;
+    if(_rect_intersect(rect, editor.view, &clip)) {
+        FOR_NODES(&editor) {
+            zrect tmp;
+            if(!subpixel(node) && _rect_intersect(node_rect(node), clip, &tmp)) want[cnt++] = node;
+        }
+    }
+    i32 found = znode_query_rect(&editor, rect, got, editor.node_cnt);
+    stats.rects++;
+    stats.found += found;
+    bool ok = found == cnt;
+    if(ok) {
+        // a smaller <out> still gets the count, and the same first nodes
+        zd_node *first[4] = { 0 };
+        ok &= znode_query_rect(&editor, rect, first, cnt / 2 < 4 ? cnt / 2 : 4) == cnt;
+        for(i32 i = 0; i < cnt / 2 && i < 4; i++)
+            ok &= first[i] == got[i];
+        qsort(want, cnt, sizeof(zd_node*), cmp_ptr);
+        qsort(got, cnt, sizeof(zd_node*), cmp_ptr);
+        ok &= !memcmp(want, got, cnt * sizeof(zd_node*));
+    }
+    if(!ok) fprintf(stderr, "rect %d %d %d %d: %d nodes, scan found %d\n", rect.x, rect.y, rect.w, rect.h, found, cnt);
+    return ok;
+}
+
+static void build(i32 n) {
+    for(i32 i = 0; i < n; i++) {
+        // half of them in clusters, so they overlap
+        zvec2 pos = i % 2 ? (zvec2) { rnd() % 4000, rnd() % 2500 } : (zvec2) { i / 20 % 10 * 400 + rnd() % 120, i / 200 * 600 + rnd() % 60 };
+        znode_add(&editor, (void*)(size_t)(i + 1), 0, pos, 1 + rnd() % 6, 1 + rnd() % 3, 0);
+    }
+    for(i32 i = 0; i < n * 2; i++) {
+        zd_node *a = znode_get(&editor, (void*)(size_t)(rnd() % n + 1), 0), *b = znode_get(&editor, (void*)(size_t)(rnd() % n + 1), 0);
+        if(a != b) znode_link(&editor, a, rnd() % a->cnt_out, b, rnd() % b->cnt_in);
+    }
+    // holes in both pools
+    for(i32 i = 0; i < n / 20; i++)
+        znode_del(&editor, (void*)(size_t)(rnd() % n + 1), 0);
+    for(i32 i = 0; i < n / 10; i++) {
+        zd_node_link *link = znode_link_at(&editor, rnd() % editor.links.end);
+        if(link) znode_del_link(&editor, link);
+    }
+}
+
+// what an item in <cell> of the world grid can cover, from the start of its cell to the end of the next one. False
+// for the nodes never laid out, which every query goes through
+static bool cell_region(u32 cell, f32 r[4]) {
+    for(u32 level = 0; level < ZNODE_WORLD_LEVELS; level++) {
+        u32 first = _zworld_level(level), cols = _zworld_cols(level);
+        if(cell >= first + cols * cols) continue;
+        i32 size = ZNODE_WORLD_CELL << level;
+        r[0] = (f32)((cell - first) % cols * size) - ZWORLD_SPAN / 2;
+        r[1] = (f32)((cell - first) / cols * size) - ZWORLD_SPAN / 2;
+        r[2] = r[0] + 2 * size;
+        r[3] = r[1] + 2 * size;
+        return true;
+    }
+    return false;
+}
+// <drawn>, on screen, is inside the part of the graph the item's cell can cover grown by <margin> pixels, so a
+// query around the editor's rect grown by as much finds it
+static bool covered(zd_node_world *w, u32 slot, zrect drawn, i32 margin) {
+    f32 r[4], zoom = _znode_zoom(&editor);
+    zvec2 o = origin();
+    if(slot >= w->ref_cap || w->refs[slot].cell == ~0u) return false;
+    if(!cell_region(w->refs[slot].cell, r)) return true;
+    return (drawn.x - o.x + margin) / zoom >= r[0] - 1 && (drawn.y - o.y + margin) / zoom >= r[1] - 1 &&
+        (drawn.x + drawn.w - o.x - margin) / zoom <= r[2] + 1 && (drawn.y + drawn.h - o.y - margin) / zoom <= r[3] + 1;
+}
+// every node and link is in the grid, laid out nodes not among those never laid out, and what's drawn of them in the
+// editor's rect is where their cells say
+static bool check_world() {
+    bool ok = true;
+    i32 margin = _znode_world_margin(&editor, PADDING, CONN_SPACING);
+    u32 unsized = _zworld_level(ZNODE_WORLD_LEVELS);
+    zrect tmp;
+    FOR_NODES(&editor) {
+        zrect drawn = _rect_pad(node_rect(node), (zvec2) { 10 + ZNODE_PORT_RADIUS, 10 });
+        bool sized = node->rect.w || node->rect.h;
+        ok &= node->id < editor.world.ref_cap && (editor.world.refs[node->id].cell == unsized) == !sized;
+        ok &= !_rect_intersect(drawn, editor.view, &tmp) || covered(&editor.world, node->id, drawn, margin);
+    }
+    FOR_LINKS(&editor) {
+        zd_node_item item;
+        ok &= link->id < editor.link_world.ref_cap && editor.link_world.refs[link->id].cell != ~0u;
+        ok &= !link_item(link, &item) || covered(&editor.link_world, link->id, item.rect, margin * 2);
+    }
+    if(!ok) fprintf(stderr, "a node or link isn't where the world grid has it\n");
+    return ok;
+}
+
+// zoomed out, the map has the cells of the nodes drawn and no others, with those of selected nodes apart, and the
+// rects sent fill each of them once in its color
+static bool check_map() {
+    zrect area = editor.view;
+    u32 cols = (area.w + ZNODE_LOD_CELL - 1) / ZNODE_LOD_CELL, rows = (area.h + ZNODE_LOD_CELL - 1) / ZNODE_LOD_CELL;
+    u32 words = cols / 64 + 1, cells = rows * words;
+    u64 *want = calloc(cells * 2, sizeof(u64));
+    FOR_NODES(&editor) {
+        zrect r = node_rect(node), tmp;
+        if(!_rect_intersect(r, area, &tmp)) continue;
+        if(subpixel(node)) {
+            stats.subpixel++;
+            continue;
+        }
+        u64 *layer = want + (node->flags & ZF_NODE_SELECTED ? cells : 0);
+        for(i32 y = tmp.y; y < tmp.y + tmp.h; y++)
+            for(i32 x = tmp.x; x < tmp.x + tmp.w; x++) {
+                u32 cx = (x - area.x) / ZNODE_LOD_CELL, cy = (y - area.y) / ZNODE_LOD_CELL;
+                layer[cy * words + cx / 64] |= 1ULL << (cx % 64);
+            }
+    }
+    for(u32 i = 0; i < cells; i++) {
+        want[i] &= ~want[cells + i];
+        stats.map_cells += __builtin_popcountll(want[i]) + __builtin_popcountll(want[cells + i]);
+    }
+    bool ok = editor.map_current && editor.map_words >= cells * 2 && !memcmp(want, editor.map, cells * 2 * sizeof(u64));
+    u64 *got = calloc(cells * 2, sizeof(u64));
+    zcolor foreground = zui_stylec(ZW_NODE_EDITOR, ZSC_FOREGROUND), selected = zui_stylec(ZW_NODE_EDITOR, ZSC_NODE_SELECTED);
+    for(i32 i = 0; i < drawn_cnt; i++) {
+        zcmd_rect *r = &drawn[i];
+        bool sel = !memcmp(&r->color, &selected, sizeof(zcolor));
+        if(!sel && memcmp(&r->color, &foreground, sizeof(zcolor))) continue;
+        u64 *layer = got + (sel ? cells : 0);
+        for(i32 y = r->rect.y; y < r->rect.y + r->rect.h; y += ZNODE_LOD_CELL)
+            for(i32 x = r->rect.x; x < r->rect.x + r->rect.w; x += ZNODE_LOD_CELL) {
+                u32 cx = (x - area.x) / ZNODE_LOD_CELL, cy = (y - area.y) / ZNODE_LOD_CELL;
+                u64 bit = 1ULL << (cx % 64);
+                ok &= !(layer[cy * words + cx / 64] & bit);
+                layer[cy * words + cx / 64] |= bit;
+            }
+    }
+    ok &= !memcmp(want, got, cells * 2 * sizeof(u64));
+    if(!ok) fprintf(stderr, "the map doesn't have the cells of the nodes drawn\n");
+    free(want);
+    free(got);
+    return ok;
+}
+
+// moves, adds, links and deletes between frames, so what the editor finds to draw has to follow
+static void edit(i32 n, bool compact) {
+    for(i32 i = 0; i < 40; i++) {
+        zd_node *node = znode_get(&editor, (void*)(size_t)(rnd() % n + 1), 0);
+        if(node) znode_move(&editor, node, (zvec2) { node->rect.x + rnd() % 1200 - 600, node->rect.y + rnd() % 800 - 400 });
+    }
+    for(i32 i = 0; i < 5; i++)
+        znode_add(&editor, (void*)(size_t)(n + rnd() % 100 + 1), 0, (zvec2) { rnd() % 4000, rnd() % 2500 }, 1 + rnd() % 6, 1 + rnd() % 3, 0);
+    for(i32 i = 0; i < 20; i++) {
+        zd_node *a = znode_at(&editor, rnd() % editor.nodes.end), *b = znode_at(&editor, rnd() % editor.nodes.end);
+        if(a && b && a != b) znode_link(&editor, a, rnd() % a->cnt_out, b, rnd() % b->cnt_in);
+    }
+    for(i32 i = 0; i < 10; i++) {
+        zd_node_link *link = znode_link_at(&editor, rnd() % editor.links.end);
+        if(link) znode_del_link(&editor, link);
+    }
+    for(i32 i = 0; i < 3; i++)
+        znode_del(&editor, (void*)(size_t)(rnd() % n + 1), 0);
+    if(compact) znode_compact(&editor);
+}
+
+i32 main(i32 argc, char **argv) {
+    i32 n = argc > 1 ? atoi(argv[1]) : 400;
+    seed = argc > 2 ? atoi(argv[2]) : 1;
+    zui_init(null_renderer, 0, 0);
+    zui_node_register();
+    zui_new_font("null", 16);
+    zui_resize(1280, 720);
+    zui_mouse_move((zvec2) { -100, -100 });
+    memset(labels[0], 'n', 4);
+    memset(labels[1], 'w', 50);
+    build(n);
+
+    struct { f32 zoom; zvec2 offset; } views[] = {
+        { 1, { 0, 0 } }, { 1, { -1500, -900 } }, { 2.5f, { -2000, -1000 } }, { 4, { -9000, -5000 } },
+        { 0.7f, { 40, 30 } }, { 0.4f, { 0, 0 } }, { 0.05f, { 300, 200 } }, { 0.03f, { 500, 300 } },
+    };
+    zd_node **want = malloc(2 * n * sizeof(zd_node*)), **got = malloc(2 * n * sizeof(zd_node*));
+    bool ok = true;
+    i32 far_hits = 0;
+    for(i32 v = 0; v < (i32)(sizeof(views) / sizeof(views[0])); v++) {
+        editor.zoom = views[v].zoom;
+        editor.offset = views[v].offset;
+        if(v) edit(n, v == 3);
+        frame();
+        ok &= check_world();
+        if(views[v].zoom < ZNODE_LOD_FAR) {
+            ok &= check_map();
+            // the map follows the graph, the selection and the view
+            edit(n, false);
+            frame();
+            ok &= check_map();
+            for(i32 i = 0; i < 30; i++) {
+                zd_node *node = znode_at(&editor, rnd() % editor.nodes.end);
+                if(node) node->flags ^= ZF_NODE_SELECTED;
+            }
+            editor.map_current = false;
+            frame();
+            ok &= check_map();
+            editor.offset.x += 7;
+            frame();
+            ok &= check_map();
+            editor.zoom *= 0.9f;
+            frame();
+            ok &= check_map();
+            frame();
+            ok &= check_map();
+        }
+        zrect area = editor.view;
+        i32 before = stats.nodes + stats.links;
+        for(i32 i = 0; i < 3000; i++)
+            ok &= check_point((zvec2) { area.x + 1 + rnd() % (area.w - 2), area.y + 1 + rnd() % (area.h - 2) });
+        // on and around every port, node and link
+        FOR_NODES(&editor) {
+            zrect r = node_rect(node), tmp;
+            if(!_rect_intersect(r, area, &tmp)) continue;
+            stats.spanning += r.x / ZNODE_CELL != (r.x + r.w) / ZNODE_CELL && r.y / ZNODE_CELL != (r.y + r.h) / ZNODE_CELL;
+            ok &= check_point((zvec2) { r.x + r.w / 2, r.y + r.h / 2 });
+            for(i32 port = -node->cnt_in; port <= node->cnt_out; port++) {
+                zvec2 c = port_center(node, r, port);
+                if(port) for(i32 d = -ZNODE_PORT_RADIUS; d <= ZNODE_PORT_RADIUS; d += 5)
+                    ok &= check_point((zvec2) { c.x + d, c.y + d / 2 });
+            }
+        }
+        FOR_LINKS(&editor) {
+            zd_node_item item;
+            zvec2 c[7];
+            if(!link_item(link, &item)) continue;
+            _znode_curve(item.start, item.end, item.shape == 1, c);
+            zvec2 mid = item.shape == 2 ? (zvec2) { (c[0].x + c[3].x) / 2, (c[0].y + c[3].y) / 2 }
+                : (zvec2) { (c[0].x + 3 * c[1].x + 3 * c[2].x + c[3].x) / 8, (c[0].y + 3 * c[1].y + 3 * c[2].y + c[3].y) / 8 };
+            ok &= check_point(mid);
+            ok &= check_point((zvec2) { mid.x + 3, mid.y - 2 });
+        }
+        // outside the editor nothing is hit
+        zd_node_hit outside = znode_hit(&editor, (zvec2) { area.x - 5, area.y + area.h + 40 });
+        ok &= !outside.node && !outside.link;
+        if(views[v].zoom < ZNODE_LOD_FAR) far_hits += stats.nodes + stats.links - before;
+
+        ok &= check_rect(area, want, got);
+        for(i32 i = 0; i < 300; i++) {
+            zrect r = { area.x - 100 + rnd() % (area.w + 200), area.y - 100 + rnd() % (area.h + 200), rnd() % 600, rnd() % 400 };
+            ok &= check_rect(r, want, got);
+        }
+    }
+    // each kind of overlap was met
+    ok &= stats.ports && stats.nodes && stats.links && stats.port_over_node && stats.node_over_link && stats.spanning && far_hits;
+    ok &= stats.map_cells && stats.subpixel;
+    printf("{\"nodes\":%u,\"links\":%u,\"views\":%d,\"points\":%d,\"hits\":{\"ports\":%d,\"nodes\":%d,\"links\":%d,\"far\":%d},",
+        editor.node_cnt, editor.link_cnt, (i32)(sizeof(views) / sizeof(views[0])), stats.points, stats.ports, stats.nodes,
+        stats.links, far_hits);
+    printf("\"port_over_node\":%d,\"node_over_link\":%d,\"spanning_nodes\":%d,\"rects\":%d,\"found\":%d,",
+        stats.port_over_node, stats.node_over_link, stats.spanning, stats.rects, stats.found);
+    printf("\"map_cells\":%d,\"subpixel_nodes\":%d,\"ok\":%s}\n", stats.map_cells, stats.subpixel, ok ? "true" : "false");
+    free(want);
+    free(got);
+    free(drawn);
+    znode_free(&editor);
+    zui_close();
+    return !ok;
+}
@@ -0,0 +1,116 @@
+// Lazy labelf test.
+// Formats labels with zui_labelf_lazy and checks the text drawn at zui_render against snprintf of the same arguments:
+// flags, width and precision given inline and by '*', '%%' and every length modifier, then that a spec with more
+// than two '*' prints nothing without throwing off the arguments after it. Then checks the layout width: measured
+// from the text with Z_AUTO, the fixed width otherwise, narrower than the text or not, where the text is cut off.
+// Prints one JSON object, exits with 1 on a mismatch.
+//
+// usage: labelf-test
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "../../src/zui.h"
+
+// the text commands of the last frame
+static char texts[8][256];
+static i16 text_x[8];
+static i32 text_cnt;
+
+static void null_renderer(zcmd_any *cmd, void *user_data) {
+    switch(cmd->base.id) {
+        case ZCMD_DRAW_TEXT:
+            if(text_cnt < 8) {
+                i32 len = cmd->base.bytes - sizeof(zcmd_text);
+                memcpy(texts[text_cnt], cmd->text.text, len);
+                texts[text_cnt][len] = 0;
+                text_x[text_cnt++] = cmd->text.pos.x;
+            }
+            break;
+        case ZCMD_REG_FONT: cmd->font.response_height = 16; break;
+        case ZCMD_GLYPH_SZ: cmd->glyph_sz.response = (zvec2) { 6 + cmd->glyph_sz.codepoint % 4, 16 }; break;
+        case ZCMD_GET_CLIPBOARD: cmd->get_clipboard.response = ""; break;
+    }
+}
+
+static i32 checks, failed;
+
+static void check(bool ok, const char *what, const char *got, const char *want) {
+    checks++;
+    if(ok) return;
+    failed++;
+    fprintf(stderr, "%s: got \"%s\", want \"%s\"\n", what, got, want);
+}
+
+// one frame with a lazy label, its drawn text against <want>
+#define CASE(fmt, ...) do { \
+        char want[256]; \
+        snprintf(want, sizeof(want), fmt, __VA_ARGS__); \
+        EXPECT(want, fmt, __VA_ARGS__); \
+    } while(0)
+#define EXPECT(want, fmt, ...) do { \
+        text_cnt = 0; \
+        zui_window(); \
+        zui_labelf_lazy(Z_AUTO, fmt, __VA_ARGS__); \
+        zui_end(); \
+        zui_render(); \
+        check(text_cnt == (*(want) != 0) && (!text_cnt || !strcmp(texts[0], want)), fmt, text_cnt ? texts[0] : "", want); \
+    } while(0)
+
+// the distance from a label to the one after it in a row. <cut> if the label is narrower than its text
+static i32 advance(i16 fixed_width, char *text, bool cut) {
+    text_cnt = 0;
+    zui_window();
+    zui_row(2, Z_AUTO, Z_AUTO); {
+        zui_labelf_lazy(fixed_width, "%s", text);
+        zui_label("|");
+    } zui_end();
+    zui_end();
+    zui_render();
+    i32 len = text_cnt == 2 ? strlen(texts[0]) : 0;
+    check(text_cnt == 2 && (cut ? len < (i32)strlen(text) : len == (i32)strlen(text)) && !strncmp(texts[0], text, len),
+        "fixed width text", text_cnt ? texts[0] : "", text);
+    return text_cnt == 2 ? text_x[1] - text_x[0] : 0;
+}
+
+i32 main(i32 argc, char **argv) {
+    zui_init(null_renderer, 0, 0);
+    zui_new_font("null", 16);
+    zui_resize(1280, 720);
+
+    CASE("%d%%", 42);
+    CASE("100%% of %s", "it");
+    CASE("[%5d|%-5d|%05d|%+d|% d]", 42, 42, 42, 42, 42);
+    CASE("[%8.3f|%-8.2e|%g|%#.0f|%a]", 3.14159, 31415.9, 0.0001, 2.0, 1.5);
+    CASE("[%c|%5s|%-5s|%.2s]", 'x', "ab", "ab", "abcdef");
+    CASE("[%o|%x|%X|%#x|%u]", 8u, 255u, 255u, 255u, 4000000000u);
+    CASE("%p", (void*)&checks);
+    // '*' width and precision, negative widths left align
+    CASE("[%*d|%-*d|%*d]", 6, -12, 6, -12, -6, 7);
+    CASE("[%.*f|%*.*f|%-*.*s]", 2, 2.71828, 10, 3, 2.5, 8, 3, "abcdef");
+    CASE("[%*s|%.*d]", 4, "x", 5, 42);
+    // length modifiers, narrow ones truncate
+    CASE("[%hhd|%hhu|%hd|%hu]", 300, 300, 70000, 70000);
+    CASE("[%ld|%lu|%lx]", -1234567890L, 3000000000UL, 0xdeadbeefUL);
+    CASE("[%lld|%llu|%llx]", -9000000000000000000LL, 18000000000000000000ULL, 0x123456789abcdefULL);
+    CASE("[%zu|%zd|%td|%jd|%ju]", (size_t)123456789012, (ptrdiff_t)-5, (ptrdiff_t)-77, (intmax_t)-1, (uintmax_t)99);
+    CASE("[%Lf|%Lg|%lf]", (long double)1.25, (long double)1e20, 0.5);
+    CASE("[%*hd|%-*.*lld]", 7, 70000, 12, 4, -42LL);
+    // more than two '*' prints nothing, but takes its '*' and its value off the arguments
+    EXPECT("|5", "%***d|%d", 1, 2, 3, 4, 5);
+    EXPECT("|7|x", "%***f|%d|%s", 1, 2, 3, 2.5, 7, "x");
+    EXPECT("a|b", "%s%****lld|%s", "a", 1, 2, 3, 4, 9LL, "b");
+
+    // Z_AUTO is measured from the text, a fixed width is used as is, even narrower than the text
+    char *text = "lazily measured";
+    i32 gap = advance(Z_AUTO, text, false) - zui_text_width(0, text, strlen(text));
+    i32 wide = advance(300, text, false), narrow = advance(10, text, true);
+    char got[64], want[64];
+    snprintf(got, sizeof(got), "%d %d", wide, narrow);
+    snprintf(want, sizeof(want), "%d %d", 300 + gap, 10 + gap);
+    check(wide == 300 + gap && narrow == 10 + gap, "fixed width advance", got, want);
+
+    printf("{\"checks\":%d,\"failed\":%d,\"ok\":%s}\n", checks, failed, failed ? "false" : "true");
+    return failed ? 1 : 0;
+}
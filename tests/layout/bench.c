@@ -0,0 +1,118 @@
+// Layout benchmark.
+// Lays out imported-style graphs of each size, every node at 0 0 without a size: mostly local links, to one of the
+// previous 400 nodes, and a few longer ones. Then adds a node and a link and lays the graph out again incrementally.
+// Checks that every link goes left to right, that nodes of a column don't overlap (once scaled, that they're spaced
+// by their scaled height) and that crossing reduction never adds crossings. Prints one JSON object per size, exits
+// with 1 on a failed check.
+//
+// usage: layout-bench [nodes...]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include "../../src/zui-layout.h"
+
+void print_link(zd_node_link *link) {}
+void print_node(zd_node *node) {}
+
+static u64 bench_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static u32 seed = 1;
+static u32 rnd() {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 8;
+}
+
+static void build(zd_node_editor *editor, i32 n) {
+    for(i32 i = 0; i < n; i++) {
+        zd_node *node = znode_add(editor, (void*)(size_t)(i + 1), 0, (zvec2) { 0 }, 2, 2, 0);
+        for(i32 k = 0; k < 2 && i; k++) {
+            i32 reach = rnd() % 50 ? 400 : 2000;
+            i32 from = i - 1 - rnd() % (i < reach ? i : reach);
+            znode_link(editor, znode_get(editor, (void*)(size_t)(from + 1), 0), k, node, k);
+        }
+    }
+}
+
+static i32 cmp_i64(const void *a, const void *b) {
+    i64 x = *(i64*)a, y = *(i64*)b;
+    return x < y ? -1 : x > y;
+}
+
+// links go left to right, nodes of the default size are at least their height and the row gap apart
+static bool check(zd_node_editor *editor, zlayout_stats *stats) {
+    bool ok = stats->crossings <= stats->crossings_before;
+    FOR_LINKS(editor)
+        ok &= link->output->rect.x < link->input->rect.x;
+    i64 apart = (i64)((60 + 20) * stats->scale) - 1;
+    // sorted by column then height
+    i32 n = 0;
+    i64 *keys = malloc(editor->node_cnt * sizeof(i64));
+    FOR_NODES(editor)
+        keys[n++] = (i64)node->rect.x << 32 | (u32)(node->rect.y + 32768);
+    qsort(keys, n, sizeof(i64), cmp_i64);
+    for(i32 i = 1; i < n; i++)
+        ok &= keys[i] >> 32 != keys[i - 1] >> 32 || (keys[i] & 0xFFFFFFFF) - (keys[i - 1] & 0xFFFFFFFF) >= apart;
+    free(keys);
+    return ok;
+}
+
+static void run(i32 n, bool first) {
+    static zd_node_editor editor;
+    znode_free(&editor);
+    build(&editor, n);
+    zlayout *l = zlayout_new(0);
+
+    u64 start = bench_ns();
+    bool ok = zlayout_run(l, &editor);
+    u64 snapshot_ns = bench_ns() - start;
+    u32 polls = 0;
+    while(zlayout_state(l) == ZLAYOUT_RUNNING) {
+        polls++;
+        sched_yield();
+    }
+    u64 full_ns = bench_ns() - start;
+    start = bench_ns();
+    i32 moved = zlayout_apply(l, &editor);
+    u64 apply_ns = bench_ns() - start;
+    zlayout_stats full = *zlayout_get_stats(l);
+    ok &= moved == n && check(&editor, &full);
+
+    // a new node fed by one in the middle of the graph
+    zd_node *node = znode_add(&editor, (void*)(size_t)(n + 1), 0, (zvec2) { 0 }, 2, 2, 0);
+    znode_link(&editor, znode_get(&editor, (void*)(size_t)(n / 2), 0), 0, node, 0);
+    start = bench_ns();
+    ok &= zlayout_run(l, &editor) && zlayout_wait(l) == ZLAYOUT_DONE;
+    i32 moved_again = zlayout_apply(l, &editor);
+    u64 incremental_ns = bench_ns() - start;
+    zlayout_stats again = *zlayout_get_stats(l);
+    ok &= check(&editor, &again) && again.changed < (u32)n / 100 && moved_again < n;
+    zlayout_free(l);
+
+    printf("%s{\"nodes\":%u,\"links\":%u,\"columns\":%u,\"placeholders\":%u,\"full_ms\":%.2f,\"layout_ms\":%.2f,",
+        first ? "" : ",\n", full.nodes, full.links, full.columns, full.placeholders, full_ns / 1e6, full.ns / 1e6);
+    printf("\"ui_ms\":{\"snapshot\":%.2f,\"apply\":%.2f},\"polls\":%u,\"crossings\":{\"before\":%llu,\"after\":%llu},",
+        snapshot_ns / 1e6, apply_ns / 1e6, polls, full.crossings_before, full.crossings);
+    printf("\"incremental\":{\"ms\":%.2f,\"changed\":%u,\"columns_redone\":%u,\"moved\":%d},\"scale\":%.3f,\"ok\":%s}",
+        incremental_ns / 1e6, again.changed, again.columns_redone, moved_again, full.scale, ok ? "true" : "false");
+    fflush(stdout);
+    if(!ok) exit(1);
+}
+
+i32 main(i32 argc, char **argv) {
+    printf("[\n");
+    if(argc > 1) {
+        for(i32 i = 1; i < argc; i++)
+            run(atoi(argv[i]) < 100 ? 100 : atoi(argv[i]), i == 1);
+    } else {
+        i32 sizes[] = { 10000, 20000, 50000 };
+        for(i32 i = 0; i < 3; i++)
+            run(sizes[i], i == 0);
+    }
+    printf("\n]\n");
+}
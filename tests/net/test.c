@@ -0,0 +1,135 @@
+// Loopback test of the net backend.
+// The server runs a small UI, a client thread connects over 127.0.0.1, draws the received frames with the
+// headless backend and clicks the second tab. Checks that the client received exactly what the server sent,
+// that the server's glyph estimates were replaced by the client's metrics and that the click got through.
+#define ZUI_IMPL
+#include "../../src/zui.h"
+#include "../../backends/headless/zui-headless.h"
+#include "../../backends/net/zui-net.h"
+#include <stdio.h>
+#include <pthread.h>
+
+static char *font = "Consolas";
+static u16 port = 47150;
+static u64 server_hash, client_hash;
+static i32 server_width, client_width;
+static bool clicked;
+
+// the server side renderer hashes each frame the same way the headless backend does
+static void server_renderer(zcmd_any *cmd, void *user_data) {
+    static u64 hash;
+    switch(cmd->base.id) {
+        case ZCMD_RENDER_BEGIN: hash = 0xCBF29CE484222325ULL; break;
+        case ZCMD_RENDER_END: server_hash = hash; break;
+        case ZCMD_DRAW_CLIP:
+        case ZCMD_DRAW_RECT:
+        case ZCMD_DRAW_TEXT:
+        case ZCMD_DRAW_LINES:
+        case ZCMD_DRAW_BEZIER:
+            for(i32 i = 0; i < cmd->base.bytes; i++)
+                hash = (hash ^ ((u8*)cmd)[i]) * 0x100000001B3ULL;
+            break;
+    }
+    net_renderer(cmd, user_data);
+}
+
+static void init(void *user_data) {
+    zui_new_font(font, 16);
+}
+
+static void frame(void *user_data) {
+    static i32 tab = 0;
+    zui_window(); {
+        zui_col(2, Z_AUTO, Z_AUTO); {
+            zui_label("Hello!");
+            zui_tabset("One,Two", &tab); {
+                zui_label("first tab");
+                zui_label("second tab");
+            } zui_end();
+        } zui_end();
+    } zui_end();
+    zui_render();
+}
+
+static void finish(void *user_data) {
+    server_width = zui_text_width(0, "Hello!", -1);
+}
+
+// finds a text command of the last frame the client drew
+static zcmd_text *find_text(char *text) {
+    i32 len, n = strlen(text);
+    u8 *cmds = headless_frame(&len);
+    for(i32 i = 0; i < len; i += ((zcmd*)(cmds + i))->bytes) {
+        zcmd_text *cmd = (zcmd_text*)(cmds + i);
+        if(cmd->header.id == ZCMD_DRAW_TEXT && cmd->header.bytes - sizeof(zcmd_text) == n && !memcmp(cmd->text, text, n))
+            return cmd;
+    }
+    return 0;
+}
+
+static void *client_main(void *arg) {
+    zui_headless_args *args = arg;
+    zui_net_client client;
+    bool connected = false;
+    for(i32 i = 0; i < 200 && !(connected = net_client_connect(&client, "127.0.0.1", port, headless_renderer, args)); i++)
+        usleep(10000);
+    if(!connected) {
+        printf("client: couldn't connect\n");
+        return 0;
+    }
+    net_client_push(&client, (zccmd*)&(zccmd_win) { { ZCCMD_WIN, sizeof(zccmd_win) }, { 300, 200 } });
+    zvec2 tab = { 0 };
+    for(i32 n; (n = net_client_poll(&client, 2000)) >= 0;) {
+        if(n == 0) {
+            printf("client: timed out\n");
+            break;
+        }
+        printf("client: frame %d, %d commands, hash %016llx\n", client.frames, headless_frame_cmds(), headless_frame_hash());
+        if(client.frames == 2) {
+            // the first frame used estimates, the second the client's metrics
+            zcmd_text *two = find_text("Two");
+            if(!two) break;
+            tab = (zvec2) { two->pos.x + 2, two->pos.y + 2 };
+            net_client_push(&client, (zccmd*)&(zccmd_mouse) { { ZCCMD_MOUSE, sizeof(zccmd_mouse) }, tab, 0 });
+            net_client_push(&client, (zccmd*)&(zccmd_mouse) { { ZCCMD_MOUSE, sizeof(zccmd_mouse) }, tab, ZM_LEFT_CLICK });
+        } else if(client.frames == 3) {
+            net_client_push(&client, (zccmd*)&(zccmd_mouse) { { ZCCMD_MOUSE, sizeof(zccmd_mouse) }, tab, 0 });
+        } else if(client.frames >= 4) {
+            clicked = find_text("second tab") && !find_text("first tab");
+            client_hash = headless_frame_hash();
+            for(char *c = "Hello!"; *c; c++) {
+                zcmd_any sz = { .glyph_sz = { { ZCMD_GLYPH_SZ, sizeof(zcmd_glyph_sz) }, 0, *c } };
+                headless_renderer(&sz, args);
+                client_width += sz.glyph_sz.response.x;
+            }
+            break;
+        }
+    }
+    net_client_close(&client);
+    return 0;
+}
+
+void LOG(char *fmt, va_list args, void *user_data) { vprintf(fmt, args); }
+
+// usage: net-test [font.ttf] [port]
+i32 main(i32 argc, char **argv) {
+    if(argc > 1) font = argv[1];
+    if(argc > 2) port = atoi(argv[2]);
+    zui_headless_args client_args = { .fallback_metrics = true, .record = true };
+    pthread_t client;
+    pthread_create(&client, 0, client_main, &client_args);
+    zui_init(server_renderer, LOG, &(zui_net_args) {
+        .host = "127.0.0.1",
+        .port = port,
+        .init = init,
+        .frame = frame,
+        .close = finish
+    });
+    pthread_join(client, 0);
+    zui_close();
+    printf("server hash %016llx, client hash %016llx\n", server_hash, client_hash);
+    printf("\"Hello!\" width: server %d, client %d\n", server_width, client_width);
+    bool ok = server_hash == client_hash && server_width == client_width && clicked;
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
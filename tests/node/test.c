@@ -0,0 +1,496 @@
+// Node graph test.
+// Runs random adds, deletes (one at a time, by uud and in batches listing things twice), links, unlinks and compacts
+// against a brute-force model of the graph, and after every few operations checks znode_get, every node's input and
+// output lists, znode_at and the counts against it. Uuds are drawn from a small set so that nodes shadow each other
+// in the index. Every link znode_link refuses must be a duplicate, break ZF_NODE_1IN / 1OUT or close a cycle, found by
+// searching the model, and the topological order must put every link's output before its input.
+// Then mirrors a second graph through the journal, see journal_test.
+// Prints one JSON object, exits with 1 on any difference.
+//
+// usage: node-test [operations] [seed]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../src/zui-node.h"
+
+#define UUDS 48
+
+typedef struct model_node {
+    bool live;
+    void *uud;
+    i32 uud_type;
+    i32 in, out, flags;
+    zd_node *node;   // found again after znode_compact
+} model_node;
+
+typedef struct model_link {
+    bool live;
+    u32 output, input; // model nodes
+    i32 id_out, id_in;
+} model_link;
+
+static model_node *nodes;
+static model_link *links;
+static u32 node_cnt, link_cnt, node_cap, link_cap;
+static zd_node_editor editor;
+static u32 seed = 1, failures;
+static u32 rnd() {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 8;
+}
+
+#define CHECK(cond, ...) do { if(!(cond)) { if(failures++ < 10) { printf(__VA_ARGS__); printf("\n"); } } } while(0)
+
+void print_link(zd_node_link *link) {}
+void print_node(zd_node *node) {}
+
+// the model node of an editor node, kept in its result
+static u32 handle(zd_node *node) {
+    return (u32)(size_t)node->result - 1;
+}
+
+static void del_model_node(u32 h) {
+    nodes[h].live = false;
+    for(u32 i = 0; i < link_cnt; i++)
+        if(links[i].live && (links[i].output == h || links[i].input == h)) links[i].live = false;
+}
+
+static void del_model_link(zd_node_link *link) {
+    u32 out = handle(link->output), in = handle(link->input);
+    for(u32 i = 0; i < link_cnt; i++)
+        if(links[i].live && links[i].output == out && links[i].input == in && links[i].id_out == link->id_out && links[i].id_in == link->id_in) {
+            links[i].live = false;
+            return;
+        }
+    CHECK(0, "deleted a link the model doesn't have");
+}
+
+// a random live node of the model, -1 if there's none
+static i32 any_node() {
+    if(!node_cnt) return -1;
+    for(i32 tries = 0; tries < 16; tries++) {
+        u32 h = rnd() % node_cnt;
+        if(nodes[h].live) return h;
+    }
+    return -1;
+}
+
+static zd_node_link *any_link() {
+    i32 h = any_node();
+    if(h < 0) return 0;
+    bool inputs = rnd() % 2;
+    zd_node_link *link = inputs ? nodes[h].node->inputs : nodes[h].node->outputs;
+    for(u32 skip = rnd() % 3; link && skip; skip--)
+        link = inputs ? link->next_in : link->next_out;
+    return link;
+}
+
+// the newest live model node with <uud> and <uud_type>
+static i32 newest(void *uud, i32 uud_type) {
+    for(i32 h = node_cnt - 1; h >= 0; h--)
+        if(nodes[h].live && nodes[h].uud == uud && nodes[h].uud_type == uud_type) return h;
+    return -1;
+}
+
+static u32 model_links(u32 out, i32 id_out, u32 in, i32 id_in) {
+    u32 cnt = 0;
+    for(u32 i = 0; i < link_cnt; i++)
+        cnt += links[i].live && links[i].output == out && links[i].input == in && links[i].id_out == id_out && links[i].id_in == id_in;
+    return cnt;
+}
+
+// whether <to> can be reached from <from> along the model's links
+static bool reaches(u32 from, u32 to) {
+    static u32 *start, *next, *stack;
+    static u8 *seen;
+    start = realloc(start, (node_cnt + 2) * sizeof(u32));
+    next = realloc(next, (link_cnt + 1) * sizeof(u32));
+    stack = realloc(stack, (node_cnt + 1) * sizeof(u32));
+    seen = realloc(seen, node_cnt + 1);
+    memset(start, 0, (node_cnt + 2) * sizeof(u32));
+    memset(seen, 0, node_cnt + 1);
+    for(u32 i = 0; i < link_cnt; i++)
+        if(links[i].live) start[links[i].output + 2]++;
+    for(u32 h = 0; h < node_cnt; h++)
+        start[h + 2] += start[h + 1];
+    for(u32 i = 0; i < link_cnt; i++)
+        if(links[i].live) next[start[links[i].output + 1]++] = links[i].input;
+    u32 cnt = 0;
+    stack[cnt++] = from;
+    seen[from] = 1;
+    while(cnt) {
+        u32 h = stack[--cnt];
+        if(h == to) return true;
+        for(u32 i = start[h]; i < start[h + 1]; i++)
+            if(!seen[next[i]]) {
+                seen[next[i]] = 1;
+                stack[cnt++] = next[i];
+            }
+    }
+    return false;
+}
+
+// whether the model has a link on the port
+static bool port_used(u32 h, i32 id, bool input) {
+    for(u32 i = 0; i < link_cnt; i++)
+        if(links[i].live && (input ? links[i].input == h && links[i].id_in == id : links[i].output == h && links[i].id_out == id))
+            return true;
+    return false;
+}
+
+static u64 link_key(u32 out, i32 id_out, u32 in, i32 id_in) {
+    return (u64)out << 40 | (u64)in << 16 | id_out << 8 | id_in;
+}
+
+static i32 cmp_u64(const void *a, const void *b) {
+    u64 x = *(u64*)a, y = *(u64*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void check(u32 op) {
+    u32 live_nodes = 0, live_links = 0;
+    u32 *ins = calloc(node_cnt + 1, sizeof(u32)), *outs = calloc(node_cnt + 1, sizeof(u32));
+    u64 *keys = malloc((link_cnt + 1) * sizeof(u64)), *got = malloc((editor.link_cnt + 1) * sizeof(u64));
+    for(u32 h = 0; h < node_cnt; h++)
+        live_nodes += nodes[h].live;
+    for(u32 i = 0; i < link_cnt; i++) {
+        if(!links[i].live) continue;
+        keys[live_links++] = link_key(links[i].output, links[i].id_out, links[i].input, links[i].id_in);
+        ins[links[i].input]++;
+        outs[links[i].output]++;
+    }
+    CHECK(editor.node_cnt == (i32)live_nodes && editor.link_cnt == (i32)live_links, "op %u: %d nodes %d links, model %u %u",
+        op, editor.node_cnt, editor.link_cnt, live_nodes, live_links);
+
+    u32 seen = 0, seen_links = 0;
+    FOR_NODES(&editor) {
+        u32 h = handle(node);
+        seen++;
+        CHECK(h < node_cnt && nodes[h].live && nodes[h].node == node, "op %u: node not in the model", op);
+        if(h >= node_cnt) continue;
+        CHECK(znode_at(&editor, node->id) == node && node->uud == nodes[h].uud && node->cnt_in == nodes[h].in, "op %u: node %u differs", op, h);
+        // both lists and their back pointers, the links themselves are compared below
+        u32 in_cnt = 0, out_cnt = 0;
+        zd_node_link *prev = 0;
+        FOR_INPUTS(node) {
+            CHECK(link->input == node && link->prev_in == prev && znode_link_at(&editor, link->id) == link, "op %u: bad input list", op);
+            prev = link;
+            in_cnt++;
+        }
+        prev = 0;
+        FOR_OUTPUTS(node) {
+            CHECK(link->output == node && link->prev_out == prev, "op %u: bad output list", op);
+            prev = link;
+            out_cnt++;
+        }
+        CHECK(in_cnt == ins[h] && out_cnt == outs[h], "op %u: node %u has %u/%u links, model %u/%u", op, h, in_cnt, out_cnt, ins[h], outs[h]);
+    }
+    CHECK(seen == live_nodes, "op %u: FOR_NODES saw %u nodes", op, seen);
+    FOR_LINKS(&editor) {
+        CHECK(link->output->ord < link->input->ord, "op %u: link against the topological order", op);
+        if(seen_links < (u32)editor.link_cnt) got[seen_links++] = link_key(handle(link->output), link->id_out, handle(link->input), link->id_in);
+    }
+    // znode_toposort lists every node once, and outputs before their inputs
+    zd_node **order = malloc((editor.node_cnt + 1) * sizeof(zd_node*));
+    u8 *placed = calloc(node_cnt + 1, 1);
+    i32 cnt = znode_toposort(&editor, order);
+    CHECK(cnt == editor.node_cnt, "op %u: znode_toposort gave %d nodes", op, cnt);
+    for(i32 i = 0; i < cnt; i++) {
+        FOR_INPUTS(order[i])
+            CHECK(placed[handle(link->output)], "op %u: znode_toposort has an input after its node", op);
+        placed[handle(order[i])] = 1;
+    }
+    free(order);
+    free(placed);
+    CHECK(seen_links == live_links, "op %u: FOR_LINKS saw %u links", op, seen_links);
+    qsort(keys, live_links, sizeof(u64), cmp_u64);
+    qsort(got, seen_links, sizeof(u64), cmp_u64);
+    CHECK(seen_links != live_links || !memcmp(keys, got, live_links * sizeof(u64)), "op %u: the links differ", op);
+
+    for(u32 u = 0; u < UUDS; u++)
+        for(i32 type = 0; type < 2; type++) {
+            void *uud = (void*)(size_t)(u + 1);
+            i32 h = newest(uud, type);
+            zd_node *node = znode_get(&editor, uud, type);
+            CHECK(h < 0 ? !node : node == nodes[h].node, "op %u: znode_get(%u, %d) isn't the newest", op, u, type);
+        }
+    free(ins);
+    free(outs);
+    free(keys);
+    free(got);
+}
+
+// Journal: a second graph with a uud of its own for every node, mirrored by uud through znode_journal_read while
+// random edits go on, compacted and reloaded every few rounds, and compared with the graph after each round
+#define JOURNAL_CAP 4096
+#define JOURNAL_OPS 40
+static zd_node_editor journaled;
+static struct {
+    u32 n;              // uuds handed out, 1..n
+    bool *live;
+    u32 *slot;
+    zvec2 *pos;
+    i32 *in_cnt;
+    u64 *in_sum;        // of the hashes of the node's input links, a set compared in one number
+    u64 cursor;
+} mirror;
+
+static u64 link_hash(void *out_uud, i32 id_out, i32 id_in) {
+    u64 h = (u64)(size_t)out_uud * 0x9E3779B97F4A7C15ull ^ (u64)(u32)id_out << 32 ^ (u32)id_in;
+    h = (h ^ h >> 31) * 0xBF58476D1CE4E5B9ull;
+    return h ^ h >> 29;
+}
+
+static void mirror_resync() {
+    memset(mirror.live, 0, mirror.n * sizeof(bool));
+    memset(mirror.in_cnt, 0, mirror.n * sizeof(i32));
+    memset(mirror.in_sum, 0, mirror.n * sizeof(u64));
+    FOR_NODES(&journaled) {
+        u32 u = (u32)(size_t)node->uud - 1;
+        mirror.live[u] = true;
+        mirror.slot[u] = node->id;
+        mirror.pos[u] = node->rect.pos;
+    }
+    FOR_LINKS(&journaled) {
+        u32 u = (u32)(size_t)link->input->uud - 1;
+        mirror.in_cnt[u]++;
+        mirror.in_sum[u] += link_hash(link->output->uud, link->id_out, link->id_in);
+    }
+    mirror.cursor = journaled.journal.head;
+}
+
+// applies the events since the last read, <seen> counts them by kind
+static void mirror_read(u32 *seen) {
+    zd_node_event events[64];
+    i32 cnt;
+    while((cnt = znode_journal_read(&journaled, &mirror.cursor, events, 64))) {
+        CHECK(cnt > 0, "journal: the mirror fell behind");
+        if(cnt < 0) {
+            mirror_resync();
+            continue;
+        }
+        for(i32 i = 0; i < cnt; i++) {
+            zd_node_event *ev = &events[i];
+            u32 u = (u32)(size_t)ev->uud - 1, v = (u32)(size_t)ev->input_uud - 1;
+            seen[ev->kind]++;
+            switch(ev->kind) {
+                case ZNODE_EV_ADD: mirror.live[u] = true; mirror.slot[u] = ev->node; // fallthrough
+                case ZNODE_EV_MOVE: mirror.pos[u] = ev->pos; break;
+                case ZNODE_EV_DEL: mirror.live[u] = false; break;
+                case ZNODE_EV_LINK: mirror.in_cnt[v]++; mirror.in_sum[v] += link_hash(ev->uud, ev->out, ev->in); break;
+                case ZNODE_EV_UNLINK: mirror.in_cnt[v]--; mirror.in_sum[v] -= link_hash(ev->uud, ev->out, ev->in); break;
+                // the uuds still hold, only the slots moved
+                case ZNODE_EV_COMPACT:
+                    FOR_NODES(&journaled)
+                        mirror.slot[(size_t)node->uud - 1] = node->id;
+                    break;
+                // the whole graph is new, the events after it are already in it
+                case ZNODE_EV_LOAD: mirror_resync(); i = cnt; break;
+            }
+        }
+    }
+}
+
+static void mirror_check(u32 round) {
+    u32 live = 0;
+    for(u32 u = 0; u < mirror.n; u++)
+        live += mirror.live[u];
+    CHECK(live == (u32)journaled.node_cnt, "journal round %u: the mirror has %u nodes, the graph %d", round, live, journaled.node_cnt);
+    FOR_NODES(&journaled) {
+        u32 u = (u32)(size_t)node->uud - 1, cnt = 0;
+        u64 sum = 0;
+        FOR_INPUTS(node) {
+            cnt++;
+            sum += link_hash(link->output->uud, link->id_out, link->id_in);
+        }
+        CHECK(mirror.live[u] && mirror.slot[u] == node->id && mirror.pos[u].x == node->rect.x && mirror.pos[u].y == node->rect.y,
+            "journal round %u: node %u differs", round, u + 1);
+        CHECK(mirror.in_cnt[u] == (i32)cnt && mirror.in_sum[u] == sum, "journal round %u: node %u's inputs differ", round, u + 1);
+    }
+}
+
+// a random live node of the journaled graph, or 0
+static zd_node *any_journaled() {
+    return journaled.nodes.end ? znode_at(&journaled, rnd() % journaled.nodes.end) : 0;
+}
+
+// Also keeps a log of every event, read each round, and a consumer that reads nothing until the end: it must get -1
+// with its cursor on the oldest event kept, then read on the same events as the log. Returns how many events were
+// recorded, <seen> counts the mirror's by kind
+static u64 journal_test(u32 rounds, u32 *seen) {
+    znode_journal(&journaled, JOURNAL_CAP);
+    u32 cap = rounds * JOURNAL_OPS;
+    mirror.live = calloc(cap, sizeof(bool));
+    mirror.slot = calloc(cap, sizeof(u32));
+    mirror.pos = calloc(cap, sizeof(zvec2));
+    mirror.in_cnt = calloc(cap, sizeof(i32));
+    mirror.in_sum = calloc(cap, sizeof(u64));
+    mirror.cursor = journaled.journal.head;
+    u64 slow = journaled.journal.head, log_cursor = slow, log_cap = 4096;
+    zd_node_event *log = malloc(log_cap * sizeof(zd_node_event));
+    i32 cnt;
+
+    for(u32 round = 0; round < rounds && !failures; round++) {
+        for(u32 op = 0; op < JOURNAL_OPS; op++) {
+            u32 kind = rnd() % 100;
+            zd_node *a = any_journaled(), *b = any_journaled();
+            if(kind < 30 || !a) {
+                zvec2 pos = { rnd() % 1000, rnd() % 1000 };
+                znode_add(&journaled, (void*)(size_t)++mirror.n, 0, pos, 1 + rnd() % 3, 1 + rnd() % 3, 0);
+            } else if(kind < 60) {
+                if(b) znode_link(&journaled, a, rnd() % a->cnt_out, b, rnd() % b->cnt_in);
+            } else if(kind < 70) {
+                if(a->inputs) znode_del_link(&journaled, a->inputs);
+            } else if(kind < 80) {
+                znode_del_node(&journaled, a);
+            } else {
+                znode_move(&journaled, a, (zvec2) { a->rect.x + 1, a->rect.y - 1 });
+            }
+        }
+        if(round % 10 == 9) znode_compact(&journaled);
+        if(round % 25 == 24) {
+            u64 len = znode_save(&journaled, 0, 0);
+            void *data = malloc(len);
+            znode_save(&journaled, data, len);
+            CHECK(znode_load(&journaled, data, len, 0, 0), "journal round %u: znode_load failed", round);
+            free(data);
+        }
+        while(journaled.journal.head > log_cap) log = realloc(log, (log_cap *= 2) * sizeof(zd_node_event));
+        while((cnt = znode_journal_read(&journaled, &log_cursor, log + log_cursor, 256)))
+            CHECK(cnt > 0, "journal round %u: the log fell behind", round);
+        mirror_read(seen);
+        mirror_check(round);
+    }
+
+    CHECK(journaled.journal.head - slow > JOURNAL_CAP, "journal: %u rounds don't overrun the journal", rounds);
+    zd_node_event events[64];
+    CHECK(znode_journal_read(&journaled, &slow, events, 64) == -1 && slow == journaled.journal.tail,
+        "journal: a consumer left behind doesn't get -1 and the oldest event kept");
+    while((cnt = znode_journal_read(&journaled, &slow, events, 64)) > 0)
+        CHECK(!memcmp(events, log + slow - cnt, cnt * sizeof(zd_node_event)), "journal: events read late differ from the log");
+    CHECK(cnt == 0 && slow == journaled.journal.head, "journal: a consumer left behind doesn't read up to the newest event");
+
+    u64 events_recorded = journaled.journal.head;
+    znode_free(&journaled);
+    free(log);
+    free(mirror.live);
+    free(mirror.slot);
+    free(mirror.pos);
+    free(mirror.in_cnt);
+    free(mirror.in_sum);
+    return events_recorded;
+}
+
+i32 main(i32 argc, char **argv) {
+    u32 ops = argc > 1 ? atoi(argv[1]) : 20000;
+    if(argc > 2) seed = atoi(argv[2]);
+    node_cap = link_cap = ops + 1;
+    nodes = calloc(node_cap, sizeof(model_node));
+    links = calloc(link_cap, sizeof(model_link));
+    u32 counts[10] = { 0 };
+    zd_node *batch[16];
+    zd_node_link *link_batch[16];
+
+    for(u32 op = 0; op < ops; op++) {
+        u32 kind = rnd() % 100;
+        i32 a = any_node(), b = any_node();
+        if(kind < 25 || a < 0) {
+            model_node *m = &nodes[node_cnt];
+            *m = (model_node) { true, (void*)(size_t)(rnd() % UUDS + 1), rnd() % 2, 1 + rnd() % 3, 1 + rnd() % 3, 0 };
+            m->flags = rnd() % 8 == 0 ? ZF_NODE_1IN : rnd() % 8 == 0 ? ZF_NODE_1OUT : 0;
+            m->node = znode_add(&editor, m->uud, m->uud_type, (zvec2) { rnd() % 1000, rnd() % 1000 }, m->in, m->out, m->flags);
+            znode_clean(m->node, (void*)(size_t)(node_cnt + 1));
+            node_cnt++;
+            counts[0]++;
+        } else if(kind < 65 && b >= 0) {
+            i32 id_out = rnd() % nodes[a].out, id_in = rnd() % nodes[b].in;
+            bool refused = model_links(a, id_out, b, id_in) || ((nodes[a].flags & ZF_NODE_1OUT) && port_used(a, id_out, false)) ||
+                ((nodes[b].flags & ZF_NODE_1IN) && port_used(b, id_in, true));
+            bool cycle = !refused && reaches(b, a);
+            bool linked = znode_link(&editor, nodes[a].node, id_out, nodes[b].node, id_in);
+            CHECK(linked == !(refused || cycle), "op %u: znode_link gave %d, the model has %s", op, linked,
+                refused ? "the link or the port taken" : cycle ? "a cycle" : "neither");
+            if(linked) {
+                links[link_cnt++] = (model_link) { true, a, b, id_out, id_in };
+                counts[1]++;
+            }
+            counts[9] += cycle;
+        } else if(kind < 70) {
+            zd_node_link *link = any_link();
+            if(!link) continue;
+            del_model_link(link);
+            znode_del_link(&editor, link);
+            counts[2]++;
+        } else if(kind < 74) {
+            del_model_node(a);
+            znode_del_node(&editor, nodes[a].node);
+            counts[3]++;
+        } else if(kind < 77) {
+            // by uud, which deletes the newest and brings back the one it shadowed
+            i32 h = newest(nodes[a].uud, nodes[a].uud_type);
+            CHECK(znode_del(&editor, nodes[a].uud, nodes[a].uud_type), "op %u: znode_del failed", op);
+            del_model_node(h);
+            counts[4]++;
+        } else if(kind < 80) {
+            i32 cnt = 0, expected = 0;
+            for(i32 i = 0; i < 8; i++) {
+                i32 h = any_node();
+                if(h < 0) continue;
+                // listed twice, deleted once
+                batch[cnt++] = nodes[h].node;
+                if(rnd() % 2) batch[cnt++] = nodes[h].node;
+                expected += nodes[h].live;
+                del_model_node(h);
+            }
+            CHECK(znode_del_nodes(&editor, batch, cnt) == expected, "op %u: znode_del_nodes", op);
+            counts[5]++;
+        } else if(kind < 84) {
+            i32 cnt = 0, expected = 0;
+            for(i32 i = 0; i < 8; i++) {
+                zd_node_link *link = any_link();
+                if(!link) continue;
+                bool listed = false;
+                for(i32 k = 0; k < cnt; k++)
+                    listed |= link_batch[k] == link;
+                link_batch[cnt++] = link;
+                if(listed) continue;
+                expected++;
+                del_model_link(link);
+            }
+            CHECK(znode_del_links(&editor, link_batch, cnt) == expected, "op %u: znode_del_links", op);
+            counts[6]++;
+        } else if(kind < 88) {
+            i32 id = rnd() % nodes[a].in;
+            for(u32 i = 0; i < link_cnt; i++)
+                if(links[i].live && links[i].input == (u32)a && links[i].id_in == id) links[i].live = false;
+            znode_del_in_links(&editor, nodes[a].node, id);
+            counts[7]++;
+        } else if(kind < 94) {
+            zd_node *node = nodes[a].node;
+            znode_move(&editor, node, (zvec2) { node->rect.x + 1, node->rect.y });
+        } else if(kind < 97) {
+            znode_compact(&editor);
+            FOR_NODES(&editor)
+                nodes[handle(node)].node = node;
+            counts[8]++;
+        } else {
+            continue;
+        }
+        if(op % 25 == 0 || kind >= 94) check(op);
+        if(failures) break;
+    }
+    check(ops);
+    // enough rounds to overrun the journal
+    u32 seen[ZNODE_EV_LOAD + 1] = { 0 };
+    u64 events = failures ? 0 : journal_test(ops / 100 > 150 ? ops / 100 : 150, seen);
+    printf("{\"ops\":%u,\"adds\":%u,\"links\":%u,\"unlinks\":%u,\"deletes\":%u,\"deletes_by_uud\":%u,\"batch_deletes\":%u,"
+        "\"batch_unlinks\":%u,\"port_unlinks\":%u,\"compacts\":%u,\"cycles_refused\":%u,\"nodes\":%d,\"links_left\":%d,"
+        "\"journal\":{\"events\":%llu,\"moves\":%u,\"compacts\":%u,\"loads\":%u},\"failures\":%u}\n",
+        ops, counts[0], counts[1], counts[2], counts[3], counts[4], counts[5], counts[6], counts[7], counts[8], counts[9],
+        editor.node_cnt, editor.link_cnt, (unsigned long long)events, seen[ZNODE_EV_MOVE], seen[ZNODE_EV_COMPACT],
+        seen[ZNODE_EV_LOAD], failures);
+    znode_free(&editor);
+    free(nodes);
+    free(links);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,148 @@
+// Record / replay driver.
+// `record` runs a small application with the headless backend while a scripted user moves the mouse, clicks,
+// scrolls, types and resizes the window, and records the session with zui_record_start.
+// `replay` runs the same application frames with the replay backend, checks every frame's draw commands against
+// the recording and prints the recorded and replayed phase timings as JSON. Exits with 1 on any difference.
+//
+// usage: replay-test record <file> [frames] [font.ttf]
+//        replay-test replay <file>
+#define ZUI_IMPL
+#include "../../src/zui.h"
+#include "../../backends/headless/zui-headless.h"
+#include "../../backends/replay/zui-replay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static char *font = "Consolas";
+static char *path;
+
+static u64 test_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// the application: knows nothing about recording, only draws its UI from the inputs it gets
+static void app_init(void *user_data) {
+    zui_new_font(font, 16);
+}
+
+static void app_frame(void *user_data) {
+    static i32 tab;
+    static u8 buttons[12];
+    static char name[64] = "name: ";
+    static zd_text name_state;
+    static zd_scroll scroll;
+    static i64 start;
+    i64 now = zui_ts(); // depends on the renderer's clock, the replay gets the recorded timestamps back
+    if(!start) start = now;
+    zui_window();
+        zui_col(Z_AUTO_ALL);
+            zui_labelf("%lld us", (now - start) / 1000);
+            zui_text(name, sizeof(name), &name_state);
+            zui_tabset("Buttons,List", &tab);
+                zui_grid(4, 3, Z_AUTO_ALL, Z_AUTO_ALL);
+                    for(i32 i = 0; i < 12; i++)
+                        zui_button_txt(i % 2 ? "press" : "me", &buttons[i]);
+                zui_end();
+                zui_scroll(false, true, &scroll);
+                    zui_col(Z_AUTO_ALL);
+                        for(i32 i = 0; i < 40; i++)
+                            zui_labelf("item %d", i);
+                    zui_end();
+                zui_end();
+            zui_end();
+        zui_end();
+    zui_end();
+    zui_render();
+}
+
+// position of a text command of the last frame, to click on what the user would see
+static zvec2 find_text(char *text) {
+    i32 len, n = strlen(text);
+    u8 *cmds = headless_frame(&len);
+    for(i32 i = 0; i < len; ) {
+        zcmd_text cmd;
+        memcpy(&cmd, cmds + i, sizeof(cmd));
+        if(cmd.header.id == ZCMD_DRAW_TEXT && cmd.header.bytes - sizeof(zcmd_text) == n && !memcmp(cmds + i + sizeof(zcmd_text), text, n))
+            return (zvec2) { cmd.pos.x + 2, cmd.pos.y + 2 };
+        i += cmd.header.bytes;
+    }
+    return (zvec2) { 0, 0 };
+}
+
+// the scripted user
+static void user_input(i32 f) {
+    static zvec2 target;
+    switch(f % 200) {
+        case 10: target = find_text("name: "); zui_mouse_move(target); zui_mouse_down(ZM_LEFT_CLICK); break;
+        case 11: zui_mouse_up(ZM_LEFT_CLICK); break;
+        case 60: target = find_text("me"); zui_mouse_move(target); zui_mouse_down(ZM_LEFT_CLICK); break;
+        case 61: zui_mouse_up(ZM_LEFT_CLICK); break;
+        case 100: target = find_text(f % 400 < 200 ? "List" : "Buttons"); zui_mouse_move(target); zui_mouse_down(ZM_LEFT_CLICK); break;
+        case 101: zui_mouse_up(ZM_LEFT_CLICK); break;
+        case 150: zui_key_mods(ZK_SHIFT); break;
+        case 170: zui_key_mods(0); break;
+    }
+    if(f % 200 > 11 && f % 200 < 60 && f % 3 == 0)
+        zui_key_char(f % 200 == 45 ? 0xE9 : 'a' + f % 26); // U+00E9, a glyph the cache has not seen yet
+    if(f % 200 > 101 && f % 200 < 140) {
+        zui_mouse_move((zvec2) { 300 + f % 40, 300 });
+        zui_mouse_scroll(f % 2 ? -40 : 10);
+    }
+    if(f == 300) zui_resize(640, 480);
+}
+
+static void record_init(void *user_data) {
+    app_init(user_data);
+    if(!zui_record_start(path, ZREC_OUTPUT)) exit(1);
+}
+
+void LOG(char *fmt, va_list args, void *user_data) { vfprintf(stderr, fmt, args); }
+
+static i32 record(i32 frames) {
+    zui_headless_args args = { .width = 800, .height = 600, .fallback_metrics = true, .record = true, .tick_manually = true, .init = record_init };
+    zui_init(headless_renderer, LOG, &args);
+    for(i32 f = 0; f < frames; f++) {
+        user_input(f);
+        app_frame(0);
+    }
+    zui_close();
+    FILE *f = fopen(path, "rb");
+    fseek(f, 0, SEEK_END);
+    printf("{\"recorded\":%d,\"bytes\":%ld}\n", frames, ftell(f));
+    fclose(f);
+    return 0;
+}
+
+static i32 replay() {
+    static char *names[ZP_LAST] = { "text", "size_x", "size_y", "pos", "draw", "sort", "submit" };
+    zui_replay_args args = { .path = path, .init = app_init, .frame = app_frame };
+    u64 start = test_ns();
+    zui_init(replay_renderer, LOG, &args);
+    u64 wall = test_ns() - start;
+    zui_replay_result *r = replay_result();
+    zui_close();
+    if(!r->opened) return 1;
+    printf("{\"frames\":%u,\"recorded\":%u,\"mismatches\":%u,\"first_mismatch\":%d,\"diverged\":%u,\"fps\":%.0f,\"phases_ms\":{",
+        r->frames, r->recorded, r->mismatches, r->first_mismatch, r->diverged, r->frames / (wall / 1e9));
+    for(i32 i = 0; i < ZP_LAST; i++)
+        printf("%s\"%s\":{\"recorded\":%.3f,\"replayed\":%.3f}", i ? "," : "", names[i], r->recorded_ns[i] / 1e6, r->replayed_ns[i] / 1e6);
+    printf("}}\n");
+    return r->frames == r->recorded && !r->mismatches && !r->diverged ? 0 : 1;
+}
+
+i32 main(i32 argc, char **argv) {
+    if(argc < 3) {
+        printf("usage: replay-test record <file> [frames] [font.ttf]\n       replay-test replay <file>\n");
+        return 1;
+    }
+    path = argv[2];
+    if(!strcmp(argv[1], "record")) {
+        if(argc > 4) font = argv[4];
+        return record(argc > 3 ? atoi(argv[3]) : 600);
+    }
+    return replay();
+}
@@ -0,0 +1,145 @@
+// Shared-memory transport test.
+// The application runs a small UI with the shm backend and spawns this same binary as its renderer process,
+// which draws the frames with the headless backend and clicks the second tab. After every frame the application
+// sends its own hash of the frame as clipboard text and the renderer checks that it drew exactly that.
+// `crash` makes the renderer exit after two frames: the application must stop, not hang.
+//
+// usage: shm-test [crash] [font.ttf]
+#define ZUI_IMPL
+#include "../../src/zui.h"
+#include "../../backends/headless/zui-headless.h"
+#include "../../backends/shm/zui-shm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char *font = "Consolas";
+static i32 tab;
+
+// the application side renderer hashes each frame the same way the headless backend does
+static u64 server_hash;
+static void server_renderer(zcmd_any *cmd, void *user_data) {
+    static u64 hash;
+    switch(cmd->base.id) {
+        case ZCMD_RENDER_BEGIN: hash = 0xCBF29CE484222325ULL; break;
+        case ZCMD_RENDER_END: server_hash = hash; break;
+        case ZCMD_DRAW_CLIP:
+        case ZCMD_DRAW_RECT:
+        case ZCMD_DRAW_TEXT:
+        case ZCMD_DRAW_LINES:
+        case ZCMD_DRAW_BEZIER:
+            for(i32 i = 0; i < cmd->base.bytes; i++)
+                hash = (hash ^ ((u8*)cmd)[i]) * 0x100000001B3ULL;
+            break;
+    }
+    shm_renderer(cmd, user_data);
+}
+
+static void init(void *user_data) {
+    zui_new_font(font, 16);
+}
+
+static void frame(void *user_data) {
+    zui_window(); {
+        zui_col(2, Z_AUTO, Z_AUTO); {
+            zui_label("Hello!");
+            zui_tabset("One,Two", &tab); {
+                zui_label("first tab");
+                zui_label("second tab");
+            } zui_end();
+        } zui_end();
+    } zui_end();
+    zui_render();
+    struct { zcmd_set_clipboard cmd; char text[17]; } check;
+    check.cmd.header = (zcmd) { ZCMD_SET_CLIPBOARD, sizeof(zcmd_set_clipboard) + 16 };
+    snprintf(check.text, sizeof(check.text), "%016llx", server_hash);
+    shm_renderer((zcmd_any*)&check, user_data);
+}
+
+// RENDERER PROCESS
+
+static zui_headless_args consumer_args = { .fallback_metrics = true, .record = true };
+static i32 checked, mismatches;
+
+static void consumer_renderer(zcmd_any *cmd, void *user_data) {
+    if(cmd->base.id == ZCMD_SET_CLIPBOARD) {
+        u64 expected = strtoull(cmd->set_clipboard.text, 0, 16);
+        checked++;
+        if(expected != headless_frame_hash()) {
+            printf("renderer: frame %d drawn as %016llx, sent as %016llx\n", checked, headless_frame_hash(), expected);
+            mismatches++;
+        }
+        return;
+    }
+    headless_renderer(cmd, user_data);
+}
+
+// position of a text command of the last frame the renderer drew, x -1 if there's none
+static zvec2 find_text(char *text) {
+    i32 len, n = strlen(text);
+    u8 *cmds = headless_frame(&len);
+    for(i32 i = 0; i < len; ) {
+        zcmd_text cmd;
+        memcpy(&cmd, cmds + i, sizeof(cmd));
+        if(cmd.header.id == ZCMD_DRAW_TEXT && cmd.header.bytes - sizeof(zcmd_text) == n && !memcmp(cmds + i + sizeof(zcmd_text), text, n))
+            return (zvec2) { cmd.pos.x + 2, cmd.pos.y + 2 };
+        i += cmd.header.bytes;
+    }
+    return (zvec2) { -1, -1 };
+}
+
+static i32 consumer(bool crash) {
+    zui_shm_client client;
+    if(!shm_client_open(&client, -1, consumer_renderer, &consumer_args)) {
+        printf("renderer: couldn't open the shared block\n");
+        return 1;
+    }
+    shm_client_push(&client, (zccmd*)&(zccmd_win) { { ZCCMD_WIN, sizeof(zccmd_win) }, { 300, 200 } });
+    zvec2 pos = { 0 };
+    i32 pressed = 0;
+    for(i32 n; (n = shm_client_poll(&client, 2000)) >= 0;) {
+        if(n == 0) {
+            printf("renderer: timed out\n");
+            return 1;
+        }
+        if(crash && client.frames >= 2) _exit(3);
+        if(!pressed && client.frames >= 2) {
+            pos = find_text("Two");
+            if(pos.x < 0) break;
+            shm_client_push(&client, (zccmd*)&(zccmd_mouse) { { ZCCMD_MOUSE, sizeof(zccmd_mouse) }, pos, 0 });
+            shm_client_push(&client, (zccmd*)&(zccmd_mouse) { { ZCCMD_MOUSE, sizeof(zccmd_mouse) }, pos, ZM_LEFT_CLICK });
+            pressed = client.frames;
+        } else if(pressed > 0 && client.frames >= pressed + 3) {
+            // the application is up to two frames ahead, by now it has seen the button down
+            shm_client_push(&client, (zccmd*)&(zccmd_mouse) { { ZCCMD_MOUSE, sizeof(zccmd_mouse) }, pos, 0 });
+            pressed = -1;
+        }
+    }
+    bool second = find_text("second tab").x >= 0 && find_text("first tab").x < 0;
+    printf("renderer: %d frames, %d checked, %d mismatches, second tab %s\n", client.frames, checked, mismatches, second ? "shown" : "not shown");
+    shm_client_close(&client);
+    return !mismatches && checked == client.frames && checked > 0 && second ? 0 : 1;
+}
+
+void LOG(char *fmt, va_list args, void *user_data) { vprintf(fmt, args); }
+
+i32 main(i32 argc, char **argv) {
+    bool crash = argc > 1 && !strcmp(argv[1], "crash");
+    i32 arg = crash ? 2 : 1;
+    if(argc > 1 && !strcmp(argv[1], "consumer")) {
+        crash = argc > 2 && !strcmp(argv[2], "crash");
+        return consumer(crash);
+    }
+    if(argc > arg) font = argv[arg];
+    char *consumer_argv[] = { argv[0], "consumer", crash ? "crash" : "", 0 };
+    zui_shm_args args = { .consumer = consumer_argv, .frames = 30, .init = init, .frame = frame };
+    zui_init(server_renderer, LOG, &args);
+    zui_close();
+    zui_shm_stats *s = shm_stats();
+    i32 status = shm_consumer_status();
+    printf("{\"frames\":%u,\"bytes\":%llu,\"queries\":%u,\"query_us\":%.2f,\"stalls\":%u,\"renderer_status\":%d}\n",
+        s->frames, s->bytes, s->queries, s->queries ? s->query_ns / 1e3 / s->queries : 0, s->stalls, status);
+    bool ok = crash ? status == 3 && s->frames < 30 : status == 0 && tab == 1 && s->frames == 30;
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}